@@ -781,6 +781,28 @@ NNG_DECL nng_listener nng_pipe_listener(nng_pipe);
 #define NNG_OPT_RECONNMINT "reconnect-time-min"
 #define NNG_OPT_RECONNMAXT "reconnect-time-max"
 
+// Connection striping.  This is an int, the number of pipes that a dialer
+// keeps connected to its address, each of which is redialed on its own if
+// it is lost.  The default is one.  Lowering it closes the surplus pipes.
+// Only stream based transports (TCP, TLS, and IPC) support more than one.
+#define NNG_OPT_DIAL_PIPES "dial-pipes"
+
+// Send coalescing, for stream based transports (TCP and IPC).  When the
+// size (a size_t, in bytes) is non-zero, small messages are gathered into
+// a buffer of that size, and written together with a single system call.
+// The time (an nng_duration) is how long an idle pipe may wait for more
+// messages before writing a partially filled buffer.  These are set on
+// dialers and listeners, and apply to pipes created afterwards.
+#define NNG_OPT_SEND_COALESCE "send-coalesce-size"
+#define NNG_OPT_SEND_COALESCE_TIME "send-coalesce-time"
+
+// Inproc buffering.  This is an int, the number of messages that may be
+// sent in each direction of an inproc connection before a receiver takes
+// them.  The default (zero) makes each send wait for a receive.  This is
+// set on dialers and listeners, and a connection uses the larger of the
+// values on its two ends.
+#define NNG_OPT_INPROC_BUFFER "inproc:buffer"
+
 // TLS options are only used when the underlying transport supports TLS.
 
 // NNG_OPT_TLS_VERIFIED returns a boolean indicating whether the peer has
@@ -1311,6 +1333,18 @@ typedef struct {
 	// will be used. Default is controlled by NNG_RESOLV_CONCURRENCY
 	// compile time variable.
 	int16_t num_resolver_threads;
+
+	// Number of messages, and message bodies of each size class, that
+	// each thread caches for reuse (large bodies are cached in smaller
+	// numbers).  Default is determined by the NNG_MSG_CACHE_SIZE compile
+	// time variable.  -1 disables message pooling altogether.
+	int16_t num_msg_cache;
+
+	// Limit, in kilobytes, on all the memory held for reuse, in the
+	// per-thread caches and the shared pool behind them.  -1 means no
+	// limit.  Default is determined by the NNG_MSG_POOL_MAX_KB compile
+	// time variable.
+	int32_t max_msg_pool_kb;
 } nng_init_params;
 
 // Initialize the library.  May be called multiple times, but
@@ -1665,6 +1699,7 @@ NNG_DECL int nng_sub0_socket_unsubscribe(
 NNG_DECL int nng_sub0_ctx_subscribe(nng_ctx id, const void *buf, size_t sz);
 NNG_DECL int nng_sub0_ctx_unsubscribe(nng_ctx id, const void *buf, size_t sz);
 #define NNG_OPT_SUB_PREFNEW "sub:prefnew"
+#define NNG_OPT_SUB_ADVERTISE "sub:advertise"
 
 // REQREP0
 NNG_DECL int nng_rep0_open(nng_socket *);
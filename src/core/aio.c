@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -13,14 +13,36 @@
 #include "core/taskq.h"
 #include <string.h>
 
+// Each expiration queue keeps its aios in a hierarchical timing wheel, so
+// that adding and removing one is O(1), and the expiration thread only
+// looks at aios that are actually due.  Level 0 has one slot per
+// millisecond for the next 256 ms.  Each higher level has slots that are
+// 256 times wider, and the aios in a slot are moved down a level when the
+// wheel reaches the start of that slot.  Anything further out than four
+// levels (about 49 days) waits on a separate list.
+#define NNI_EXPIRE_WHEEL_BITS 8
+#define NNI_EXPIRE_WHEEL_SLOTS (1U << NNI_EXPIRE_WHEEL_BITS)
+#define NNI_EXPIRE_WHEEL_LEVELS 4
+#define NNI_EXPIRE_WHEEL_SPAN \
+	((nni_time) 1 << (NNI_EXPIRE_WHEEL_BITS * NNI_EXPIRE_WHEEL_LEVELS))
+
+typedef struct {
+	nni_list ew_slots[NNI_EXPIRE_WHEEL_SLOTS];
+	uint64_t ew_bits[NNI_EXPIRE_WHEEL_SLOTS / 64]; // slots in use (hint)
+} nni_expire_wheel;
+
 struct nni_aio_expire_q {
-	nni_mtx  eq_mtx;
-	nni_cv   eq_cv;
-	nni_list eq_list;
-	nni_thr  eq_thr;
-	nni_time eq_next; // next expiration
-	bool     eq_exit;
-	bool     eq_stop;
+	nni_mtx          eq_mtx;
+	nni_cv           eq_cv;
+	nni_expire_wheel eq_wheel[NNI_EXPIRE_WHEEL_LEVELS];
+	nni_list         eq_far;   // beyond the reach of the wheel
+	nni_list         eq_due;   // expired, but not canceled yet
+	nni_time         eq_now;   // earliest time not yet processed
+	unsigned         eq_count; // aios in the wheel or due
+	nni_thr          eq_thr;
+	nni_time         eq_next; // next expiration
+	bool             eq_exit;
+	bool             eq_stop;
 };
 
 static nni_aio_expire_q **nni_aio_expire_q_list;
@@ -568,12 +590,185 @@ nni_aio_completions_run(nni_aio_completions *clp)
 	}
 }
 
+static void
+nni_expire_wheel_put(nni_aio_expire_q *eq, nni_aio *aio)
+{
+	nni_time          t = aio->a_expire;
+	nni_time          diff;
+	nni_expire_wheel *w;
+	unsigned          slot;
+	int               lvl;
+
+	if (t < eq->eq_now) {
+		t = eq->eq_now;
+	}
+	// The level is the one where this time first agrees with the
+	// wheel's current time in all of the higher bits.
+	diff = t ^ eq->eq_now;
+	for (lvl = 0; lvl < NNI_EXPIRE_WHEEL_LEVELS; lvl++) {
+		if ((diff >> (NNI_EXPIRE_WHEEL_BITS * (lvl + 1))) == 0) {
+			break;
+		}
+	}
+	if (lvl == NNI_EXPIRE_WHEEL_LEVELS) {
+		nni_list_append(&eq->eq_far, aio);
+		return;
+	}
+	w    = &eq->eq_wheel[lvl];
+	slot = (unsigned) (t >> (NNI_EXPIRE_WHEEL_BITS * lvl)) &
+	    (NNI_EXPIRE_WHEEL_SLOTS - 1);
+	nni_list_append(&w->ew_slots[slot], aio);
+	w->ew_bits[slot / 64] |= (uint64_t) 1 << (slot % 64);
+}
+
+// nni_expire_wheel_scan returns the first slot at or after start that
+// has aios in it, or -1 if there are none.  Bits left behind by removed
+// aios are cleared along the way.
+static int
+nni_expire_wheel_scan(nni_expire_wheel *w, unsigned start)
+{
+	unsigned slot = start;
+
+	while (slot < NNI_EXPIRE_WHEEL_SLOTS) {
+		uint64_t bits = w->ew_bits[slot / 64] >> (slot % 64);
+
+		if (bits == 0) {
+			slot = (slot / 64 + 1) * 64;
+			continue;
+		}
+		while ((bits & 1) == 0) {
+			bits >>= 1;
+			slot++;
+		}
+		if (!nni_list_empty(&w->ew_slots[slot])) {
+			return ((int) slot);
+		}
+		w->ew_bits[slot / 64] &= ~((uint64_t) 1 << (slot % 64));
+		slot++;
+	}
+	return (-1);
+}
+
+// nni_aio_expire_next returns the next time the wheel needs attention,
+// either because aios expire then, or because aios must be moved down
+// from a higher level.
+static nni_time
+nni_aio_expire_next(nni_aio_expire_q *eq)
+{
+	nni_time now = eq->eq_now;
+
+	for (int lvl = 0; lvl < NNI_EXPIRE_WHEEL_LEVELS; lvl++) {
+		unsigned shift = NNI_EXPIRE_WHEEL_BITS * lvl;
+		unsigned idx   = (unsigned) (now >> shift) &
+		    (NNI_EXPIRE_WHEEL_SLOTS - 1);
+		int      slot;
+
+		// At higher levels, the current slot is always empty, as
+		// nni_aio_expire_set_now moves its aios down.
+		slot = nni_expire_wheel_scan(
+		    &eq->eq_wheel[lvl], lvl == 0 ? idx : idx + 1);
+		if (slot >= 0) {
+			unsigned top = shift + NNI_EXPIRE_WHEEL_BITS;
+			return (((now >> top) << top) |
+			    ((nni_time) slot << shift));
+		}
+	}
+	if (!nni_list_empty(&eq->eq_far)) {
+		return ((now / NNI_EXPIRE_WHEEL_SPAN + 1) *
+		    NNI_EXPIRE_WHEEL_SPAN);
+	}
+	return (NNI_TIME_NEVER);
+}
+
+// nni_aio_expire_set_now moves the wheel's current time to t.  Whatever
+// sits in the slot containing t at a higher level is moved down, so that
+// above level 0 the current slot is always empty, no matter whether t is
+// at the start of that slot or not.
+static void
+nni_aio_expire_set_now(nni_aio_expire_q *eq, nni_time t)
+{
+	nni_aio *aio;
+	nni_list far;
+	nni_time old = eq->eq_now;
+
+	eq->eq_now = t;
+	if ((t / NNI_EXPIRE_WHEEL_SPAN) != (old / NNI_EXPIRE_WHEEL_SPAN)) {
+		NNI_LIST_INIT(&far, nni_aio, a_expire_node);
+		while ((aio = nni_list_first(&eq->eq_far)) != NULL) {
+			nni_list_remove(&eq->eq_far, aio);
+			nni_list_append(&far, aio);
+		}
+		while ((aio = nni_list_first(&far)) != NULL) {
+			nni_list_remove(&far, aio);
+			nni_expire_wheel_put(eq, aio);
+		}
+	}
+	for (int lvl = NNI_EXPIRE_WHEEL_LEVELS - 1; lvl > 0; lvl--) {
+		unsigned  shift = NNI_EXPIRE_WHEEL_BITS * lvl;
+		unsigned  idx   = (unsigned) (t >> shift) &
+		    (NNI_EXPIRE_WHEEL_SLOTS - 1);
+		nni_list *slot  = &eq->eq_wheel[lvl].ew_slots[idx];
+
+		while ((aio = nni_list_first(slot)) != NULL) {
+			nni_list_remove(slot, aio);
+			nni_expire_wheel_put(eq, aio);
+		}
+	}
+}
+
+// nni_aio_expire_advance moves the wheel forward through now, putting
+// everything that has expired on the due list.
+static void
+nni_aio_expire_advance(nni_aio_expire_q *eq, nni_time now)
+{
+	nni_time t;
+	nni_aio *aio;
+
+	while ((t = nni_aio_expire_next(eq)) <= now) {
+		nni_list *slot;
+
+		nni_aio_expire_set_now(eq, t);
+		slot = &eq->eq_wheel[0]
+		            .ew_slots[t & (NNI_EXPIRE_WHEEL_SLOTS - 1)];
+		while ((aio = nni_list_first(slot)) != NULL) {
+			nni_list_remove(slot, aio);
+			nni_list_append(&eq->eq_due, aio);
+		}
+		nni_aio_expire_set_now(eq, t + 1);
+	}
+	if (eq->eq_now <= now) {
+		nni_aio_expire_set_now(eq, now + 1);
+	}
+}
+
+// nni_aio_expire_all puts everything on the due list, for shutdown.
+static void
+nni_aio_expire_all(nni_aio_expire_q *eq)
+{
+	nni_aio *aio;
+
+	for (int lvl = 0; lvl < NNI_EXPIRE_WHEEL_LEVELS; lvl++) {
+		for (unsigned i = 0; i < NNI_EXPIRE_WHEEL_SLOTS; i++) {
+			nni_list *slot = &eq->eq_wheel[lvl].ew_slots[i];
+			while ((aio = nni_list_first(slot)) != NULL) {
+				nni_list_remove(slot, aio);
+				nni_list_append(&eq->eq_due, aio);
+			}
+		}
+	}
+	while ((aio = nni_list_first(&eq->eq_far)) != NULL) {
+		nni_list_remove(&eq->eq_far, aio);
+		nni_list_append(&eq->eq_due, aio);
+	}
+}
+
 static void
 nni_aio_expire_add(nni_aio *aio)
 {
 	nni_aio_expire_q *eq = aio->a_expire_q;
 
-	nni_list_append(&eq->eq_list, aio);
+	nni_expire_wheel_put(eq, aio);
+	eq->eq_count++;
 
 	if (eq->eq_next > aio->a_expire) {
 		eq->eq_next = aio->a_expire;
@@ -584,7 +779,10 @@ nni_aio_expire_add(nni_aio *aio)
 static void
 nni_aio_expire_rm(nni_aio *aio)
 {
-	nni_list_node_remove(&aio->a_expire_node);
+	if (nni_list_node_active(&aio->a_expire_node)) {
+		nni_list_node_remove(&aio->a_expire_node);
+		aio->a_expire_q->eq_count--;
+	}
 
 	// If this item is the one that is going to wake the loop,
 	// don't worry about it.  It will wake up normally, or when we
@@ -598,7 +796,6 @@ nni_aio_expire_loop(void *arg)
 	nni_aio_expire_q *q   = arg;
 	nni_mtx          *mtx = &q->eq_mtx;
 	nni_cv           *cv  = &q->eq_cv;
-	nni_time          now;
 	uint32_t          exp_idx;
 	nni_aio          *expires[NNI_EXPIRE_BATCH];
 
@@ -609,48 +806,34 @@ nni_aio_expire_loop(void *arg)
 	for (;;) {
 		nni_aio *aio;
 		nng_err  rv;
-		nni_time next;
-
-		next = q->eq_next;
-		now  = nni_clock();
-
-		// Each time we wake up, we scan the entire list of elements.
-		// We scan forward, moving up to NNI_EXPIRE_Q_SIZE elements
-		// (a batch) to a saved array of things we are going to cancel.
-		// This mostly runs in O(n), provided you don't have many
-		// elements (> NNI_EXPIRE_Q_SIZE) all expiring simultaneously.
-		aio = nni_list_first(&q->eq_list);
-		if ((aio == NULL) && (q->eq_exit)) {
-			nni_mtx_unlock(mtx);
-			return;
+
+		if (q->eq_stop) {
+			nni_aio_expire_all(q);
+		} else {
+			nni_aio_expire_advance(q, nni_clock());
 		}
-		if (now < next && !(q->eq_stop && aio != NULL)) {
-			// nothing to do!
-			nni_cv_until(cv, next);
+
+		// We take expired aios off in batches of up to
+		// NNI_EXPIRE_BATCH, so that we can drop the lock to cancel
+		// them.  Only the aios that are due are ever looked at.
+		if (nni_list_empty(&q->eq_due)) {
+			if ((q->eq_count == 0) && (q->eq_exit)) {
+				nni_mtx_unlock(mtx);
+				return;
+			}
+			q->eq_next = nni_aio_expire_next(q);
+			nni_cv_until(cv, q->eq_next);
 			continue;
 		}
-		q->eq_next = NNI_TIME_NEVER;
-		exp_idx    = 0;
-		while (aio != NULL) {
-			if ((q->eq_stop || aio->a_expire < now) &&
-			    (exp_idx < NNI_EXPIRE_BATCH)) {
-				nni_aio *nxt;
-
-				// This one is expiring.
-				expires[exp_idx++] = aio;
-				// save the next node
-				nxt = nni_list_next(&q->eq_list, aio);
-				nni_list_remove(&q->eq_list, aio);
-				// Place a temporary hold on the aio.
-				// This prevents it from being destroyed.
-				aio->a_expiring = true;
-				aio             = nxt;
-				continue;
-			}
-			if (aio->a_expire < q->eq_next) {
-				q->eq_next = aio->a_expire;
-			}
-			aio = nni_list_next(&q->eq_list, aio);
+		exp_idx = 0;
+		while ((exp_idx < NNI_EXPIRE_BATCH) &&
+		    ((aio = nni_list_first(&q->eq_due)) != NULL)) {
+			nni_list_remove(&q->eq_due, aio);
+			q->eq_count--;
+			// Place a temporary hold on the aio.
+			// This prevents it from being destroyed.
+			aio->a_expiring    = true;
+			expires[exp_idx++] = aio;
 		}
 
 		for (uint32_t i = 0; i < exp_idx; i++) {
@@ -814,7 +997,7 @@ nni_aio_expire_q_stop(nni_aio_expire_q *eq)
 		nni_mtx_lock(&eq->eq_mtx);
 		eq->eq_stop = true;
 		nni_cv_wake(&eq->eq_cv);
-		while (!nni_list_empty(&eq->eq_list)) {
+		while (eq->eq_count > 0) {
 			result = true;
 			nni_cv_wait(&eq->eq_cv);
 		}
@@ -853,7 +1036,15 @@ nni_aio_expire_q_alloc(void)
 	}
 	nni_mtx_init(&eq->eq_mtx);
 	nni_cv_init(&eq->eq_cv, &eq->eq_mtx);
-	NNI_LIST_INIT(&eq->eq_list, nni_aio, a_expire_node);
+	for (int lvl = 0; lvl < NNI_EXPIRE_WHEEL_LEVELS; lvl++) {
+		for (unsigned i = 0; i < NNI_EXPIRE_WHEEL_SLOTS; i++) {
+			NNI_LIST_INIT(&eq->eq_wheel[lvl].ew_slots[i], nni_aio,
+			    a_expire_node);
+		}
+	}
+	NNI_LIST_INIT(&eq->eq_far, nni_aio, a_expire_node);
+	NNI_LIST_INIT(&eq->eq_due, nni_aio, a_expire_node);
+	eq->eq_now  = nni_clock();
 	eq->eq_next = NNI_TIME_NEVER;
 	eq->eq_exit = false;
 
@@ -10,6 +10,8 @@
 
 #include <string.h>
 
+#include "core/nng_impl.h"
+
 #include "nuts.h"
 
 static void
@@ -453,6 +455,46 @@ test_aio_scatter_gather_too_many(void)
 	nng_aio_free(aio);
 }
 
+// This runs sleeps together that land in the first level of the wheel,
+// right at its edge, and in the second level, so that some have to be
+// moved down a level before they come due.  None may finish early, and
+// none may be lost.  Canceling one in the second level must leave the
+// others alone.
+void
+test_aio_expire_wheel(void)
+{
+	static const nng_duration durs[] = { 5, 250, 256, 300, 520, 700 };
+	nng_aio                  *aios[NNI_NUM_ELEMENTS(durs)];
+	nng_time                  ends[NNI_NUM_ELEMENTS(durs)];
+	nng_aio                  *victim;
+	nng_time                  start;
+
+	for (size_t i = 0; i < NNI_NUM_ELEMENTS(durs); i++) {
+		ends[i] = 0;
+		NUTS_PASS(nng_aio_alloc(&aios[i], sleep_done, &ends[i]));
+	}
+	NUTS_PASS(nng_aio_alloc(&victim, NULL, NULL));
+
+	start = nng_clock();
+	for (size_t i = 0; i < NNI_NUM_ELEMENTS(durs); i++) {
+		nng_sleep_aio(durs[i], aios[i]);
+	}
+	nng_sleep_aio(400, victim);
+	nng_aio_cancel(victim);
+	nng_aio_wait(victim);
+	NUTS_FAIL(nng_aio_result(victim), NNG_ECANCELED);
+
+	for (size_t i = 0; i < NNI_NUM_ELEMENTS(durs); i++) {
+		nng_aio_wait(aios[i]);
+		NUTS_PASS(nng_aio_result(aios[i]));
+		NUTS_TRUE(ends[i] != 0);
+		NUTS_TRUE((ends[i] - start) >= (nng_time) durs[i]);
+		NUTS_TRUE((ends[i] - start) <= (nng_time) durs[i] + 1000);
+		nng_aio_free(aios[i]);
+	}
+	nng_aio_free(victim);
+}
+
 NUTS_TESTS = {
 	{ "sleep", test_sleep },
 	{ "sleep timeout", test_sleep_timeout },
@@ -471,5 +513,6 @@ NUTS_TESTS = {
 	{ "sleep cancel", test_sleep_cancel },
 	{ "aio busy", test_aio_busy },
 	{ "scatter gather too many", test_aio_scatter_gather_too_many },
+	{ "aio expire wheel", test_aio_expire_wheel },
 	{ NULL, NULL },
 };
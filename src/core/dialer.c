@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 // Copyright 2018 Devolutions <info@devolutions.net>
 //
@@ -17,6 +17,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifndef NNG_MAX_DIAL_PIPES
+#define NNG_MAX_DIAL_PIPES 256
+#endif
+
 // Functionality related to dialing.
 static void dialer_connect_start(nni_dialer *);
 static void dialer_connect_cb(void *);
@@ -226,6 +230,8 @@ nni_dialer_init(nni_dialer *d, nni_sock *s, nni_sp_tran *tran)
 	d->d_inirtime = NNI_SECOND / 100; // 10ms
 	d->d_maxrtime = NNI_SECOND;
 	d->d_currtime = d->d_inirtime;
+	d->d_stripes  = 1;
+	d->d_dialing  = true; // until the first connection
 	nni_atomic_flag_reset(&d->d_started);
 
 	// Make a copy of the endpoint operations.  This allows us to
@@ -525,6 +531,20 @@ nni_dialer_setopt(
 		nni_mtx_unlock(&d->d_mtx);
 		return (rv);
 	}
+	if (strcmp(name, NNG_OPT_DIAL_PIPES) == 0) {
+		int rv;
+		int n;
+		if ((rv = nni_copyin_int(
+		         &n, val, sz, 1, NNG_MAX_DIAL_PIPES, t)) != 0) {
+			return (rv);
+		}
+		if ((n != 1) && (!d->d_ops.d_multi)) {
+			return (NNG_ENOTSUP);
+		}
+		// This takes the socket lock, so must not hold d_mtx.
+		nni_dialer_set_pipes(d, n);
+		return (0);
+	}
 
 	if (d->d_ops.d_setopt != NULL) {
 		int rv = d->d_ops.d_setopt(d->d_data, name, val, sz, t);
@@ -567,6 +587,10 @@ nni_dialer_getopt(
 		nni_mtx_unlock(&d->d_mtx);
 		return (rv);
 	}
+	if (strcmp(name, NNG_OPT_DIAL_PIPES) == 0) {
+		int n = nni_dialer_get_pipes(d);
+		return (nni_copyout_int(n, valp, szp, t));
+	}
 
 	if (d->d_ops.d_getopt != NULL) {
 		int rv = d->d_ops.d_getopt(d->d_data, name, valp, szp, t);
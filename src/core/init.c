@@ -44,6 +44,14 @@ extern void nni_tls_sys_fini(void);
 #define NNG_MAX_EXPIRE_THREADS 8
 #endif
 
+#ifndef NNG_MSG_CACHE_SIZE
+#define NNG_MSG_CACHE_SIZE 32
+#endif
+
+#ifndef NNG_MSG_POOL_MAX_KB
+#define NNG_MSG_POOL_MAX_KB 4096
+#endif
+
 static nng_init_params init_params;
 
 unsigned int    init_count;
@@ -92,8 +100,15 @@ nng_init(const nng_init_params *params)
 	init_params.num_resolver_threads = params->num_resolver_threads
 	    ? params->num_resolver_threads
 	    : NNG_RESOLV_CONCURRENCY;
+	init_params.num_msg_cache        = params->num_msg_cache
+	           ? params->num_msg_cache
+	           : NNG_MSG_CACHE_SIZE;
+	init_params.max_msg_pool_kb      = params->max_msg_pool_kb
+	         ? params->max_msg_pool_kb
+	         : NNG_MSG_POOL_MAX_KB;
 
 	if (((rv = nni_plat_init(&init_params)) != 0) ||
+	    ((rv = nni_msg_sys_init(&init_params)) != 0) ||
 	    ((rv = nni_taskq_sys_init(&init_params)) != 0) ||
 	    ((rv = nni_reap_sys_init()) != 0) ||
 	    ((rv = nni_aio_sys_init(&init_params)) != 0) ||
@@ -147,6 +162,8 @@ nng_fini(void)
 	nni_taskq_sys_fini();
 	nni_aio_sys_fini();
 	nni_id_map_sys_fini();
+	nni_stat_sys_fini();
+	nni_msg_sys_fini();
 	nni_reap_sys_fini(); // must be near the end
 	nni_plat_fini();
 	nni_atomic_flag_reset(&init_busy);
@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 //
 // This software is supplied under the terms of the MIT License, a
 // copy of which should be located in the distribution where this
@@ -100,7 +100,6 @@ test_init_too_many_expire_threads(void)
 	NUTS_MSG("Got %d expire threads", pp->num_expire_threads);
 }
 
-// poller tuning only supported on Windows right now
 void
 test_init_poller_no_threads(void)
 {
@@ -133,7 +132,7 @@ test_init_too_many_poller_threads(void)
 	NUTS_OPEN(s);
 	NUTS_CLOSE(s);
 	pp = nng_init_get_params();
-#ifdef NNG_PLATFORM_WINDOWS
+#if defined(NNG_PLATFORM_WINDOWS) || defined(NNG_POLLQ_EPOLL)
 	NUTS_TRUE(pp->num_poller_threads == 2);
 #else
 	NUTS_TRUE(pp->num_poller_threads > 0);
@@ -141,6 +140,157 @@ test_init_too_many_poller_threads(void)
 	NUTS_MSG("Got %d poller threads", pp->num_expire_threads);
 }
 
+void
+test_init_several_pollers(void)
+{
+	nng_socket       s1[8];
+	nng_socket       s2[8];
+	nng_init_params *pp;
+	nng_init_params  p = { 0 };
+
+	nng_fini();
+	p.num_poller_threads = 4;
+	p.max_poller_threads = 4;
+	NUTS_PASS(nng_init(&p));
+	pp = nng_init_get_params();
+	NUTS_TRUE(pp->num_poller_threads > 0);
+
+	// Connections are spread across the pollers.
+	for (int i = 0; i < 8; i++) {
+		NUTS_OPEN(s1[i]);
+		NUTS_OPEN(s2[i]);
+		NUTS_PASS(nng_socket_set_ms(s1[i], NNG_OPT_RECVTIMEO, 1000));
+		NUTS_PASS(nng_socket_set_ms(s2[i], NNG_OPT_RECVTIMEO, 1000));
+		NUTS_MARRY_EX(s1[i], s2[i], "tcp://127.0.0.1:0", NULL, NULL);
+	}
+	for (int j = 0; j < 10; j++) {
+		for (int i = 0; i < 8; i++) {
+			NUTS_SEND(s1[i], "ping");
+		}
+		for (int i = 0; i < 8; i++) {
+			NUTS_RECV(s2[i], "ping");
+			NUTS_SEND(s2[i], "pong");
+		}
+		for (int i = 0; i < 8; i++) {
+			NUTS_RECV(s1[i], "pong");
+		}
+	}
+	for (int i = 0; i < 8; i++) {
+		NUTS_CLOSE(s1[i]);
+		NUTS_CLOSE(s2[i]);
+	}
+}
+
+void
+test_init_no_msg_pool(void)
+{
+	nng_msg         *msg;
+	nng_init_params *pp;
+	nng_init_params  p = { 0 };
+
+	nng_fini();
+	p.num_msg_cache = -1;
+	NUTS_PASS(nng_init(&p));
+	pp = nng_init_get_params();
+	NUTS_TRUE(pp->num_msg_cache == -1);
+	for (int i = 0; i < 100; i++) {
+		NUTS_PASS(nng_msg_alloc(&msg, (size_t) i * 100));
+		nng_msg_free(msg);
+	}
+}
+
+void
+test_init_msg_pool_size(void)
+{
+	nng_msg         *msg;
+	nng_init_params *pp;
+	nng_init_params  p = { 0 };
+
+	nng_fini();
+	p.num_msg_cache   = 1;
+	p.max_msg_pool_kb = 1;
+	NUTS_PASS(nng_init(&p));
+	pp = nng_init_get_params();
+	NUTS_TRUE(pp->num_msg_cache == 1);
+	NUTS_TRUE(pp->max_msg_pool_kb == 1);
+	for (int i = 0; i < 100; i++) {
+		NUTS_PASS(nng_msg_alloc(&msg, (size_t) i * 100));
+		nng_msg_free(msg);
+	}
+}
+
+#ifdef NNG_ENABLE_STATS
+typedef struct {
+	nng_mtx *mtx;
+	nng_cv  *cv;
+	int      done;
+} pool_barrier;
+
+static uint64_t
+pool_misses(void)
+{
+	nng_stat       *stats;
+	const nng_stat *st;
+	uint64_t        val;
+
+	NUTS_PASS(nng_stats_get(&stats));
+	NUTS_TRUE((st = nng_stat_find(stats, "msgpool")) != NULL);
+	NUTS_TRUE((st = nng_stat_find(st, "misses")) != NULL);
+	val = nng_stat_value(st);
+	nng_stats_free(stats);
+	return (val);
+}
+
+static void
+pool_worker(void *arg)
+{
+	pool_barrier *b = arg;
+	nng_msg      *msg;
+
+	for (int i = 0; i < 1000; i++) {
+		NUTS_PASS(nng_msg_alloc(&msg, 32 * 1024));
+		nng_msg_free(msg);
+	}
+	// Stay around, keeping our cache, until everyone is done.
+	nng_mtx_lock(b->mtx);
+	b->done++;
+	nng_cv_wake(b->cv);
+	while (b->done < 4) {
+		nng_cv_wait(b->cv);
+	}
+	nng_mtx_unlock(b->mtx);
+}
+
+void
+test_init_msg_pool_bound(void)
+{
+	nng_thread     *thr[4];
+	pool_barrier    b;
+	uint64_t        misses;
+	nng_init_params p = { 0 };
+
+	// The limit covers the per-thread caches too: with room for one
+	// 32 KB body (and some messages), at most one of these threads can
+	// cache bodies, and the others miss every time.
+	nng_fini();
+	p.max_msg_pool_kb = 48;
+	NUTS_PASS(nng_init(&p));
+	NUTS_PASS(nng_mtx_alloc(&b.mtx));
+	NUTS_PASS(nng_cv_alloc(&b.cv, b.mtx));
+	b.done = 0;
+	misses = pool_misses();
+	for (int i = 0; i < 4; i++) {
+		NUTS_PASS(nng_thread_create(&thr[i], pool_worker, &b));
+	}
+	for (int i = 0; i < 4; i++) {
+		nng_thread_destroy(thr[i]);
+	}
+	NUTS_TRUE(pool_misses() - misses >= 3000);
+	nng_cv_free(b.cv);
+	nng_mtx_free(b.mtx);
+}
+#endif
+
 void
 test_init_repeated(void)
 {
@@ -201,6 +351,12 @@ NUTS_TESTS = {
 	{ "init too many expire threads", test_init_too_many_expire_threads },
 	{ "init no poller thread", test_init_poller_no_threads },
 	{ "init too many poller threads", test_init_too_many_poller_threads },
+	{ "init several pollers", test_init_several_pollers },
+	{ "init no msg pool", test_init_no_msg_pool },
+	{ "init msg pool size", test_init_msg_pool_size },
+#ifdef NNG_ENABLE_STATS
+	{ "init msg pool bound", test_init_msg_pool_bound },
+#endif
 	{ "init repeated", test_init_repeated },
 	{ "init concurrent", test_init_concurrent },
 
@@ -30,7 +30,12 @@ nni_lmq_init(nni_lmq *lmq, size_t cap)
 	lmq->lmq_cap = 2;
 	lmq->lmq_mask = 0x1; // only index 0 and 1
 	if (cap > 2) {
-		(void) nni_lmq_resize(lmq, cap);
+		if (nni_lmq_resize(lmq, cap) != 0) {
+			// A failed resize changes nothing, so we are left
+			// with the two built in slots, as promised above.
+			NNI_ASSERT(lmq->lmq_msgs == lmq->lmq_buf);
+			NNI_ASSERT(lmq->lmq_cap == 2);
+		}
 	} else {
 		lmq->lmq_cap = cap;
 	}
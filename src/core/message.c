@@ -32,6 +32,431 @@ struct nng_msg {
 	nng_sockaddr   m_addr; // set on receive, transport use
 };
 
+// Message pool.  Message structures, and message bodies up to 64 KB, are
+// recycled instead of being returned to the system allocator.  Bodies
+// are rounded up to a power of two size class.  Each thread keeps a small
+// cache (a "magazine") of objects per class, which it uses without any
+// locking.  When a magazine is empty or full, the thread exchanges half
+// of a magazine with a shared depot for that class.  Every pooled object
+// is an ordinary allocation of its class size, so anything can be
+// released with nni_free(), and the pool can be disabled at any time.
+//
+// All retained memory, in magazines and depots alike, counts toward one
+// limit.  Each thread reserves part of it, in chunks, before caching an
+// object in its magazines; moving objects between a magazine and a depot
+// moves the reservation with them.  Once the limit is reached, freed
+// objects are returned to the system instead.  A thread keeps its
+// reservation until it exits, so that the fast path rarely touches the
+// shared counter.
+#define MSG_POOL_MIN_SHIFT 6  // 64 bytes
+#define MSG_POOL_MAX_SHIFT 16 // 64 KB
+#define MSG_POOL_NBODY (MSG_POOL_MAX_SHIFT - MSG_POOL_MIN_SHIFT + 1)
+#define MSG_POOL_MSG MSG_POOL_NBODY // class for nng_msg itself
+#define MSG_POOL_NCLASS (MSG_POOL_NBODY + 1)
+
+// Per-thread limits: no more than this many objects per class, and for
+// the larger classes, no more than this many bytes per class.
+#define MSG_CACHE_MAX 64
+#define MSG_CACHE_BYTES (256 * 1024)
+
+// Threads reserve bytes toward the pool limit at least this many at a time.
+#define MSG_CACHE_RESERVE (16 * 1024)
+
+// Statistics are accumulated per thread, and published in batches.
+#define MSG_CACHE_STAT_BATCH 64
+
+typedef struct {
+	unsigned num;
+	unsigned max;
+	void    *objs[MSG_CACHE_MAX];
+} msg_magazine;
+
+typedef struct {
+	nni_list_node node;
+	msg_magazine  mags[MSG_POOL_NCLASS];
+	uint64_t      held;     // bytes in the magazines
+	uint64_t      reserved; // bytes reserved toward the limit, >= held
+	uint64_t      hits;
+	uint64_t      misses;
+	int64_t       retained; // change in bytes retained, unpublished
+} msg_cache;
+
+typedef struct {
+	nni_mtx mtx;
+	void   *free; // linked through the first word of each object
+	size_t  num;
+} msg_depot;
+
+static struct {
+	nni_atomic_bool  enabled;
+	bool             inited;
+	int              cache_size;
+	uint64_t         max_bytes; // limit on retained bytes, 0 if none
+	nni_atomic_u64   bytes;     // reserved by caches, or in depots
+	nni_plat_thr_key key;
+	nni_mtx          mtx; // protects caches
+	nni_list         caches;
+	msg_depot        depots[MSG_POOL_NCLASS];
+#ifdef NNG_ENABLE_STATS
+	nni_stat_item st_root;
+	nni_stat_item st_hits;
+	nni_stat_item st_misses;
+	nni_stat_item st_retained;
+#endif
+} msg_pool;
+
+static size_t
+msg_class_size(int c)
+{
+	if (c == MSG_POOL_MSG) {
+		return (sizeof(nng_msg));
+	}
+	return ((size_t) 1 << (c + MSG_POOL_MIN_SHIFT));
+}
+
+// msg_body_class returns the smallest class that fits the size, or -1.
+static int
+msg_body_class(size_t sz)
+{
+	for (int c = 0; c < MSG_POOL_NBODY; c++) {
+		if (sz <= msg_class_size(c)) {
+			return (c);
+		}
+	}
+	return (-1);
+}
+
+static void
+msg_cache_stats(msg_cache *mc, bool force)
+{
+	if ((!force) && ((mc->hits + mc->misses) < MSG_CACHE_STAT_BATCH)) {
+		return;
+	}
+#ifdef NNG_ENABLE_STATS
+	nni_stat_inc(&msg_pool.st_hits, mc->hits);
+	nni_stat_inc(&msg_pool.st_misses, mc->misses);
+	if (mc->retained > 0) {
+		nni_stat_inc(&msg_pool.st_retained, (uint64_t) mc->retained);
+	} else {
+		nni_stat_dec(&msg_pool.st_retained, (uint64_t) -mc->retained);
+	}
+#endif
+	mc->hits     = 0;
+	mc->misses   = 0;
+	mc->retained = 0;
+}
+
+// Magazines are exchanged with the depot half at a time.
+static unsigned
+msg_magazine_batch(msg_magazine *mag)
+{
+	return (mag->max > 1 ? mag->max / 2 : 1);
+}
+
+// msg_cache_reserve reserves room for sz more bytes in the magazines.
+static bool
+msg_cache_reserve(msg_cache *mc, size_t sz)
+{
+	uint64_t want = sz > MSG_CACHE_RESERVE ? sz : MSG_CACHE_RESERVE;
+	uint64_t old;
+
+	do {
+		old = nni_atomic_get64(&msg_pool.bytes);
+		if ((msg_pool.max_bytes != 0) &&
+		    (old + want > msg_pool.max_bytes)) {
+			// Settle for just what we need, if it fits.
+			want = sz;
+			if (old + want > msg_pool.max_bytes) {
+				return (false);
+			}
+		}
+	} while (!nni_atomic_cas64(&msg_pool.bytes, old, old + want));
+	mc->reserved += want;
+	return (true);
+}
+
+// msg_depot_get refills an empty magazine from the depot.  The objects
+// were already counted in the pool, so they just join our reservation.
+static void
+msg_depot_get(int c, msg_cache *mc)
+{
+	msg_depot    *d    = &msg_pool.depots[c];
+	msg_magazine *mag  = &mc->mags[c];
+	unsigned      want = msg_magazine_batch(mag);
+
+	nni_mtx_lock(&d->mtx);
+	while ((mag->num < want) && (d->free != NULL)) {
+		void *obj             = d->free;
+		d->free               = *(void **) obj;
+		mag->objs[mag->num++] = obj;
+		d->num--;
+	}
+	nni_mtx_unlock(&d->mtx);
+	mc->held += mag->num * msg_class_size(c);
+	mc->reserved += mag->num * msg_class_size(c);
+}
+
+// msg_depot_put moves up to cnt objects from the magazine to the depot,
+// and the reservation for them with them.
+static void
+msg_depot_put(int c, msg_cache *mc, unsigned cnt)
+{
+	msg_depot    *d   = &msg_pool.depots[c];
+	msg_magazine *mag = &mc->mags[c];
+	size_t        sz  = msg_class_size(c);
+
+	if (cnt > mag->num) {
+		cnt = mag->num;
+	}
+	mc->held -= cnt * sz;
+	mc->reserved -= cnt * sz;
+	nni_mtx_lock(&d->mtx);
+	while (cnt-- > 0) {
+		void *obj       = mag->objs[--mag->num];
+		*(void **) obj = d->free;
+		d->free         = obj;
+		d->num++;
+	}
+	nni_mtx_unlock(&d->mtx);
+}
+
+static void
+msg_cache_drain(msg_cache *mc)
+{
+	for (int c = 0; c < MSG_POOL_NCLASS; c++) {
+		msg_depot_put(c, mc, mc->mags[c].num);
+	}
+	nni_atomic_sub64(&msg_pool.bytes, mc->reserved);
+	mc->reserved = 0;
+	msg_cache_stats(mc, true);
+}
+
+// msg_cache_fini is called when a thread with a cache exits.
+static void
+msg_cache_fini(void *arg)
+{
+	msg_cache *mc = arg;
+
+	nni_mtx_lock(&msg_pool.mtx);
+	nni_list_node_remove(&mc->node);
+	nni_mtx_unlock(&msg_pool.mtx);
+	msg_cache_drain(mc);
+	NNI_FREE_STRUCT(mc);
+}
+
+static msg_cache *
+msg_cache_self(void)
+{
+	msg_cache *mc;
+
+	if ((mc = nni_plat_thr_key_get(&msg_pool.key)) != NULL) {
+		return (mc);
+	}
+	if ((mc = NNI_ALLOC_STRUCT(mc)) == NULL) {
+		return (NULL);
+	}
+	for (int c = 0; c < MSG_POOL_NCLASS; c++) {
+		size_t max = MSG_CACHE_BYTES / msg_class_size(c);
+		if (max > (size_t) msg_pool.cache_size) {
+			max = (size_t) msg_pool.cache_size;
+		}
+		mc->mags[c].max = max > 0 ? (unsigned) max : 1;
+	}
+	if (nni_plat_thr_key_set(&msg_pool.key, mc) != 0) {
+		NNI_FREE_STRUCT(mc);
+		return (NULL);
+	}
+	nni_mtx_lock(&msg_pool.mtx);
+	nni_list_append(&msg_pool.caches, mc);
+	nni_mtx_unlock(&msg_pool.mtx);
+	return (mc);
+}
+
+// msg_pool_alloc returns an uninitialized object of the given class.
+static void *
+msg_pool_alloc(int c)
+{
+	msg_cache    *mc;
+	msg_magazine *mag;
+
+	if (nni_atomic_get_bool(&msg_pool.enabled) &&
+	    ((mc = msg_cache_self()) != NULL)) {
+		mag = &mc->mags[c];
+		if (mag->num == 0) {
+			msg_depot_get(c, mc);
+		}
+		if (mag->num > 0) {
+			mc->held -= msg_class_size(c);
+			mc->hits++;
+			mc->retained -= (int64_t) msg_class_size(c);
+			msg_cache_stats(mc, false);
+			return (mag->objs[--mag->num]);
+		}
+		mc->misses++;
+		msg_cache_stats(mc, false);
+	}
+	return (nni_alloc(msg_class_size(c)));
+}
+
+static void
+msg_pool_free(int c, void *obj)
+{
+	msg_cache    *mc;
+	msg_magazine *mag;
+
+	if (nni_atomic_get_bool(&msg_pool.enabled) &&
+	    ((mc = msg_cache_self()) != NULL)) {
+		size_t sz = msg_class_size(c);
+
+		mag = &mc->mags[c];
+		if (mag->num == mag->max) {
+			msg_depot_put(c, mc, msg_magazine_batch(mag));
+		}
+		if ((mc->held + sz <= mc->reserved) ||
+		    msg_cache_reserve(mc, sz)) {
+			mag->objs[mag->num++] = obj;
+			mc->held += sz;
+			mc->retained += (int64_t) sz;
+			return;
+		}
+	}
+	nni_free(obj, msg_class_size(c));
+}
+
+nng_err
+nni_msg_sys_init(nng_init_params *params)
+{
+	int rv;
+#ifdef NNG_ENABLE_STATS
+	static const nni_stat_info root_info = {
+		.si_name = "msgpool",
+		.si_desc = "message pool statistics",
+		.si_type = NNG_STAT_SCOPE,
+	};
+	static const nni_stat_info hits_info = {
+		.si_name   = "hits",
+		.si_desc   = "allocations satisfied from the pool",
+		.si_type   = NNG_STAT_COUNTER,
+		.si_atomic = true,
+	};
+	static const nni_stat_info misses_info = {
+		.si_name   = "misses",
+		.si_desc   = "allocations not satisfied from the pool",
+		.si_type   = NNG_STAT_COUNTER,
+		.si_atomic = true,
+	};
+	static const nni_stat_info retained_info = {
+		.si_name   = "retained",
+		.si_desc   = "memory retained for reuse",
+		.si_type   = NNG_STAT_LEVEL,
+		.si_unit   = NNG_UNIT_BYTES,
+		.si_atomic = true,
+	};
+#endif
+
+	if (params->num_msg_cache < 0) {
+		return (NNG_OK); // disabled
+	}
+	if ((rv = nni_plat_thr_key_init(&msg_pool.key, msg_cache_fini)) !=
+	    0) {
+		return (rv);
+	}
+	msg_pool.cache_size = params->num_msg_cache;
+	msg_pool.max_bytes  = params->max_msg_pool_kb < 0
+	     ? 0
+	     : (uint64_t) params->max_msg_pool_kb * 1024;
+	nni_atomic_init64(&msg_pool.bytes);
+	nni_atomic_init_bool(&msg_pool.enabled);
+	nni_mtx_init(&msg_pool.mtx);
+	NNI_LIST_INIT(&msg_pool.caches, msg_cache, node);
+	for (int c = 0; c < MSG_POOL_NCLASS; c++) {
+		nni_mtx_init(&msg_pool.depots[c].mtx);
+		msg_pool.depots[c].free = NULL;
+		msg_pool.depots[c].num  = 0;
+	}
+
+#ifdef NNG_ENABLE_STATS
+	nni_stat_init(&msg_pool.st_root, &root_info);
+	nni_stat_init(&msg_pool.st_hits, &hits_info);
+	nni_stat_init(&msg_pool.st_misses, &misses_info);
+	nni_stat_init(&msg_pool.st_retained, &retained_info);
+	nni_stat_add(&msg_pool.st_root, &msg_pool.st_hits);
+	nni_stat_add(&msg_pool.st_root, &msg_pool.st_misses);
+	nni_stat_add(&msg_pool.st_root, &msg_pool.st_retained);
+	nni_stat_register(&msg_pool.st_root);
+#endif
+
+	msg_pool.inited = true;
+	nni_atomic_set_bool(&msg_pool.enabled, true);
+	return (NNG_OK);
+}
+
+void
+nni_msg_sys_fini(void)
+{
+	msg_cache *mc;
+
+	if (!msg_pool.inited) {
+		return;
+	}
+	nni_atomic_set_bool(&msg_pool.enabled, false);
+
+	// On some platforms this drains the caches of running threads.
+	nni_plat_thr_key_fini(&msg_pool.key);
+
+	nni_mtx_lock(&msg_pool.mtx);
+	while ((mc = nni_list_first(&msg_pool.caches)) != NULL) {
+		nni_list_remove(&msg_pool.caches, mc);
+		msg_cache_drain(mc);
+		NNI_FREE_STRUCT(mc);
+	}
+	nni_mtx_unlock(&msg_pool.mtx);
+
+	for (int c = 0; c < MSG_POOL_NCLASS; c++) {
+		msg_depot *d = &msg_pool.depots[c];
+		while (d->free != NULL) {
+			void *obj = d->free;
+			d->free   = *(void **) obj;
+			nni_free(obj, msg_class_size(c));
+		}
+		d->num = 0;
+		nni_mtx_fini(&d->mtx);
+	}
+#ifdef NNG_ENABLE_STATS
+	nni_stat_unregister(&msg_pool.st_root);
+#endif
+	nni_mtx_fini(&msg_pool.mtx);
+	msg_pool.inited = false;
+}
+
+// nni_chunk_alloc allocates an uninitialized buffer of at least the given
+// size, returning the actual capacity.
+static uint8_t *
+nni_chunk_alloc(size_t sz, size_t *capp)
+{
+	int c;
+
+	if (nni_atomic_get_bool(&msg_pool.enabled) &&
+	    ((c = msg_body_class(sz)) >= 0)) {
+		*capp = msg_class_size(c);
+		return (msg_pool_alloc(c));
+	}
+	*capp = sz;
+	return (nni_alloc(sz));
+}
+
+static void
+nni_chunk_release(uint8_t *buf, size_t cap)
+{
+	int c;
+
+	if (((c = msg_body_class(cap)) >= 0) && (msg_class_size(c) == cap)) {
+		msg_pool_free(c, buf);
+	} else {
+		nni_free(buf, cap);
+	}
+}
+
 #if 0
 static void
 nni_chunk_dump(const nni_chunk *chunk, char *prefix)
@@ -96,6 +521,7 @@ static int
 nni_chunk_grow(nni_chunk *ch, size_t newsz, size_t headwanted)
 {
 	uint8_t *newbuf;
+	size_t   cap;
 
 	// We assume that if the pointer is a valid pointer, and inside
 	// the backing store, then the entire data length fits.  In this
@@ -129,17 +555,18 @@ nni_chunk_grow(nni_chunk *ch, size_t newsz, size_t headwanted)
 			newsz = ch->ch_cap - headroom;
 		}
 
-		if ((newbuf = nni_zalloc(newsz + headwanted)) == NULL) {
+		if ((newbuf = nni_chunk_alloc(newsz + headwanted, &cap)) ==
+		    NULL) {
 			return (NNG_ENOMEM);
 		}
 		// Copy all the data, but not header or trailer.
 		if (ch->ch_len > 0) {
 			memcpy(newbuf + headwanted, ch->ch_ptr, ch->ch_len);
 		}
-		nni_free(ch->ch_buf, ch->ch_cap);
+		nni_chunk_release(ch->ch_buf, ch->ch_cap);
 		ch->ch_buf = newbuf;
 		ch->ch_ptr = newbuf + headwanted;
-		ch->ch_cap = newsz + headwanted;
+		ch->ch_cap = cap;
 		return (0);
 	}
 
@@ -147,11 +574,14 @@ nni_chunk_grow(nni_chunk *ch, size_t newsz, size_t headwanted)
 	// the backing store.  In this case, we just check against the
 	// allocated capacity and grow, or don't grow.
 	if ((newsz + headwanted) >= ch->ch_cap) {
-		if ((newbuf = nni_zalloc(newsz + headwanted)) == NULL) {
+		if ((newbuf = nni_chunk_alloc(newsz + headwanted, &cap)) ==
+		    NULL) {
 			return (NNG_ENOMEM);
 		}
-		nni_free(ch->ch_buf, ch->ch_cap);
-		ch->ch_cap = newsz + headwanted;
+		if (ch->ch_buf != NULL) {
+			nni_chunk_release(ch->ch_buf, ch->ch_cap);
+		}
+		ch->ch_cap = cap;
 		ch->ch_buf = newbuf;
 	}
 
@@ -163,7 +593,7 @@ static void
 nni_chunk_free(nni_chunk *ch)
 {
 	if ((ch->ch_cap != 0) && (ch->ch_buf != NULL)) {
-		nni_free(ch->ch_buf, ch->ch_cap);
+		nni_chunk_release(ch->ch_buf, ch->ch_cap);
 	}
 	ch->ch_ptr = NULL;
 	ch->ch_buf = NULL;
@@ -210,10 +640,10 @@ nni_chunk_trim(nni_chunk *ch, size_t len)
 static int
 nni_chunk_dup(nni_chunk *dst, const nni_chunk *src)
 {
-	if ((dst->ch_buf = nni_zalloc(src->ch_cap)) == NULL) {
+	if ((dst->ch_buf = nni_chunk_alloc(src->ch_cap, &dst->ch_cap)) ==
+	    NULL) {
 		return (NNG_ENOMEM);
 	}
-	dst->ch_cap = src->ch_cap;
 	dst->ch_len = src->ch_len;
 	dst->ch_ptr = dst->ch_buf + (src->ch_ptr - src->ch_buf);
 	if (dst->ch_len > 0) {
@@ -224,7 +654,7 @@ nni_chunk_dup(nni_chunk *dst, const nni_chunk *src)
 
 // nni_chunk_append appends the data to the chunk, growing as necessary.
 // If the data pointer is NULL, then the chunk data region is allocated,
-// but uninitialized.
+// and zeroed.
 static int
 nni_chunk_append(nni_chunk *ch, const void *data, size_t len)
 {
@@ -241,6 +671,9 @@ nni_chunk_append(nni_chunk *ch, const void *data, size_t len)
 	}
 	if (data != NULL) {
 		memcpy(ch->ch_ptr + ch->ch_len, data, len);
+	} else {
+		// Buffers may be recycled, so never expose stale data.
+		memset(ch->ch_ptr + ch->ch_len, 0, len);
 	}
 	ch->ch_len += len;
 	return (0);
@@ -397,9 +830,10 @@ nni_msg_alloc(nni_msg **mp, size_t sz)
 	nni_msg *m;
 	int      rv;
 
-	if ((m = NNI_ALLOC_STRUCT(m)) == NULL) {
+	if ((m = msg_pool_alloc(MSG_POOL_MSG)) == NULL) {
 		return (NNG_ENOMEM);
 	}
+	memset(m, 0, sizeof(*m));
 
 	// If the message is less than 1024 bytes, or is not power
 	// of two aligned, then we insert a 32 bytes of headroom
@@ -412,7 +846,7 @@ nni_msg_alloc(nni_msg **mp, size_t sz)
 		rv = nni_chunk_grow(&m->m_body, sz, 0);
 	}
 	if (rv != 0) {
-		NNI_FREE_STRUCT(m);
+		msg_pool_free(MSG_POOL_MSG, m);
 		return (rv);
 	}
 	if (nni_chunk_append(&m->m_body, NULL, sz) != 0) {
@@ -433,15 +867,16 @@ nni_msg_dup(nni_msg **dup, const nni_msg *src)
 	nni_msg *m;
 	int      rv;
 
-	if ((m = NNI_ALLOC_STRUCT(m)) == NULL) {
+	if ((m = msg_pool_alloc(MSG_POOL_MSG)) == NULL) {
 		return (NNG_ENOMEM);
 	}
+	memset(m, 0, sizeof(*m));
 
 	memcpy(m->m_header_buf, src->m_header_buf, src->m_header_len);
 	m->m_header_len = src->m_header_len;
 
 	if ((rv = nni_chunk_dup(&m->m_body, &src->m_body)) != 0) {
-		NNI_FREE_STRUCT(m);
+		msg_pool_free(MSG_POOL_MSG, m);
 		return (rv);
 	}
 
@@ -458,7 +893,7 @@ nni_msg_free(nni_msg *m)
 {
 	if ((m != NULL) && (nni_atomic_dec_nv(&m->m_refcnt) == 0)) {
 		nni_chunk_free(&m->m_body);
-		NNI_FREE_STRUCT(m);
+		msg_pool_free(MSG_POOL_MSG, m);
 	}
 }
 
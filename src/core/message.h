@@ -16,6 +16,8 @@
 // Internally used message API.  Again, this is not part of our public API.
 // "trim" operations work from the front, and "chop" work from the end.
 
+extern nng_err  nni_msg_sys_init(nng_init_params *);
+extern void     nni_msg_sys_fini(void);
 extern int      nni_msg_alloc(nni_msg **, size_t);
 extern void     nni_msg_free(nni_msg *);
 extern int      nni_msg_realloc(nni_msg *, size_t);
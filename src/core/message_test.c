@@ -516,7 +516,7 @@ test_msg_reserve(void)
 	body = nng_msg_body(msg);
 	NUTS_PASS(nng_msg_reserve(msg, 64));
 	NUTS_ASSERT(nng_msg_len(msg) == 4);
-	NUTS_ASSERT(nng_msg_capacity(msg) == 64);
+	NUTS_ASSERT(nng_msg_capacity(msg) >= 64); // rounded to size class
 	NUTS_ASSERT(body != nng_msg_body(msg));
 	NUTS_ASSERT(memcmp(nng_msg_body(msg), "abc", 4) == 0);
 	nng_msg_free(msg);
@@ -539,6 +539,83 @@ test_msg_insert_stress(void)
 	}
 }
 
+void
+test_msg_pool_reuse(void)
+{
+	nng_msg *msg;
+	uint8_t *body;
+
+	// Recycled bodies must never leak old contents.
+	for (int i = 0; i < 100; i++) {
+		NUTS_PASS(nng_msg_alloc(&msg, 100));
+		body = nng_msg_body(msg);
+		for (int j = 0; j < 100; j++) {
+			NUTS_ASSERT(body[j] == 0);
+		}
+		memset(body, 0xaa, 100);
+		NUTS_PASS(nng_msg_realloc(msg, 50));
+		NUTS_PASS(nng_msg_realloc(msg, 100));
+		for (int j = 50; j < 100; j++) {
+			NUTS_ASSERT(body[j] == 0);
+		}
+		nng_msg_free(msg);
+	}
+}
+
+#ifdef NNG_ENABLE_STATS
+static uint64_t
+msg_pool_stat(const char *name)
+{
+	nng_stat       *stats;
+	const nng_stat *st;
+	uint64_t        val;
+
+	NUTS_PASS(nng_stats_get(&stats));
+	NUTS_TRUE((st = nng_stat_find(stats, "msgpool")) != NULL);
+	NUTS_TRUE((st = nng_stat_find(st, name)) != NULL);
+	val = nng_stat_value(st);
+	nng_stats_free(stats);
+	return (val);
+}
+
+static void
+msg_pool_worker(void *arg)
+{
+	nng_msg *msgs[16];
+
+	(void) arg;
+	for (int i = 0; i < 1000; i++) {
+		for (int j = 0; j < 16; j++) {
+			NUTS_PASS(nng_msg_alloc(&msgs[j], (size_t) j * 100));
+		}
+		for (int j = 0; j < 16; j++) {
+			nng_msg_free(msgs[j]);
+		}
+	}
+}
+
+void
+test_msg_pool_stats(void)
+{
+	nng_thread *thr;
+	uint64_t    hits;
+	uint64_t    misses;
+
+	hits   = msg_pool_stat("hits");
+	misses = msg_pool_stat("misses");
+
+	// Statistics are published in batches, and when the thread
+	// exits, so do the work on a separate thread.
+	NUTS_PASS(nng_thread_create(&thr, msg_pool_worker, NULL));
+	nng_thread_destroy(thr);
+
+	// 16000 messages and 16000 bodies, nearly all recycled.
+	NUTS_TRUE(msg_pool_stat("hits") - hits > 31000);
+	NUTS_TRUE(msg_pool_stat("misses") - misses < 1000);
+	NUTS_TRUE(msg_pool_stat("retained") > 0);
+}
+#endif
+
 TEST_LIST = {
 	{ "msg option", test_msg_option },
 	{ "msg empty", test_msg_empty },
@@ -567,5 +644,9 @@ TEST_LIST = {
 	{ "msg capacity", test_msg_capacity },
 	{ "msg reserve", test_msg_reserve },
 	{ "msg insert stress", test_msg_insert_stress },
+	{ "msg pool reuse", test_msg_pool_reuse },
+#ifdef NNG_ENABLE_STATS
+	{ "msg pool stats", test_msg_pool_stats },
+#endif
 	{ NULL, NULL },
 };
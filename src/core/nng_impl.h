@@ -46,6 +46,7 @@
 #include "core/strs.h"
 #include "core/taskq.h"
 #include "core/thread.h"
+#include "core/trie.h"
 #include "core/url.h"
 
 // transport needs to come after url
@@ -40,6 +40,12 @@ pipe_destroy(void *arg)
 	p->p_proto_ops.pipe_fini(p->p_proto_data);
 	p->p_tran_ops.p_fini(p->p_tran_data);
 
+#ifdef NNG_ENABLE_STATS
+	nni_stat_fini(&p->st_rx_msgs);
+	nni_stat_fini(&p->st_tx_msgs);
+	nni_stat_fini(&p->st_rx_bytes);
+	nni_stat_fini(&p->st_tx_bytes);
+#endif
 	nni_free(p, p->p_size);
 }
 
@@ -183,6 +189,7 @@ pipe_stats_init(nni_pipe *p)
 		.si_type   = NNG_STAT_COUNTER,
 		.si_unit   = NNG_UNIT_MESSAGES,
 		.si_atomic = true,
+		.si_shard  = true,
 	};
 	static const nni_stat_info tx_msgs_info = {
 		.si_name   = "tx_msgs",
@@ -190,6 +197,7 @@ pipe_stats_init(nni_pipe *p)
 		.si_type   = NNG_STAT_COUNTER,
 		.si_unit   = NNG_UNIT_MESSAGES,
 		.si_atomic = true,
+		.si_shard  = true,
 	};
 	static const nni_stat_info rx_bytes_info = {
 		.si_name   = "rx_bytes",
@@ -197,6 +205,7 @@ pipe_stats_init(nni_pipe *p)
 		.si_type   = NNG_STAT_COUNTER,
 		.si_unit   = NNG_UNIT_BYTES,
 		.si_atomic = true,
+		.si_shard  = true,
 	};
 	static const nni_stat_info tx_bytes_info = {
 		.si_name   = "tx_bytes",
@@ -204,6 +213,7 @@ pipe_stats_init(nni_pipe *p)
 		.si_type   = NNG_STAT_COUNTER,
 		.si_unit   = NNG_UNIT_BYTES,
 		.si_atomic = true,
+		.si_shard  = true,
 	};
 	static const nni_stat_info dialer_info = {
 		.si_name = "dialer",
@@ -88,6 +88,7 @@ extern void nni_free(void *, size_t);
 typedef struct nni_plat_mtx nni_plat_mtx;
 typedef struct nni_plat_cv  nni_plat_cv;
 typedef struct nni_plat_thr nni_plat_thr;
+typedef struct nni_plat_thr_key nni_plat_thr_key;
 
 //
 // Threading & Synchronization Support
@@ -159,6 +160,25 @@ extern bool nni_plat_thr_is_self(nni_plat_thr *);
 // this is intended to facilitate debugging.
 extern void nni_plat_thr_set_name(nni_plat_thr *, const char *);
 
+// nni_plat_thr_key_init creates a key for thread specific data.  Each
+// thread has its own value for the key, which starts out NULL.  When a
+// thread exits with a non-NULL value, the destructor (if not NULL) is
+// called on that thread with the value.
+extern int nni_plat_thr_key_init(nni_plat_thr_key *, void (*)(void *));
+
+// nni_plat_thr_key_fini destroys the key.  Depending on the platform,
+// this may or may not call the destructor for values belonging to
+// threads that are still running, so callers must be prepared to reclaim
+// those values themselves, and must tolerate the destructor being called
+// from this function.
+extern void nni_plat_thr_key_fini(nni_plat_thr_key *);
+
+// nni_plat_thr_key_get returns the calling thread's value for the key.
+extern void *nni_plat_thr_key_get(nni_plat_thr_key *);
+
+// nni_plat_thr_key_set sets the calling thread's value for the key.
+extern int nni_plat_thr_key_set(nni_plat_thr_key *, void *);
+
 //
 // Atomics support.  This will evolve over time.
 //
@@ -221,6 +241,11 @@ extern int  nni_atomic_dec_nv(nni_atomic_int *);
 extern void nni_atomic_dec(nni_atomic_int *);
 extern void nni_atomic_inc(nni_atomic_int *);
 
+// nni_atomic_inc_nv increments with relaxed order, returning the new
+// value.  It is meant for counters where only the value matters, such
+// as handing out slots in turn.
+extern int nni_atomic_inc_nv(nni_atomic_int *);
+
 // nni_atomic_cas is a compare and swap.  The second argument is the
 // value to compare against, and the third is the new value. Returns
 // true if the value was set.
@@ -271,6 +296,12 @@ extern void nni_plat_fini(void);
 // used to scale the number of independent threads started.
 extern int nni_plat_ncpu(void);
 
+// nni_plat_cpu returns the number of the CPU the calling thread is
+// running on.  This is only a hint, as the thread may be moved at any
+// time, and it is used to spread updates to shared counters.  Platforms
+// that cannot tell may return any value that is stable for a thread.
+extern int nni_plat_cpu(void);
+
 //
 // TCP Support.
 //
@@ -376,6 +407,31 @@ extern void nni_plat_udp_send(nni_plat_udp *, nni_aio *);
 // NNG_EMSGSIZE results.
 extern void nni_plat_udp_recv(nni_plat_udp *, nni_aio *);
 
+// nni_udp_dgram describes a single datagram for batched UDP I/O.
+#define NNI_UDP_DGRAM_IOV 4
+typedef struct nni_udp_dgram {
+	nni_iov      ud_iov[NNI_UDP_DGRAM_IOV]; // datagram buffers
+	unsigned     ud_niov;                   // number of buffers in use
+	size_t       ud_len;                    // bytes sent or received
+	nni_sockaddr ud_addr; // destination (send) or source (recv)
+} nni_udp_dgram;
+
+// nni_plat_udp_recv_batch receives up to the given number of datagrams,
+// using as few system calls as the platform permits.  The operation
+// completes once at least one datagram has been received, and the count
+// of the aio is the number of datagrams received.  The aio's own iovs
+// and inputs are not used, and may be changed.
+extern void nni_plat_udp_recv_batch(
+    nni_plat_udp *, nni_udp_dgram *, unsigned, nni_aio *);
+
+// nni_plat_udp_send_batch sends the given datagrams, using as few
+// system calls as the platform permits.  A datagram that cannot be sent
+// because of an error is dropped (its length is set to zero), and the
+// most recent such error is the result.  The count of the aio is the
+// number of datagrams sent or dropped.
+extern void nni_plat_udp_send_batch(
+    nni_plat_udp *, nni_udp_dgram *, unsigned, nni_aio *);
+
 // nni_plat_udp_membership provides for joining or leaving multicast groups.
 extern int nni_plat_udp_multicast_membership(
     nni_plat_udp *udp, nni_sockaddr *sa, bool join);
@@ -153,6 +153,11 @@ struct nni_proto {
 #define NNI_PROTO_FLAG_SNDRCV 3u // Protocol can both send & recv
 #define NNI_PROTO_FLAG_RAW 4u    // Protocol is raw
 
+// NNI_PROTO_FLAG_SPLIT indicates that the protocol accepts received messages
+// whose header is still separate from the body, so transports that carry
+// the header apart (inproc) need not copy it back into the body.
+#define NNI_PROTO_FLAG_SPLIT 8u
+
 // nni_proto_open is called by the protocol to create a socket instance
 // with its ops vector.  The intent is that applications will only see
 // the single protocol-specific constructor, like nng_pair_v0_open(),
@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -431,6 +431,7 @@ sock_stats_init(nni_sock *s)
 		.si_type   = NNG_STAT_COUNTER,
 		.si_unit   = NNG_UNIT_MESSAGES,
 		.si_atomic = true,
+		.si_shard  = true,
 	};
 	static const nni_stat_info rx_msgs_info = {
 		.si_name   = "rx_msgs",
@@ -438,6 +439,7 @@ sock_stats_init(nni_sock *s)
 		.si_type   = NNG_STAT_COUNTER,
 		.si_unit   = NNG_UNIT_MESSAGES,
 		.si_atomic = true,
+		.si_shard  = true,
 	};
 	static const nni_stat_info tx_bytes_info = {
 		.si_name   = "tx_bytes",
@@ -445,6 +447,7 @@ sock_stats_init(nni_sock *s)
 		.si_type   = NNG_STAT_COUNTER,
 		.si_unit   = NNG_UNIT_BYTES,
 		.si_atomic = true,
+		.si_shard  = true,
 	};
 	static const nni_stat_info rx_bytes_info = {
 		.si_name   = "rx_bytes",
@@ -452,6 +455,7 @@ sock_stats_init(nni_sock *s)
 		.si_type   = NNG_STAT_COUNTER,
 		.si_unit   = NNG_UNIT_BYTES,
 		.si_atomic = true,
+		.si_shard  = true,
 	};
 
 	// To make collection cheap and atomic for the socket,
@@ -492,6 +496,12 @@ sock_destroy(nni_sock *s)
 	nni_cv_fini(&s->s_cv);
 	nni_mtx_fini(&s->s_mx);
 	nni_mtx_fini(&s->s_pipe_cbs_mtx);
+#ifdef NNG_ENABLE_STATS
+	nni_stat_fini(&s->st_tx_msgs);
+	nni_stat_fini(&s->st_rx_msgs);
+	nni_stat_fini(&s->st_tx_bytes);
+	nni_stat_fini(&s->st_rx_bytes);
+#endif
 	nni_free(s, s->s_size);
 }
 
@@ -1276,14 +1286,74 @@ nni_dialer_timer_start(nni_dialer *d)
 	nni_mtx_unlock(&s->s_mx);
 }
 
+// dialer_redial_locked starts another connect, unless one is already
+// outstanding or the dialer has all the pipes it wants.  The transports
+// only have one connect at a time in flight, so the pipes of a striped
+// dialer are dialed one after the other.
+static void
+dialer_redial_locked(nni_dialer *d, bool back_off)
+{
+	if (d->d_dialing || (d->d_npipes >= d->d_stripes)) {
+		return;
+	}
+	d->d_dialing = true;
+	if (back_off) {
+		dialer_timer_start_locked(d);
+	} else {
+		nni_sleep_aio(0, &d->d_tmo_aio);
+	}
+}
+
+void
+nni_dialer_set_pipes(nni_dialer *d, int n)
+{
+	nni_sock *s = d->d_sock;
+	nni_pipe *p;
+	int       kept = 0;
+
+	nni_mtx_lock(&s->s_mx);
+	d->d_stripes = n;
+	// Close any pipes beyond the new count.  They stay counted until
+	// they are removed, so they will not be redialed.
+	NNI_LIST_FOREACH (&d->d_pipes, p) {
+		if (p->p_dialed && (++kept > n)) {
+			nni_pipe_close(p);
+		}
+	}
+	// Until it has connected once, the dialer is not ours to start.
+	if (d->d_npipes > 0) {
+		dialer_redial_locked(d, false);
+	}
+	nni_mtx_unlock(&s->s_mx);
+}
+
+int
+nni_dialer_get_pipes(nni_dialer *d)
+{
+	nni_sock *s = d->d_sock;
+	int       n;
+
+	nni_mtx_lock(&s->s_mx);
+	n = d->d_stripes;
+	nni_mtx_unlock(&s->s_mx);
+	return (n);
+}
+
 static void
 dialer_start_pipe(nni_dialer *d, nni_pipe *p)
 {
 	nni_sock *s = d->d_sock;
+	bool      surplus;
 
 	nni_mtx_lock(&s->s_mx);
-	d->d_pipe     = p;
+	d->d_dialing  = false;
 	d->d_currtime = d->d_inirtime;
+	// The pipe count may have been lowered while this was dialed.
+	if (!(surplus = (d->d_npipes >= d->d_stripes))) {
+		p->p_dialed = true;
+		d->d_npipes++;
+	}
+	dialer_redial_locked(d, false);
 	nni_mtx_unlock(&s->s_mx);
 
 #ifdef NNG_ENABLE_STATS
@@ -1291,6 +1361,12 @@ dialer_start_pipe(nni_dialer *d, nni_pipe *p)
 	nni_stat_inc(&d->st_pipes, 1);
 #endif
 
+	if (surplus) {
+		nni_pipe_close(p);
+		nni_pipe_rele(p);
+		return;
+	}
+
 	nni_pipe_run_cb(p, NNG_PIPE_EV_ADD_PRE);
 
 	if (nni_pipe_is_closed(p)) {
@@ -1604,9 +1680,10 @@ nni_pipe_remove(nni_pipe *p)
 #endif
 	nni_list_node_remove(&p->p_sock_node);
 	nni_list_node_remove(&p->p_ep_node);
-	if ((d != NULL) && (d->d_pipe == p)) {
-		d->d_pipe = NULL;
-		dialer_timer_start_locked(d); // Kick the timer to redial.
+	if ((d != NULL) && p->p_dialed) {
+		p->p_dialed = false;
+		d->d_npipes--;
+		dialer_redial_locked(d, true); // Kick the timer to redial.
 	}
 	nni_cv_wake(&s->s_cv);
 	nni_mtx_unlock(&s->s_mx);
@@ -36,7 +36,9 @@ struct nni_dialer {
 	uint32_t          d_id;   // endpoint id
 	nni_list_node     d_node; // per socket list
 	nni_sock         *d_sock;
-	nni_pipe         *d_pipe; // active pipe (for re-dialer)
+	int               d_npipes;  // pipes counted toward d_stripes
+	int               d_stripes; // pipes to keep
+	bool              d_dialing; // connect or back-off outstanding
 	int               d_ref;
 	bool              d_closed; // full shutdown
 	nni_atomic_flag   d_closing;
@@ -117,6 +119,7 @@ struct nni_pipe {
 	nni_dialer        *p_dialer;
 	nni_listener      *p_listener;
 	nni_atomic_bool    p_closed;
+	bool               p_dialed; // counted among the dialer's pipes
 	nni_atomic_flag    p_stop;
 	nni_reap_node      p_reap;
 	nni_refcnt         p_refcnt;
@@ -143,6 +146,8 @@ extern void nni_dialer_shutdown(nni_dialer *);
 extern void nni_dialer_reap(nni_dialer *);
 extern void nni_dialer_destroy(nni_dialer *);
 extern void nni_dialer_timer_start(nni_dialer *);
+extern void nni_dialer_set_pipes(nni_dialer *, int);
+extern int  nni_dialer_get_pipes(nni_dialer *);
 extern void nni_dialer_stop(nni_dialer *);
 
 extern void nni_listener_start_pipe(nni_listener *, nni_pipe *);
@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -46,6 +46,112 @@ static nni_stat_item stats_root = {
 };
 static nni_mtx stats_lock     = NNI_MTX_INITIALIZER;
 static nni_mtx stats_val_lock = NNI_MTX_INITIALIZER;
+
+// The shard arena holds the per-CPU copies of sharded counters.  It is
+// made of blocks, each holding STAT_CHUNK slots for every shard, laid
+// out shard major.  That way the counters updated on a given CPU are
+// packed together, and never share a cache line with those of another
+// CPU.  Blocks are never freed until the library is finalized; slots
+// are recycled through a free list.  The arena has its own lock so that
+// stats may be initialized while holding other locks.
+#define STAT_CHUNK 512
+#define STAT_BLOCKS 4096
+#define STAT_SHARDS_MAX 64
+
+static nni_atomic_u64 *stat_blocks[STAT_BLOCKS];
+static uint32_t       *stat_free;    // free slots, as a stack
+static uint32_t        stat_nfree;   // number of free slots
+static uint32_t        stat_nslots;  // number of slots in blocks
+static uint32_t        stat_nshards; // power of two, 0 until first used
+static nni_mtx         stat_shard_lock = NNI_MTX_INITIALIZER;
+
+static inline nni_atomic_u64 *
+stat_shard(uint32_t slot, uint32_t shard)
+{
+	slot--;
+	return (&stat_blocks[slot / STAT_CHUNK]
+	                    [shard * STAT_CHUNK + slot % STAT_CHUNK]);
+}
+
+// stat_shard_local returns the copy of the counter for the current CPU.
+static inline nni_atomic_u64 *
+stat_shard_local(const nni_stat_item *item)
+{
+	uint32_t shard = (uint32_t) nni_plat_cpu() & (stat_nshards - 1);
+	return (stat_shard(item->si_slot, shard));
+}
+
+static uint64_t
+stat_shard_sum(const nni_stat_item *item)
+{
+	uint64_t sum = 0;
+	for (uint32_t i = 0; i < stat_nshards; i++) {
+		sum += nni_atomic_get64(stat_shard(item->si_slot, i));
+	}
+	return (sum);
+}
+
+static void
+stat_shard_clear(uint32_t slot)
+{
+	for (uint32_t i = 0; i < stat_nshards; i++) {
+		nni_atomic_set64(stat_shard(slot, i), 0);
+	}
+}
+
+// stat_shard_alloc returns a slot (plus one), or zero if the stat
+// should not (or cannot) be sharded.
+static uint32_t
+stat_shard_alloc(void)
+{
+	uint32_t slot;
+
+	nni_mtx_lock(&stat_shard_lock);
+	if (stat_nshards == 0) {
+		uint32_t ncpu = (uint32_t) nni_plat_ncpu();
+		stat_nshards  = 1;
+		while ((stat_nshards < ncpu) &&
+		    (stat_nshards < STAT_SHARDS_MAX)) {
+			stat_nshards *= 2;
+		}
+	}
+	if (stat_nshards == 1) {
+		// Nothing to be gained on a single CPU.
+		nni_mtx_unlock(&stat_shard_lock);
+		return (0);
+	}
+	if (stat_nfree == 0) {
+		uint32_t        b  = stat_nslots / STAT_CHUNK;
+		size_t          sz = sizeof(nni_atomic_u64) * STAT_CHUNK;
+		nni_atomic_u64 *block;
+		uint32_t       *fl;
+
+		sz *= stat_nshards;
+		if ((b >= STAT_BLOCKS) || ((block = nni_zalloc(sz)) == NULL)) {
+			nni_mtx_unlock(&stat_shard_lock);
+			return (0);
+		}
+		if ((fl = nni_alloc(sizeof(uint32_t) *
+		         (stat_nslots + STAT_CHUNK))) == NULL) {
+			nni_free(block, sz);
+			nni_mtx_unlock(&stat_shard_lock);
+			return (0);
+		}
+		if (stat_free != NULL) {
+			nni_free(stat_free, sizeof(uint32_t) * stat_nslots);
+		}
+		stat_free      = fl;
+		stat_blocks[b] = block;
+		for (uint32_t i = STAT_CHUNK; i > 0; i--) {
+			stat_free[stat_nfree++] = stat_nslots + i;
+		}
+		stat_nslots += STAT_CHUNK;
+	}
+	slot = stat_free[--stat_nfree];
+	stat_shard_clear(slot);
+	nni_mtx_unlock(&stat_shard_lock);
+	return (slot);
+}
 #endif
 
 void
@@ -119,6 +225,9 @@ nni_stat_init_lock(
 	NNI_LIST_INIT(&item->si_children, nni_stat_item, si_node);
 	item->si_info = info;
 	item->si_mtx  = mtx;
+	if (info->si_shard) {
+		item->si_slot = stat_shard_alloc();
+	}
 #else
 	NNI_ARG_UNUSED(item);
 	NNI_ARG_UNUSED(info);
@@ -132,11 +241,89 @@ nni_stat_init(nni_stat_item *item, const nni_stat_info *info)
 	nni_stat_init_lock(item, info, NULL);
 }
 
+void
+nni_stat_fini(nni_stat_item *item)
+{
+#ifdef NNG_ENABLE_STATS
+	if (item->si_slot != 0) {
+		nni_mtx_lock(&stat_shard_lock);
+		stat_free[stat_nfree++] = item->si_slot;
+		nni_mtx_unlock(&stat_shard_lock);
+		item->si_slot = 0;
+	}
+#else
+	NNI_ARG_UNUSED(item);
+#endif
+}
+
+#ifdef NNG_ENABLE_STATS
+// stat_shard_release frees the arena, if no stat holds a slot in it.
+// The shard count is worked out again when it is next used.
+static bool
+stat_shard_release(void)
+{
+	size_t sz = sizeof(nni_atomic_u64) * STAT_CHUNK * stat_nshards;
+
+	if (stat_nfree != stat_nslots) {
+		return (false);
+	}
+	for (uint32_t b = 0; b < stat_nslots / STAT_CHUNK; b++) {
+		nni_free(stat_blocks[b], sz);
+		stat_blocks[b] = NULL;
+	}
+	if (stat_free != NULL) {
+		nni_free(stat_free, sizeof(uint32_t) * stat_nslots);
+	}
+	stat_free    = NULL;
+	stat_nfree   = 0;
+	stat_nslots  = 0;
+	stat_nshards = 0;
+	return (true);
+}
+#endif
+
+void
+nni_stat_sys_fini(void)
+{
+#ifdef NNG_ENABLE_STATS
+	nni_mtx_lock(&stat_shard_lock);
+	// If anything still holds a slot, we have to leave the arena be.
+	(void) stat_shard_release();
+	nni_mtx_unlock(&stat_shard_lock);
+#endif
+}
+
+nng_err
+nni_stat_set_shards(uint32_t n)
+{
+#ifdef NNG_ENABLE_STATS
+	nni_mtx_lock(&stat_shard_lock);
+	if (!stat_shard_release()) {
+		nni_mtx_unlock(&stat_shard_lock);
+		return (NNG_EBUSY);
+	}
+	if (n != 0) {
+		stat_nshards = 1;
+		while ((stat_nshards < n) &&
+		    (stat_nshards < STAT_SHARDS_MAX)) {
+			stat_nshards *= 2;
+		}
+	}
+	nni_mtx_unlock(&stat_shard_lock);
+	return (NNG_OK);
+#else
+	NNI_ARG_UNUSED(n);
+	return (NNG_ENOTSUP);
+#endif
+}
+
 void
 nni_stat_inc(nni_stat_item *item, uint64_t inc)
 {
 #ifdef NNG_ENABLE_STATS
-	if (item->si_info->si_atomic) {
+	if (item->si_slot != 0) {
+		nni_atomic_add64(stat_shard_local(item), inc);
+	} else if (item->si_info->si_atomic) {
 		nni_atomic_add64(&item->si_u.sv_atomic, inc);
 	} else {
 		item->si_u.sv_number += inc;
@@ -151,8 +338,11 @@ void
 nni_stat_dec(nni_stat_item *item, uint64_t inc)
 {
 #ifdef NNG_ENABLE_STATS
-
-	if (item->si_info->si_atomic) {
+	// For sharded stats, an individual shard may wrap below zero, but
+	// the sum of them all will still be correct.
+	if (item->si_slot != 0) {
+		nni_atomic_sub64(stat_shard_local(item), inc);
+	} else if (item->si_info->si_atomic) {
 		nni_atomic_sub64(&item->si_u.sv_atomic, inc);
 	} else {
 		item->si_u.sv_number -= inc;
@@ -222,6 +412,9 @@ void
 nni_stat_set_value(nni_stat_item *item, uint64_t v)
 {
 #ifdef NNG_ENABLE_STATS
+	if (item->si_slot != 0) {
+		stat_shard_clear(item->si_slot);
+	}
 	if (item->si_info->si_atomic) {
 		nni_atomic_set64(&item->si_u.sv_atomic, v);
 	} else {
@@ -316,6 +509,9 @@ stat_update(nni_stat *stat, nni_mtx **mtxp)
 		if (info->si_atomic) {
 			stat->s_val.sv_value = nni_atomic_get64(
 			    (nni_atomic_u64 *) &item->si_u.sv_atomic);
+			if (item->si_slot != 0) {
+				stat->s_val.sv_value += stat_shard_sum(item);
+			}
 		} else {
 			stat->s_val.sv_value = item->si_u.sv_number;
 		}
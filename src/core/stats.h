@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -43,6 +43,7 @@ struct nni_stat_item {
 	nni_list             si_children; // children, framework use only
 	const nni_stat_info *si_info;     // statistic description
 	nni_mtx             *si_mtx;      // protects, if flag in info
+	uint32_t             si_slot;     // shard slot + 1, if sharded
 	union {
 		uint64_t       sv_number;
 		nni_atomic_u64 sv_atomic;
@@ -61,6 +62,7 @@ struct nni_stat_info {
 	bool          si_atomic : 1; // stat is atomic
 	bool          si_alloc : 1;  // stat string is allocated
 	bool          si_lock : 1;   // stat protected by lock (si_mtx)
+	bool          si_shard : 1;  // stat is sharded by CPU (implies atomic)
 };
 
 #ifdef NNG_ENABLE_STATS
@@ -100,4 +102,30 @@ void nni_stat_init_lock(nni_stat_item *, const nni_stat_info *, nni_mtx *);
 void nni_stat_inc(nni_stat_item *, uint64_t);
 void nni_stat_dec(nni_stat_item *, uint64_t);
 
+// nni_stat_fini releases any resources held by a statistic that was
+// initialized with nni_stat_init.  At present this is only needed for
+// sharded statistics (see below), but it is harmless for others, and
+// for items that were never initialized (provided they were zeroed).
+// The item must be unregistered, and must no longer be updated.
+void nni_stat_fini(nni_stat_item *);
+
+// nni_stat_sys_fini releases the shard arena, if nothing is using it.
+void nni_stat_sys_fini(void);
+
+// nni_stat_set_shards is for testing only.  It sets the number of copies
+// kept of each sharded stat (rounded up to a power of two), so that the
+// sharded path can be tested on a single CPU.  Zero restores the default,
+// based on the number of CPUs.  It fails with NNG_EBUSY if any sharded
+// stat is in use.
+nng_err nni_stat_set_shards(uint32_t);
+
+// Sharded statistics.  Counters on hot paths (messages and bytes for
+// sockets and pipes) are bumped by every thread that moves a message,
+// and on large systems the single cache line holding the counter bounces
+// between CPUs.  A stat whose info has si_shard set instead gets a slot
+// in a per-CPU arena; increments go to the copy for the calling CPU,
+// and the copies are only summed when a snapshot is taken.  Such stats
+// must be released with nni_stat_fini.  If no slot can be had (or
+// there is only one CPU), the stat silently behaves as an atomic one.
+
 #endif // CORE_STATS_H
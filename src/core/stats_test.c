@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -8,10 +8,15 @@
 // found online at https://opensource.org/licenses/MIT.
 //
 
+#include "core/nng_impl.h"
+
 #include <nuts.h>
 
 #define SECONDS(x) ((x) *1000)
 
+#define SHARD_THREADS 4
+#define SHARD_BUMPS 10000
+
 void
 test_stats_socket(void)
 {
@@ -79,8 +84,135 @@ test_stats_dump(void)
 #endif
 }
 
+#ifdef NNG_ENABLE_STATS
+static const nni_stat_info shard_info = {
+	.si_name   = "test_sharded",
+	.si_type   = NNG_STAT_COUNTER,
+	.si_atomic = true,
+	.si_shard  = true,
+};
+
+static void
+shard_bump(void *arg)
+{
+	nni_stat_item *item = arg;
+	for (int i = 0; i < SHARD_BUMPS; i++) {
+		nni_stat_inc(item, 1);
+	}
+}
+
+static uint64_t
+shard_value(const char *name)
+{
+	nng_stat       *stats;
+	const nng_stat *item;
+	uint64_t        v;
+
+	NUTS_PASS(nng_stats_get(&stats));
+	NUTS_ASSERT((item = nng_stat_find(stats, name)) != NULL);
+	v = nng_stat_value(item);
+	nng_stats_free(stats);
+	return (v);
+}
+
+// shard_restore puts back the default number of shards.  Pipes release
+// their stats when they are reaped, so this may have to wait for that.
+static void
+shard_restore(void)
+{
+	nng_time end = nng_clock() + 5000;
+
+	while (nni_stat_set_shards(0) == NNG_EBUSY) {
+		NUTS_ASSERT(nng_clock() < end);
+		nng_msleep(10);
+	}
+}
+#endif
+
+// Sharding only happens with more than one CPU, so force it, and check
+// that increments from several threads all add up.
+void
+test_stats_shard_concurrent(void)
+{
+#ifdef NNG_ENABLE_STATS
+	nni_stat_item item;
+	nng_thread   *thrs[SHARD_THREADS];
+	uint64_t      total = SHARD_THREADS * SHARD_BUMPS;
+
+	NUTS_PASS(nni_stat_set_shards(8));
+	nni_stat_init(&item, &shard_info);
+	NUTS_ASSERT(item.si_slot != 0);
+	nni_stat_register(&item);
+
+	for (int i = 0; i < SHARD_THREADS; i++) {
+		NUTS_PASS(nng_thread_create(&thrs[i], shard_bump, &item));
+	}
+	for (int i = 0; i < SHARD_THREADS; i++) {
+		nng_thread_destroy(thrs[i]);
+	}
+	NUTS_ASSERT(shard_value("test_sharded") == total);
+	nni_stat_dec(&item, 1);
+	NUTS_ASSERT(shard_value("test_sharded") == total - 1);
+	nni_stat_set_value(&item, 3);
+	NUTS_ASSERT(shard_value("test_sharded") == 3);
+
+	// The arena cannot be changed while a stat is using it.
+	NUTS_FAIL(nni_stat_set_shards(4), NNG_EBUSY);
+
+	nni_stat_unregister(&item);
+	nni_stat_fini(&item);
+	NUTS_ASSERT(item.si_slot == 0);
+	shard_restore();
+#endif
+}
+
+// A released slot must come back cleared, and sockets and pipes must
+// give back all of their slots when they are closed.
+void
+test_stats_shard_fini(void)
+{
+#ifdef NNG_ENABLE_STATS
+	nni_stat_item   item;
+	nng_socket      s1;
+	nng_socket      s2;
+	nng_stat       *stats;
+	const nng_stat *st;
+
+	NUTS_PASS(nni_stat_set_shards(8));
+	nni_stat_init(&item, &shard_info);
+	nni_stat_inc(&item, 5);
+	nni_stat_fini(&item);
+	nni_stat_init(&item, &shard_info);
+	nni_stat_register(&item);
+	NUTS_ASSERT(shard_value("test_sharded") == 0);
+	nni_stat_unregister(&item);
+	nni_stat_fini(&item);
+	// Finishing twice, or an item that was never sharded, is harmless.
+	nni_stat_fini(&item);
+
+	NUTS_OPEN(s1);
+	NUTS_OPEN(s2);
+	NUTS_MARRY(s1, s2);
+	for (int i = 0; i < 10; i++) {
+		NUTS_SEND(s1, "ping");
+		NUTS_RECV(s2, "ping");
+	}
+	NUTS_PASS(nng_stats_get(&stats));
+	NUTS_ASSERT((st = nng_stat_find_socket(stats, s1)) != NULL);
+	NUTS_ASSERT((st = nng_stat_find(st, "tx_msgs")) != NULL);
+	NUTS_ASSERT(nng_stat_value(st) == 10);
+	nng_stats_free(stats);
+	NUTS_FAIL(nni_stat_set_shards(0), NNG_EBUSY);
+	NUTS_CLOSE(s1);
+	NUTS_CLOSE(s2);
+	shard_restore();
+#endif
+}
+
 NUTS_TESTS = {
 	{ "socket stats", test_stats_socket },
 	{ "dump stats", test_stats_dump },
+	{ "stats shard concurrent", test_stats_shard_concurrent },
+	{ "stats shard fini", test_stats_shard_fini },
 	{ NULL, NULL },
 };
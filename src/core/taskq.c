@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -11,39 +11,90 @@
 #include "core/nng_impl.h"
 #include "nng/nng.h"
 
+// Each worker thread has its own queue, protected by its own lock.  Tasks
+// dispatched from a worker go on that worker's queue, and others are
+// spread across the queues.  A worker that runs out of work takes work
+// from the other queues before sleeping.  This keeps the dispatch path
+// off of any lock shared by all of the workers.
+//
+// Idle workers share one lock and condition variable, but dispatchers only
+// touch those when some worker is idle.  An idle worker counts itself in
+// tq_nidle before checking the queues a final time, so a dispatcher either
+// sees the worker as idle, or the worker sees the dispatched task.  The
+// dispatcher then leaves a wake up (tq_wakes) that makes a worker look
+// again, even if it has not yet gone to sleep.
+
 typedef struct nni_taskq_thr nni_taskq_thr;
 struct nni_taskq_thr {
-	nni_taskq *tqt_tq;
-	nni_thr    tqt_thread;
+	nni_taskq     *tqt_tq;
+	nni_thr        tqt_thread;
+	nni_mtx        tqt_mtx;
+	nni_list       tqt_tasks;
+	nni_atomic_int tqt_len; // tasks queued, for peeking without the lock
+	int            tqt_index;
 };
 struct nni_taskq {
-	nni_list       tq_tasks;
-	nni_mtx        tq_mtx;
-	nni_cv         tq_sched_cv;
-	nni_cv         tq_wait_cv;
-	nni_taskq_thr *tq_threads;
-	int            tq_nthreads;
-	bool           tq_run;
+	nni_mtx          tq_mtx; // protects tq_wakes and tq_run
+	nni_cv           tq_sched_cv;
+	nni_cv           tq_wait_cv;
+	nni_taskq_thr   *tq_threads;
+	int              tq_nthreads;
+	int              tq_wakes; // wake ups owed to idle workers
+	bool             tq_run;
+	nni_atomic_int   tq_nidle; // workers looking for work
+	nni_atomic_int   tq_next;  // next queue for outside dispatches
+	nni_plat_thr_key tq_key;   // worker identity, for local dispatch
+	bool             tq_key_init;
 };
 
 static nni_taskq *nni_taskq_systq = NULL;
 
+// nni_taskq_take takes the first task from the worker's own queue,
+// or failing that, from another worker's queue.  Unless strict is set,
+// queues that look empty are skipped without taking their locks.
+static nni_task *
+nni_taskq_take(nni_taskq_thr *thr, bool strict)
+{
+	nni_taskq *tq = thr->tqt_tq;
+	nni_task  *task;
+
+	for (int i = 0; i < tq->tq_nthreads; i++) {
+		nni_taskq_thr *q;
+
+		q = &tq->tq_threads[(thr->tqt_index + i) % tq->tq_nthreads];
+		if ((!strict) && (nni_atomic_get(&q->tqt_len) == 0)) {
+			continue;
+		}
+		nni_mtx_lock(&q->tqt_mtx);
+		if ((task = nni_list_first(&q->tqt_tasks)) != NULL) {
+			nni_list_remove(&q->tqt_tasks, task);
+			nni_atomic_dec(&q->tqt_len);
+		}
+		nni_mtx_unlock(&q->tqt_mtx);
+		if (task != NULL) {
+			return (task);
+		}
+	}
+	return (NULL);
+}
+
 static void
 nni_taskq_thread(void *self)
 {
-	nni_taskq_thr *thr = self;
-	nni_taskq     *tq  = thr->tqt_tq;
+	nni_taskq_thr *thr  = self;
+	nni_taskq     *tq   = thr->tqt_tq;
+	bool           idle = false;
 	nni_task      *task;
 
 	nni_thr_set_name(NULL, "nng:task");
+	(void) nni_plat_thr_key_set(&tq->tq_key, thr);
 
-	nni_mtx_lock(&tq->tq_mtx);
 	for (;;) {
-		if ((task = nni_list_first(&tq->tq_tasks)) != NULL) {
-
-			nni_list_remove(&tq->tq_tasks, task);
-
-			nni_mtx_unlock(&tq->tq_mtx);
+		if ((task = nni_taskq_take(thr, idle)) != NULL) {
+			if (idle) {
+				nni_atomic_dec(&tq->tq_nidle);
+				idle = false;
+			}
 
 			task->task_cb(task->task_arg);
 
@@ -53,25 +104,37 @@ nni_taskq_thread(void *self)
 				nni_cv_wake(&task->task_cv);
 			}
 			nni_mtx_unlock(&task->task_mtx);
+			continue;
+		}
 
-			nni_mtx_lock(&tq->tq_mtx);
-
+		if (!idle) {
+			// Announce that we are idle, then look once more.
+			nni_atomic_inc(&tq->tq_nidle);
+			idle = true;
 			continue;
 		}
 
-		nni_cv_wake(&tq->tq_wait_cv);
-		if (!tq->tq_run) {
-			break;
+		nni_mtx_lock(&tq->tq_mtx);
+		if (tq->tq_wakes == 0) {
+			nni_cv_wake(&tq->tq_wait_cv);
+			if (!tq->tq_run) {
+				nni_mtx_unlock(&tq->tq_mtx);
+				break;
+			}
+			nni_cv_wait(&tq->tq_sched_cv);
+		}
+		if (tq->tq_wakes > 0) {
+			tq->tq_wakes--;
 		}
-		nni_cv_wait(&tq->tq_sched_cv);
+		nni_mtx_unlock(&tq->tq_mtx);
 	}
-	nni_mtx_unlock(&tq->tq_mtx);
 }
 
 int
 nni_taskq_init(nni_taskq **tqp, int nthr)
 {
 	nni_taskq *tq;
+	int        rv;
 
 	if ((tq = NNI_ALLOC_STRUCT(tq)) == NULL) {
 		return (NNG_ENOMEM);
@@ -81,16 +144,30 @@ nni_taskq_init(nni_taskq **tqp, int nthr)
 		NNI_FREE_STRUCT(tq);
 		return (NNG_ENOMEM);
 	}
+	if ((rv = nni_plat_thr_key_init(&tq->tq_key, NULL)) != 0) {
+		NNI_FREE_STRUCTS(tq->tq_threads, nthr);
+		NNI_FREE_STRUCT(tq);
+		return (rv);
+	}
+	tq->tq_key_init = true;
 	tq->tq_nthreads = nthr;
-	NNI_LIST_INIT(&tq->tq_tasks, nni_task, task_node);
+	nni_atomic_init(&tq->tq_nidle);
+	nni_atomic_init(&tq->tq_next);
 
 	nni_mtx_init(&tq->tq_mtx);
 	nni_cv_init(&tq->tq_sched_cv, &tq->tq_mtx);
 	nni_cv_init(&tq->tq_wait_cv, &tq->tq_mtx);
 
 	for (int i = 0; i < nthr; i++) {
-		int rv;
-		tq->tq_threads[i].tqt_tq = tq;
+		nni_taskq_thr *thr = &tq->tq_threads[i];
+
+		thr->tqt_tq    = tq;
+		thr->tqt_index = i;
+		nni_mtx_init(&thr->tqt_mtx);
+		NNI_LIST_INIT(&thr->tqt_tasks, nni_task, task_node);
+		nni_atomic_init(&thr->tqt_len);
+	}
+	for (int i = 0; i < nthr; i++) {
 		rv = nni_thr_init(&tq->tq_threads[i].tqt_thread,
 		    nni_taskq_thread, &tq->tq_threads[i]);
 		if (rv != 0) {
@@ -121,6 +198,13 @@ nni_taskq_fini(nni_taskq *tq)
 	for (int i = 0; i < tq->tq_nthreads; i++) {
 		nni_thr_fini(&tq->tq_threads[i].tqt_thread);
 	}
+	// Only once all threads are gone, as they look at each other's queues.
+	for (int i = 0; i < tq->tq_nthreads; i++) {
+		nni_mtx_fini(&tq->tq_threads[i].tqt_mtx);
+	}
+	if (tq->tq_key_init) {
+		nni_plat_thr_key_fini(&tq->tq_key);
+	}
 	nni_cv_fini(&tq->tq_wait_cv);
 	nni_cv_fini(&tq->tq_sched_cv);
 	nni_mtx_fini(&tq->tq_mtx);
@@ -128,12 +212,29 @@ nni_taskq_fini(nni_taskq *tq)
 	NNI_FREE_STRUCT(tq);
 }
 
+static bool
+nni_taskq_empty(nni_taskq *tq)
+{
+	for (int i = 0; i < tq->tq_nthreads; i++) {
+		nni_taskq_thr *q = &tq->tq_threads[i];
+		bool           empty;
+
+		nni_mtx_lock(&q->tqt_mtx);
+		empty = nni_list_empty(&q->tqt_tasks);
+		nni_mtx_unlock(&q->tqt_mtx);
+		if (!empty) {
+			return (false);
+		}
+	}
+	return (true);
+}
+
 bool
 nni_taskq_drain(nni_taskq *tq)
 {
 	bool result = false;
 	nni_mtx_lock(&tq->tq_mtx);
-	while (!nni_list_empty(&tq->tq_tasks)) {
+	while (!nni_taskq_empty(tq)) {
 		result = true;
 		nni_cv_wait(&tq->tq_wait_cv);
 	}
@@ -167,7 +268,8 @@ nni_task_exec(nni_task *task)
 void
 nni_task_dispatch(nni_task *task)
 {
-	nni_taskq *tq = task->task_tq;
+	nni_taskq     *tq = task->task_tq;
+	nni_taskq_thr *thr;
 
 	// If there is no callback to perform, then do nothing!
 	// The user will be none the wiser.
@@ -183,10 +285,30 @@ nni_task_dispatch(nni_task *task)
 	}
 	nni_mtx_unlock(&task->task_mtx);
 
-	nni_mtx_lock(&tq->tq_mtx);
-	nni_list_append(&tq->tq_tasks, task);
-	nni_cv_wake1(&tq->tq_sched_cv); // waking just one waiter is adequate
-	nni_mtx_unlock(&tq->tq_mtx);
+	// Work dispatched by a worker stays with that worker, where it is
+	// likely to find its data in cache.  Other work is spread around.
+	if (((thr = nni_plat_thr_key_get(&tq->tq_key)) == NULL) ||
+	    (thr->tqt_tq != tq)) {
+		// Take our slot from the increment itself, so that two
+		// concurrent dispatches never pick the same queue.
+		unsigned slot = (unsigned) nni_atomic_inc_nv(&tq->tq_next);
+		thr = &tq->tq_threads[slot % (unsigned) tq->tq_nthreads];
+	}
+	nni_mtx_lock(&thr->tqt_mtx);
+	nni_list_append(&thr->tqt_tasks, task);
+	nni_atomic_inc(&thr->tqt_len);
+	nni_mtx_unlock(&thr->tqt_mtx);
+
+	// If anyone is idle, have one of them look for it.  A busy owner
+	// will get to it, but an idle worker may get to it sooner.
+	if (nni_atomic_get(&tq->tq_nidle) > 0) {
+		nni_mtx_lock(&tq->tq_mtx);
+		if (tq->tq_wakes < nni_atomic_get(&tq->tq_nidle)) {
+			tq->tq_wakes++;
+			nni_cv_wake1(&tq->tq_sched_cv);
+		}
+		nni_mtx_unlock(&tq->tq_mtx);
+	}
 }
 
 void
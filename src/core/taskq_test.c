@@ -0,0 +1,204 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include "core/nng_impl.h"
+
+#include <nuts.h>
+
+typedef struct {
+	nni_task       task;
+	nni_atomic_int count;
+	int            again; // times the callback dispatches itself again
+} task_arg;
+
+static void
+task_count(void *arg)
+{
+	task_arg *ta = arg;
+
+	nni_atomic_inc(&ta->count);
+}
+
+static void
+task_chain(void *arg)
+{
+	task_arg *ta = arg;
+
+	nni_atomic_inc(&ta->count);
+	if (ta->again > 0) {
+		ta->again--;
+		nni_task_dispatch(&ta->task);
+	}
+}
+
+static void
+task_slow(void *arg)
+{
+	task_arg *ta = arg;
+
+	nng_msleep(100);
+	nni_atomic_inc(&ta->count);
+}
+
+static void
+test_taskq_dispatch(void)
+{
+	nni_taskq *tq;
+	task_arg   ta;
+
+	NUTS_PASS(nni_taskq_init(&tq, 2));
+	nni_atomic_init(&ta.count);
+	nni_task_init(&ta.task, tq, task_count, &ta);
+	nni_task_dispatch(&ta.task);
+	nni_task_wait(&ta.task);
+	NUTS_TRUE(nni_atomic_get(&ta.count) == 1);
+	NUTS_TRUE(!nni_task_busy(&ta.task));
+	nni_task_fini(&ta.task);
+	nni_taskq_fini(tq);
+}
+
+static void
+test_taskq_chain(void)
+{
+	nni_taskq *tq;
+	task_arg   ta;
+
+	// The task dispatches itself from the worker, which uses the
+	// worker's own queue.
+	NUTS_PASS(nni_taskq_init(&tq, 4));
+	nni_atomic_init(&ta.count);
+	ta.again = 1000;
+	nni_task_init(&ta.task, tq, task_chain, &ta);
+	nni_task_dispatch(&ta.task);
+	nni_task_wait(&ta.task);
+	NUTS_TRUE(nni_atomic_get(&ta.count) == 1001);
+	nni_task_fini(&ta.task);
+	nni_taskq_fini(tq);
+}
+
+static void
+test_taskq_steal(void)
+{
+	nni_taskq *tq;
+	task_arg   slow;
+	task_arg   tas[8];
+	nng_time   start;
+
+	// Some of these land on the queue of the worker running the slow
+	// task, and the other worker must take them while it is busy.
+	NUTS_PASS(nni_taskq_init(&tq, 2));
+	nni_atomic_init(&slow.count);
+	nni_task_init(&slow.task, tq, task_slow, &slow);
+	for (int i = 0; i < 8; i++) {
+		nni_atomic_init(&tas[i].count);
+		nni_task_init(&tas[i].task, tq, task_count, &tas[i]);
+	}
+	start = nng_clock();
+	nni_task_dispatch(&slow.task);
+	for (int i = 0; i < 8; i++) {
+		nni_task_dispatch(&tas[i].task);
+	}
+	for (int i = 0; i < 8; i++) {
+		nni_task_wait(&tas[i].task);
+		NUTS_TRUE(nni_atomic_get(&tas[i].count) == 1);
+	}
+	NUTS_TRUE(nng_clock() - start < 100);
+	nni_task_wait(&slow.task);
+	NUTS_TRUE(nni_atomic_get(&slow.count) == 1);
+	for (int i = 0; i < 8; i++) {
+		nni_task_fini(&tas[i].task);
+	}
+	nni_task_fini(&slow.task);
+	nni_taskq_fini(tq);
+}
+
+static void
+test_taskq_drain(void)
+{
+	nni_taskq *tq;
+	task_arg   tas[16];
+
+	NUTS_PASS(nni_taskq_init(&tq, 2));
+	for (int i = 0; i < 16; i++) {
+		nni_atomic_init(&tas[i].count);
+		nni_task_init(&tas[i].task, tq, task_slow, &tas[i]);
+		tas[i].again = 0;
+	}
+	for (int i = 0; i < 16; i++) {
+		nni_task_dispatch(&tas[i].task);
+	}
+	(void) nni_taskq_drain(tq);
+	NUTS_TRUE(!nni_taskq_drain(tq));
+	for (int i = 0; i < 16; i++) {
+		nni_task_wait(&tas[i].task);
+		NUTS_TRUE(nni_atomic_get(&tas[i].count) == 1);
+		nni_task_fini(&tas[i].task);
+	}
+	nni_taskq_fini(tq);
+}
+
+typedef struct {
+	nni_atomic_int *next;
+	int            *seen;
+	nni_thr         thr;
+} slot_arg;
+
+static void
+slot_taker(void *arg)
+{
+	slot_arg *sa = arg;
+
+	for (int i = 0; i < 10000; i++) {
+		sa->seen[i] = nni_atomic_inc_nv(sa->next);
+	}
+}
+
+// Slots handed out with nni_atomic_inc_nv, as for outside dispatches,
+// must each go to exactly one caller.
+static void
+test_taskq_slots_unique(void)
+{
+	nni_atomic_int next;
+	slot_arg       sa[4];
+	uint8_t       *taken;
+	int            n = 4 * 10000;
+
+	nni_atomic_init(&next);
+	NUTS_ASSERT((taken = nni_zalloc(n + 1)) != NULL);
+	for (int i = 0; i < 4; i++) {
+		sa[i].next = &next;
+		sa[i].seen = nni_alloc(10000 * sizeof(int));
+		NUTS_ASSERT(sa[i].seen != NULL);
+		NUTS_PASS(nni_thr_init(&sa[i].thr, slot_taker, &sa[i]));
+	}
+	for (int i = 0; i < 4; i++) {
+		nni_thr_run(&sa[i].thr);
+	}
+	for (int i = 0; i < 4; i++) {
+		nni_thr_fini(&sa[i].thr);
+		for (int j = 0; j < 10000; j++) {
+			int v = sa[i].seen[j];
+			NUTS_ASSERT((v >= 1) && (v <= n));
+			NUTS_ASSERT(taken[v] == 0);
+			taken[v] = 1;
+		}
+		nni_free(sa[i].seen, 10000 * sizeof(int));
+	}
+	NUTS_TRUE(nni_atomic_get(&next) == n);
+	nni_free(taken, n + 1);
+}
+
+NUTS_TESTS = {
+	{ "taskq dispatch", test_taskq_dispatch },
+	{ "taskq chain", test_taskq_chain },
+	{ "taskq steal", test_taskq_steal },
+	{ "taskq drain", test_taskq_drain },
+	{ "taskq slots unique", test_taskq_slots_unique },
+	{ NULL, NULL },
+};
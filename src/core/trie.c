@@ -0,0 +1,442 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include <string.h>
+
+#include "core/nng_impl.h"
+
+// This is a compressed (path-collapsed) radix trie.  Each node carries
+// the segment of key bytes on the edge leading into it, so that chains of
+// single-child nodes never exist (other than transiently after an
+// allocation failure.)  Children are kept sorted by the first byte of their
+// segment, and we keep those first bytes in their own array so that the
+// binary search during a lookup touches only a single cache line or two.
+// The root node always has an empty segment; a value on the root is the
+// empty key, which matches everything.
+
+struct nni_trie_node {
+	nni_trie_node  *n_parent;
+	uint8_t        *n_seg;   // edge label leading to this node
+	size_t          n_len;   // length of n_seg
+	void           *n_val;   // non-NULL if a key terminates here
+	uint8_t        *n_first; // first byte of each child's segment, sorted
+	nni_trie_node **n_kids;
+	uint16_t        n_nkids;
+	uint16_t        n_cap;
+};
+
+static nni_trie_node *
+trie_node_alloc(const uint8_t *seg, size_t len)
+{
+	nni_trie_node *n;
+
+	if ((n = NNI_ALLOC_STRUCT(n)) == NULL) {
+		return (NULL);
+	}
+	if (len > 0) {
+		if ((n->n_seg = nni_alloc(len)) == NULL) {
+			NNI_FREE_STRUCT(n);
+			return (NULL);
+		}
+		memcpy(n->n_seg, seg, len);
+	}
+	n->n_len = len;
+	return (n);
+}
+
+static void
+trie_node_free(nni_trie_node *n)
+{
+	if (n->n_cap > 0) {
+		nni_free(n->n_first, n->n_cap);
+		nni_free(n->n_kids, n->n_cap * sizeof(nni_trie_node *));
+	}
+	if (n->n_len > 0) {
+		nni_free(n->n_seg, n->n_len);
+	}
+	NNI_FREE_STRUCT(n);
+}
+
+// trie_child_find locates the child whose segment starts with byte c.
+// On success it returns true.  Either way *posp is the index where such
+// a child is (or would be inserted.)
+static bool
+trie_child_find(const nni_trie_node *n, uint8_t c, unsigned *posp)
+{
+	unsigned lo = 0;
+	unsigned hi = n->n_nkids;
+
+	while (lo < hi) {
+		unsigned mid = (lo + hi) / 2;
+		if (n->n_first[mid] < c) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	*posp = lo;
+	return ((lo < n->n_nkids) && (n->n_first[lo] == c));
+}
+
+// trie_child_grow makes room for one more child.
+static nng_err
+trie_child_grow(nni_trie_node *n)
+{
+	if (n->n_nkids == n->n_cap) {
+		// There are at most 256 possible children (one per byte
+		// value), so we never grow past that.
+		unsigned        cap = n->n_cap ? n->n_cap * 2 : 2;
+		uint8_t        *first;
+		nni_trie_node **kids;
+
+		if (cap > 256) {
+			cap = 256;
+		}
+		if ((first = nni_alloc(cap)) == NULL) {
+			return (NNG_ENOMEM);
+		}
+		kids = nni_alloc(cap * sizeof(nni_trie_node *));
+		if (kids == NULL) {
+			nni_free(first, cap);
+			return (NNG_ENOMEM);
+		}
+		if (n->n_cap > 0) {
+			memcpy(first, n->n_first, n->n_nkids);
+			memcpy(kids, n->n_kids,
+			    n->n_nkids * sizeof(nni_trie_node *));
+			nni_free(n->n_first, n->n_cap);
+			nni_free(
+			    n->n_kids, n->n_cap * sizeof(nni_trie_node *));
+		}
+		n->n_first = first;
+		n->n_kids  = kids;
+		n->n_cap   = (uint16_t) cap;
+	}
+	return (NNG_OK);
+}
+
+static nng_err
+trie_child_add(nni_trie_node *n, unsigned pos, nni_trie_node *kid)
+{
+	nng_err rv;
+
+	if ((rv = trie_child_grow(n)) != NNG_OK) {
+		return (rv);
+	}
+	memmove(&n->n_first[pos + 1], &n->n_first[pos], n->n_nkids - pos);
+	memmove(&n->n_kids[pos + 1], &n->n_kids[pos],
+	    (n->n_nkids - pos) * sizeof(nni_trie_node *));
+	n->n_first[pos] = kid->n_seg[0];
+	n->n_kids[pos]  = kid;
+	n->n_nkids++;
+	kid->n_parent = n;
+	return (NNG_OK);
+}
+
+static void
+trie_child_del(nni_trie_node *n, unsigned pos)
+{
+	n->n_nkids--;
+	memmove(&n->n_first[pos], &n->n_first[pos + 1], n->n_nkids - pos);
+	memmove(&n->n_kids[pos], &n->n_kids[pos + 1],
+	    (n->n_nkids - pos) * sizeof(nni_trie_node *));
+}
+
+// trie_lookup finds the node whose full key is exactly the one given.
+static nni_trie_node *
+trie_lookup(nni_trie *t, const uint8_t *key, size_t len)
+{
+	nni_trie_node *n = t->t_root;
+	size_t         off = 0;
+
+	while (n != NULL) {
+		nni_trie_node *k;
+		unsigned       pos;
+
+		if (off == len) {
+			return (n);
+		}
+		if (!trie_child_find(n, key[off], &pos)) {
+			return (NULL);
+		}
+		k = n->n_kids[pos];
+		if ((k->n_len > (len - off)) ||
+		    (memcmp(k->n_seg, key + off, k->n_len) != 0)) {
+			return (NULL);
+		}
+		off += k->n_len;
+		n = k;
+	}
+	return (NULL);
+}
+
+void
+nni_trie_init(nni_trie *t)
+{
+	t->t_root  = NULL;
+	t->t_count = 0;
+}
+
+void
+nni_trie_fini(nni_trie *t)
+{
+	nni_trie_node *n = t->t_root;
+
+	// Iterative post-order teardown, using the parent links, so that
+	// very deep tries cannot exhaust the stack.
+	while (n != NULL) {
+		nni_trie_node *p;
+		if (n->n_nkids > 0) {
+			n = n->n_kids[--n->n_nkids];
+			continue;
+		}
+		p = n->n_parent;
+		trie_node_free(n);
+		n = p;
+	}
+	t->t_root  = NULL;
+	t->t_count = 0;
+}
+
+size_t
+nni_trie_count(const nni_trie *t)
+{
+	return (t->t_count);
+}
+
+void *
+nni_trie_find(nni_trie *t, const void *key, size_t len)
+{
+	nni_trie_node *n;
+
+	if ((n = trie_lookup(t, key, len)) == NULL) {
+		return (NULL);
+	}
+	return (n->n_val);
+}
+
+// nni_trie_insert adds the key with the given value.  If the key is
+// already present, NNG_EEXIST is returned and the trie is unchanged.
+nng_err
+nni_trie_insert(nni_trie *t, const void *keyp, size_t len, void *val)
+{
+	const uint8_t *key = keyp;
+	nni_trie_node *n;
+	size_t         off = 0;
+	nng_err        rv;
+
+	NNI_ASSERT(val != NULL);
+
+	if (t->t_root == NULL) {
+		if ((t->t_root = trie_node_alloc(NULL, 0)) == NULL) {
+			return (NNG_ENOMEM);
+		}
+	}
+	n = t->t_root;
+
+	for (;;) {
+		nni_trie_node *k;
+		nni_trie_node *mid;
+		nni_trie_node *leaf;
+		uint8_t       *rest;
+		unsigned       pos;
+		size_t         common;
+
+		if (off == len) {
+			if (n->n_val != NULL) {
+				return (NNG_EEXIST);
+			}
+			n->n_val = val;
+			t->t_count++;
+			return (NNG_OK);
+		}
+
+		if (!trie_child_find(n, key[off], &pos)) {
+			if ((k = trie_node_alloc(key + off, len - off)) ==
+			    NULL) {
+				return (NNG_ENOMEM);
+			}
+			if ((rv = trie_child_add(n, pos, k)) != NNG_OK) {
+				trie_node_free(k);
+				return (rv);
+			}
+			k->n_val = val;
+			t->t_count++;
+			return (NNG_OK);
+		}
+
+		k      = n->n_kids[pos];
+		common = 0;
+		while ((common < k->n_len) && (common < (len - off)) &&
+		    (k->n_seg[common] == key[off + common])) {
+			common++;
+		}
+		if (common == k->n_len) {
+			off += common;
+			n = k;
+			continue;
+		}
+
+		// Partial match; split the child at the divergence point,
+		// interposing a new node that carries the common part, and
+		// hang the rest of the key off that (unless the key ends
+		// there.)  Everything is allocated before we modify the
+		// tree, so that a failure leaves it as it was.
+		off += common;
+		rest = NULL;
+		leaf = NULL;
+		if (((mid = trie_node_alloc(k->n_seg, common)) == NULL) ||
+		    (trie_child_grow(mid) != NNG_OK) ||
+		    ((rest = nni_alloc(k->n_len - common)) == NULL) ||
+		    ((off < len) &&
+		        ((leaf = trie_node_alloc(key + off, len - off)) ==
+		            NULL))) {
+			if (rest != NULL) {
+				nni_free(rest, k->n_len - common);
+			}
+			if (mid != NULL) {
+				trie_node_free(mid);
+			}
+			return (NNG_ENOMEM);
+		}
+		memcpy(rest, k->n_seg + common, k->n_len - common);
+		nni_free(k->n_seg, k->n_len);
+		k->n_seg = rest;
+		k->n_len -= common;
+		n->n_kids[pos] = mid;
+		mid->n_parent  = n;
+
+		// The new node has room for two children, so these
+		// cannot fail.
+		rv = trie_child_add(mid, 0, k);
+		NNI_ASSERT(rv == NNG_OK);
+		if (leaf == NULL) {
+			mid->n_val = val;
+		} else {
+			(void) trie_child_find(mid, leaf->n_seg[0], &pos);
+			rv = trie_child_add(mid, pos, leaf);
+			NNI_ASSERT(rv == NNG_OK);
+			leaf->n_val = val;
+		}
+		t->t_count++;
+		return (NNG_OK);
+	}
+}
+
+// nni_trie_remove removes the key, returning the value that was stored,
+// or NULL if the key was not present.
+void *
+nni_trie_remove(nni_trie *t, const void *key, size_t len)
+{
+	nni_trie_node *n;
+	void          *val;
+
+	if (((n = trie_lookup(t, key, len)) == NULL) || (n->n_val == NULL)) {
+		return (NULL);
+	}
+	val      = n->n_val;
+	n->n_val = NULL;
+	t->t_count--;
+
+	// Now compact.  Nodes that carry no value and have no children are
+	// dropped, and valueless nodes with a single child are merged with
+	// that child.  The root is never removed.
+	while ((n != t->t_root) && (n->n_val == NULL)) {
+		nni_trie_node *p = n->n_parent;
+		unsigned       pos;
+
+		(void) trie_child_find(p, n->n_seg[0], &pos);
+		NNI_ASSERT(p->n_kids[pos] == n);
+
+		if (n->n_nkids == 0) {
+			trie_child_del(p, pos);
+			trie_node_free(n);
+			n = p;
+			continue;
+		}
+		if (n->n_nkids == 1) {
+			nni_trie_node *k = n->n_kids[0];
+			uint8_t       *seg;
+
+			if ((seg = nni_alloc(n->n_len + k->n_len)) != NULL) {
+				memcpy(seg, n->n_seg, n->n_len);
+				memcpy(seg + n->n_len, k->n_seg, k->n_len);
+				nni_free(k->n_seg, k->n_len);
+				k->n_seg       = seg;
+				k->n_len       = n->n_len + k->n_len;
+				k->n_parent    = p;
+				p->n_kids[pos] = k;
+				n->n_nkids     = 0;
+				trie_node_free(n);
+			}
+		}
+		break;
+	}
+	return (val);
+}
+
+// nni_trie_match returns true if any key in the trie is a prefix of
+// the supplied body.
+bool
+nni_trie_match(nni_trie *t, const void *body, size_t len)
+{
+	const uint8_t *b = body;
+	nni_trie_node *n = t->t_root;
+	size_t         off = 0;
+
+	while (n != NULL) {
+		nni_trie_node *k;
+		unsigned       pos;
+
+		if (n->n_val != NULL) {
+			return (true);
+		}
+		if ((off == len) || (!trie_child_find(n, b[off], &pos))) {
+			return (false);
+		}
+		k = n->n_kids[pos];
+		if ((k->n_len > (len - off)) ||
+		    (memcmp(k->n_seg, b + off, k->n_len) != 0)) {
+			return (false);
+		}
+		off += k->n_len;
+		n = k;
+	}
+	return (false);
+}
+
+// nni_trie_match_all calls the callback with the value of every key that
+// is a prefix of the supplied body.
+void
+nni_trie_match_all(nni_trie *t, const void *body, size_t len,
+    nni_trie_match_cb cb, void *arg)
+{
+	const uint8_t *b = body;
+	nni_trie_node *n = t->t_root;
+	size_t         off = 0;
+
+	while (n != NULL) {
+		nni_trie_node *k;
+		unsigned       pos;
+
+		if (n->n_val != NULL) {
+			cb(arg, n->n_val);
+		}
+		if ((off == len) || (!trie_child_find(n, b[off], &pos))) {
+			return;
+		}
+		k = n->n_kids[pos];
+		if ((k->n_len > (len - off)) ||
+		    (memcmp(k->n_seg, b + off, k->n_len) != 0)) {
+			return;
+		}
+		off += k->n_len;
+		n = k;
+	}
+}
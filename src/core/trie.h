@@ -0,0 +1,46 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#ifndef CORE_TRIE_H
+#define CORE_TRIE_H
+
+#include "core/defs.h"
+
+// nni_trie is a compressed prefix (radix) trie keyed by arbitrary byte
+// strings.  It is intended for topic matching, where we want to quickly
+// find every stored key that is a prefix of some message body.  Lookup
+// cost is proportional to the length of the body being matched, and not
+// to the number of keys stored.  Values must be non-NULL.  Locking must be
+// supplied by the caller.
+
+typedef struct nni_trie      nni_trie;
+typedef struct nni_trie_node nni_trie_node;
+
+// NB: These details are entirely private to the trie implementation.
+// They are provided here to facilitate inlining in structures.
+struct nni_trie {
+	nni_trie_node *t_root;
+	size_t         t_count;
+};
+
+// nni_trie_match_cb is called for each stored key that prefixes the body
+// being matched, from the shortest to the longest.
+typedef void (*nni_trie_match_cb)(void *, void *);
+
+extern void    nni_trie_init(nni_trie *);
+extern void    nni_trie_fini(nni_trie *);
+extern size_t  nni_trie_count(const nni_trie *);
+extern void   *nni_trie_find(nni_trie *, const void *, size_t);
+extern nng_err nni_trie_insert(nni_trie *, const void *, size_t, void *);
+extern void   *nni_trie_remove(nni_trie *, const void *, size_t);
+extern bool    nni_trie_match(nni_trie *, const void *, size_t);
+extern void    nni_trie_match_all(
+       nni_trie *, const void *, size_t, nni_trie_match_cb, void *);
+
+#endif // CORE_TRIE_H
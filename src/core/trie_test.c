@@ -0,0 +1,210 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nng_impl.h"
+#include <nuts.h>
+
+static char *one   = "one";
+static char *two   = "two";
+static char *three = "three";
+
+static void
+count_cb(void *arg, void *val)
+{
+	int *cnt = arg;
+	NUTS_ASSERT(val != NULL);
+	(*cnt)++;
+}
+
+static void
+test_trie_empty(void)
+{
+	nni_trie t;
+
+	nni_trie_init(&t);
+	NUTS_TRUE(nni_trie_count(&t) == 0);
+	NUTS_TRUE(!nni_trie_match(&t, "abc", 3));
+	NUTS_TRUE(!nni_trie_match(&t, NULL, 0));
+	NUTS_NULL(nni_trie_find(&t, "abc", 3));
+	NUTS_NULL(nni_trie_remove(&t, "abc", 3));
+	nni_trie_fini(&t);
+}
+
+static void
+test_trie_basic(void)
+{
+	nni_trie t;
+
+	nni_trie_init(&t);
+	NUTS_PASS(nni_trie_insert(&t, "abc", 3, one));
+	NUTS_TRUE(nni_trie_count(&t) == 1);
+	NUTS_TRUE(nni_trie_find(&t, "abc", 3) == one);
+	NUTS_NULL(nni_trie_find(&t, "ab", 2));
+	NUTS_NULL(nni_trie_find(&t, "abcd", 4));
+	NUTS_TRUE(nni_trie_match(&t, "abc", 3));
+	NUTS_TRUE(nni_trie_match(&t, "abcdef", 6));
+	NUTS_TRUE(!nni_trie_match(&t, "ab", 2));
+	NUTS_TRUE(!nni_trie_match(&t, "abd", 3));
+	NUTS_FAIL(nni_trie_insert(&t, "abc", 3, two), NNG_EEXIST);
+	NUTS_TRUE(nni_trie_find(&t, "abc", 3) == one);
+	NUTS_TRUE(nni_trie_remove(&t, "abc", 3) == one);
+	NUTS_TRUE(nni_trie_count(&t) == 0);
+	NUTS_TRUE(!nni_trie_match(&t, "abc", 3));
+	nni_trie_fini(&t);
+}
+
+static void
+test_trie_empty_key(void)
+{
+	nni_trie t;
+
+	nni_trie_init(&t);
+	NUTS_PASS(nni_trie_insert(&t, NULL, 0, one));
+	NUTS_TRUE(nni_trie_match(&t, NULL, 0));
+	NUTS_TRUE(nni_trie_match(&t, "anything", 8));
+	NUTS_TRUE(nni_trie_remove(&t, "", 0) == one);
+	NUTS_TRUE(!nni_trie_match(&t, "anything", 8));
+	nni_trie_fini(&t);
+}
+
+static void
+test_trie_split_merge(void)
+{
+	nni_trie t;
+	int      cnt;
+
+	nni_trie_init(&t);
+	NUTS_PASS(nni_trie_insert(&t, "abcdef", 6, one));
+	NUTS_PASS(nni_trie_insert(&t, "abcxyz", 6, two));
+	NUTS_PASS(nni_trie_insert(&t, "abc", 3, three));
+	NUTS_TRUE(nni_trie_count(&t) == 3);
+	NUTS_TRUE(nni_trie_find(&t, "abcdef", 6) == one);
+	NUTS_TRUE(nni_trie_find(&t, "abcxyz", 6) == two);
+	NUTS_TRUE(nni_trie_find(&t, "abc", 3) == three);
+	NUTS_NULL(nni_trie_find(&t, "abcd", 4));
+
+	cnt = 0;
+	nni_trie_match_all(&t, "abcdefg", 7, count_cb, &cnt);
+	NUTS_TRUE(cnt == 2);
+	cnt = 0;
+	nni_trie_match_all(&t, "abcx", 4, count_cb, &cnt);
+	NUTS_TRUE(cnt == 1);
+
+	// Removing the middle node should merge, but keep the others.
+	NUTS_TRUE(nni_trie_remove(&t, "abc", 3) == three);
+	NUTS_TRUE(!nni_trie_match(&t, "abcx", 4));
+	NUTS_TRUE(nni_trie_match(&t, "abcxyz", 6));
+	NUTS_TRUE(nni_trie_remove(&t, "abcdef", 6) == one);
+	NUTS_TRUE(nni_trie_find(&t, "abcxyz", 6) == two);
+	NUTS_TRUE(nni_trie_match(&t, "abcxyz!", 7));
+	NUTS_TRUE(!nni_trie_match(&t, "abcdef", 6));
+	NUTS_NULL(nni_trie_remove(&t, "abc", 3));
+	NUTS_TRUE(nni_trie_remove(&t, "abcxyz", 6) == two);
+	NUTS_TRUE(nni_trie_count(&t) == 0);
+
+	// Splits where the new key ends at the split, and where its
+	// branch sorts ahead of the existing one.
+	NUTS_PASS(nni_trie_insert(&t, "wxyz", 4, one));
+	NUTS_PASS(nni_trie_insert(&t, "wx", 2, two));
+	NUTS_PASS(nni_trie_insert(&t, "wa", 2, three));
+	NUTS_TRUE(nni_trie_count(&t) == 3);
+	NUTS_TRUE(nni_trie_find(&t, "wxyz", 4) == one);
+	NUTS_TRUE(nni_trie_find(&t, "wx", 2) == two);
+	NUTS_TRUE(nni_trie_find(&t, "wa", 2) == three);
+	NUTS_NULL(nni_trie_find(&t, "w", 1));
+	cnt = 0;
+	nni_trie_match_all(&t, "wxyz!", 5, count_cb, &cnt);
+	NUTS_TRUE(cnt == 2);
+	NUTS_TRUE(nni_trie_match(&t, "wax", 3));
+	NUTS_TRUE(!nni_trie_match(&t, "wb", 2));
+	nni_trie_fini(&t);
+}
+
+static void
+test_trie_binary(void)
+{
+	nni_trie t;
+	uint8_t  key[256];
+
+	// Exercise every possible fan-out byte, including NUL.
+	nni_trie_init(&t);
+	for (int i = 0; i < 256; i++) {
+		key[0] = (uint8_t) i;
+		key[1] = 0;
+		NUTS_PASS(nni_trie_insert(&t, key, 2, one));
+	}
+	NUTS_TRUE(nni_trie_count(&t) == 256);
+	for (int i = 255; i >= 0; i--) {
+		key[0] = (uint8_t) i;
+		key[1] = 0;
+		NUTS_TRUE(nni_trie_match(&t, key, 3));
+		key[1] = 1;
+		NUTS_TRUE(!nni_trie_match(&t, key, 2));
+	}
+	for (int i = 0; i < 256; i += 2) {
+		key[0] = (uint8_t) i;
+		key[1] = 0;
+		NUTS_TRUE(nni_trie_remove(&t, key, 2) == one);
+	}
+	NUTS_TRUE(nni_trie_count(&t) == 128);
+	for (int i = 0; i < 256; i++) {
+		key[0] = (uint8_t) i;
+		key[1] = 0;
+		NUTS_TRUE(nni_trie_match(&t, key, 2) == ((i % 2) != 0));
+	}
+	// Leave entries in place to check that fini releases them.
+	nni_trie_fini(&t);
+}
+
+static void
+test_trie_many(void)
+{
+	nni_trie t;
+	char     key[32];
+
+	nni_trie_init(&t);
+	for (int i = 0; i < 10000; i++) {
+		(void) snprintf(key, sizeof(key), "topic.%d", i);
+		NUTS_PASS(nni_trie_insert(&t, key, strlen(key), one));
+	}
+	NUTS_TRUE(nni_trie_count(&t) == 10000);
+	for (int i = 0; i < 10000; i++) {
+		(void) snprintf(key, sizeof(key), "topic.%d", i);
+		NUTS_TRUE(nni_trie_find(&t, key, strlen(key)) == one);
+	}
+	for (int i = 0; i < 10000; i += 3) {
+		(void) snprintf(key, sizeof(key), "topic.%d", i);
+		NUTS_TRUE(nni_trie_remove(&t, key, strlen(key)) == one);
+	}
+	for (int i = 0; i < 10000; i++) {
+		(void) snprintf(key, sizeof(key), "topic.%d", i);
+		NUTS_TRUE((nni_trie_find(&t, key, strlen(key)) == NULL) ==
+		    ((i % 3) == 0));
+	}
+	for (int i = 0; i < 10000; i++) {
+		(void) snprintf(key, sizeof(key), "topic.%d", i);
+		(void) nni_trie_remove(&t, key, strlen(key));
+	}
+	NUTS_TRUE(nni_trie_count(&t) == 0);
+	NUTS_TRUE(!nni_trie_match(&t, "topic.1", 7));
+	nni_trie_fini(&t);
+}
+
+NUTS_TESTS = {
+	{ "trie empty", test_trie_empty },
+	{ "trie basic", test_trie_basic },
+	{ "trie empty key", test_trie_empty_key },
+	{ "trie split merge", test_trie_split_merge },
+	{ "trie binary", test_trie_binary },
+	{ "trie many", test_trie_many },
+	{ NULL, NULL },
+};
@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -123,6 +123,12 @@ nni_atomic_inc(nni_atomic_int *v)
 	atomic_fetch_add_explicit(&v->v, 1, memory_order_relaxed);
 }
 
+int
+nni_atomic_inc_nv(nni_atomic_int *v)
+{
+	return (atomic_fetch_add_explicit(&v->v, 1, memory_order_relaxed) + 1);
+}
+
 void
 nni_atomic_dec(nni_atomic_int *v)
 {
@@ -341,6 +347,12 @@ nni_atomic_inc(nni_atomic_int *v)
 	__atomic_add_fetch(&v->v, 1, __ATOMIC_RELAXED);
 }
 
+int
+nni_atomic_inc_nv(nni_atomic_int *v)
+{
+	return (__atomic_add_fetch(&v->v, 1, __ATOMIC_RELAXED));
+}
+
 void
 nni_atomic_dec(nni_atomic_int *v)
 {
@@ -628,6 +640,17 @@ nni_atomic_inc(nni_atomic_int *v)
 	pthread_mutex_unlock(&plat_atomic_lock);
 }
 
+int
+nni_atomic_inc_nv(nni_atomic_int *v)
+{
+	int nv;
+	pthread_mutex_lock(&plat_atomic_lock);
+	v->v++;
+	nv = v->v;
+	pthread_mutex_unlock(&plat_atomic_lock);
+	return (nv);
+}
+
 void
 nni_atomic_dec(nni_atomic_int *v)
 {
@@ -78,6 +78,10 @@ struct nni_plat_thr {
 	void *arg;
 };
 
+struct nni_plat_thr_key {
+	pthread_key_t key;
+};
+
 struct nni_plat_flock {
 	int fd;
 };
@@ -35,26 +35,47 @@
 // nni_posix_pollq is a work structure that manages state for the epoll-based
 // pollq implementation
 typedef struct nni_posix_pollq {
-	nni_mtx  mtx;
-	nni_cv   cv;
-	int      epfd;  // epoll handle
-	int      evfd;  // event fd (to wake us for other stuff)
-	bool     close; // request for worker to exit
-	bool     init;
-	nni_thr  thr; // worker thread
-	nni_list reapq;
+	nni_mtx        mtx;
+	nni_cv         cv;
+	int            epfd;  // epoll handle
+	int            evfd;  // event fd (to wake us for other stuff)
+	bool           close; // request for worker to exit
+	bool           init;
+	nni_thr        thr; // worker thread
+	nni_list       reapq;
+	nni_atomic_int npfd; // descriptors assigned to this pollq
 } nni_posix_pollq;
 
-// single global instance for now.
+// There is one pollq, each with its own thread, for each poller thread
+// configured with nng_init().
 static nni_posix_pollq *nni_epoll_pqs;
 static int              nni_epoll_npq;
 
+// nni_epoll_pq_pick returns the pollq with the fewest descriptors.  A
+// descriptor keeps its pollq for life, so its callbacks always run on the
+// same thread.  (Assigning by descriptor number instead can leave one
+// thread with most of the connections, as numbers are reused.)
+static nni_posix_pollq *
+nni_epoll_pq_pick(void)
+{
+	nni_posix_pollq *pq = &nni_epoll_pqs[0];
+
+	for (int i = 1; i < nni_epoll_npq; i++) {
+		if (nni_atomic_get(&nni_epoll_pqs[i].npfd) <
+		    nni_atomic_get(&pq->npfd)) {
+			pq = &nni_epoll_pqs[i];
+		}
+	}
+	nni_atomic_inc(&pq->npfd);
+	return (pq);
+}
+
 void
 nni_posix_pfd_init(nni_posix_pfd *pfd, int fd, nni_posix_pfd_cb cb, void *arg)
 {
 	nni_posix_pollq *pq;
 
-	pq = &nni_epoll_pqs[fd % nni_epoll_npq];
+	pq = nni_epoll_pq_pick();
 
 	(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
 	(void) fcntl(fd, F_SETFL, O_NONBLOCK);
@@ -180,6 +201,7 @@ nni_posix_pfd_fini(nni_posix_pfd *pfd)
 	}
 
 	(void) close(pfd->fd);
+	nni_atomic_dec(&pq->npfd);
 }
 
 static void
@@ -306,6 +328,7 @@ nni_epoll_pq_create(nni_posix_pollq *pq)
 	NNI_LIST_INIT(&pq->reapq, nni_posix_pfd, node);
 	nni_mtx_init(&pq->mtx);
 	nni_cv_init(&pq->cv, &pq->mtx);
+	nni_atomic_init(&pq->npfd);
 	pq->epfd = -1;
 	pq->init = true;
 
@@ -18,6 +18,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
@@ -288,6 +289,37 @@ nni_plat_thr_set_name(nni_plat_thr *thr, const char *name)
 #endif
 }
 
+int
+nni_plat_thr_key_init(nni_plat_thr_key *key, void (*dtor)(void *))
+{
+	if (pthread_key_create(&key->key, dtor) != 0) {
+		return (NNG_ENOMEM);
+	}
+	return (0);
+}
+
+void
+nni_plat_thr_key_fini(nni_plat_thr_key *key)
+{
+	// POSIX does not call destructors here.
+	(void) pthread_key_delete(key->key);
+}
+
+void *
+nni_plat_thr_key_get(nni_plat_thr_key *key)
+{
+	return (pthread_getspecific(key->key));
+}
+
+int
+nni_plat_thr_key_set(nni_plat_thr_key *key, void *val)
+{
+	if (pthread_setspecific(key->key, val) != 0) {
+		return (NNG_ENOMEM);
+	}
+	return (0);
+}
+
 void
 nni_atfork_child(void)
 {
@@ -378,4 +410,19 @@ nni_plat_ncpu(void)
 #endif
 }
 
+int
+nni_plat_cpu(void)
+{
+	int cpu;
+#ifdef NNG_HAVE_SCHED_GETCPU
+	if ((cpu = sched_getcpu()) >= 0) {
+		return (cpu);
+	}
+#endif
+	// Threads have their own stacks, so the stack address is a
+	// reasonable stand-in when we cannot ask.
+	cpu = (int) ((uint32_t) (((uintptr_t) &cpu) >> 16) * 2654435761u >> 8);
+	return (cpu);
+}
+
 #endif // NNG_PLATFORM_POSIX
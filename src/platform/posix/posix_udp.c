@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -127,76 +127,279 @@ copy_from_bounce(nng_iov *iov, int niov, int len)
 }
 #endif
 
-static void
-nni_posix_udp_dorecv(nni_plat_udp *udp)
+// nni_posix_udp_recv1 receives a single datagram.  It returns NNG_EAGAIN
+// if no datagram is waiting.
+static int
+nni_posix_udp_recv1(nni_plat_udp *udp, nni_iov *aiov, unsigned niov,
+    nng_sockaddr *sa, size_t *cntp)
 {
-	nni_aio  *aio;
-	nni_list *q = &udp->udp_recvq;
-	// While we're able to recv, do so.
-	while ((aio = nni_list_first(q)) != NULL) {
-		unsigned                niov;
-		nng_iov                *aiov;
-		struct sockaddr_storage ss;
-		nng_sockaddr           *sa;
-		int                     rv  = 0;
-		int                     cnt = 0;
-
-		nni_aio_get_iov(aio, &niov, &aiov);
-		NNI_ASSERT(niov <= NNI_AIO_MAX_IOV);
+	struct sockaddr_storage ss;
+	int                     cnt;
 
+	NNI_ASSERT(niov <= NNI_AIO_MAX_IOV);
 #ifdef NNG_HAVE_RECVMSG
-		struct iovec  iov[NNI_AIO_MAX_IOV];
-		struct msghdr hdr = { .msg_name = NULL };
+	struct iovec  iov[NNI_AIO_MAX_IOV];
+	struct msghdr hdr = { .msg_name = NULL };
 
-		for (unsigned i = 0; i < niov; i++) {
-			iov[i].iov_base = aiov[i].iov_buf;
-			iov[i].iov_len  = aiov[i].iov_len;
-		}
-		hdr.msg_iov     = iov;
-		hdr.msg_iovlen  = niov;
-		hdr.msg_name    = &ss;
-		hdr.msg_namelen = sizeof(ss);
-
-		if ((cnt = recvmsg(udp->udp_fd, &hdr, 0)) < 0) {
-			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
-				// No data available at socket.  Leave
-				// the AIO at the head of the queue.
-				return;
-			}
-			rv = nni_plat_errno(errno);
-		} else if ((sa = nni_aio_get_input(aio, 0)) != NULL) {
-			// We need to store the address information.
-			// It is incumbent on the AIO submitter to supply
-			// storage for the address.
-			nni_posix_sockaddr2nn(
-			    sa, (void *) &ss, hdr.msg_namelen);
+	for (unsigned i = 0; i < niov; i++) {
+		iov[i].iov_base = aiov[i].iov_buf;
+		iov[i].iov_len  = aiov[i].iov_len;
+	}
+	hdr.msg_iov     = iov;
+	hdr.msg_iovlen  = niov;
+	hdr.msg_name    = &ss;
+	hdr.msg_namelen = sizeof(ss);
+
+	if ((cnt = recvmsg(udp->udp_fd, &hdr, 0)) < 0) {
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+			// No data available at socket.
+			return (NNG_EAGAIN);
 		}
+		return (nni_plat_errno(errno));
+	}
+	if (sa != NULL) {
+		// We need to store the address information.
+		// It is incumbent on the AIO submitter to supply
+		// storage for the address.
+		nni_posix_sockaddr2nn(sa, (void *) &ss, hdr.msg_namelen);
+	}
 #else // !NNG_HAVE_RECVMSG
       // Here we have to use a bounce buffer
-		uint8_t  *buf;
-		size_t    len;
-		socklen_t salen;
-		if (niov == 1) {
-			buf = aiov[0].iov_buf;
-			len = aiov[0].iov_len;
-		} else {
-			buf = bouncebuf;
-			len = sizeof(bouncebuf);
+	uint8_t  *buf;
+	size_t    len;
+	socklen_t salen;
+	if (niov == 1) {
+		buf = aiov[0].iov_buf;
+		len = aiov[0].iov_len;
+	} else {
+		buf = bouncebuf;
+		len = sizeof(bouncebuf);
+	}
+	salen = sizeof(ss);
+	if ((cnt = recvfrom(udp->udp_fd, buf, len, 0, (void *) &ss, &salen)) <
+	    0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return (NNG_EAGAIN);
 		}
-		salen = sizeof(ss);
-		if ((cnt = recvfrom(udp->udp_fd, buf, len, 0, (void *) &ss,
-		         &salen)) < 0) {
-			if (errno == EAGAIN || errno == EWOULDBLOCK) {
-				return;
+		return (nni_plat_errno(errno));
+	}
+	if (sa != NULL) {
+		nni_posix_sockaddr2nn(sa, (void *) &ss, salen);
+	}
+	if (niov != 1) {
+		copy_from_bounce(aiov, niov, cnt);
+	}
+#endif
+	*cntp = (size_t) cnt;
+	return (0);
+}
+
+// nni_posix_udp_send1 sends a single datagram.  It returns NNG_EAGAIN if
+// the datagram cannot be sent now.
+static int
+nni_posix_udp_send1(nni_plat_udp *udp, nni_iov *aiov, unsigned niov,
+    const nng_sockaddr *sa, size_t *cntp)
+{
+	struct sockaddr_storage ss;
+	int                     salen;
+	int                     cnt;
+
+	NNI_ASSERT(niov <= NNI_AIO_MAX_IOV);
+	if ((salen = nni_posix_nn2sockaddr(&ss, sa)) < 1) {
+		return (NNG_EADDRINVAL);
+	}
+#ifdef NNG_HAVE_SENDMSG
+	struct iovec  iov[NNI_AIO_MAX_IOV];
+	struct msghdr hdr = { .msg_name = NULL };
+	for (unsigned i = 0; i < niov; i++) {
+		iov[i].iov_base = aiov[i].iov_buf;
+		iov[i].iov_len  = aiov[i].iov_len;
+	}
+	hdr.msg_iov     = iov;
+	hdr.msg_iovlen  = niov;
+	hdr.msg_name    = &ss;
+	hdr.msg_namelen = salen;
+
+	cnt = sendmsg(udp->udp_fd, &hdr, MSG_NOSIGNAL);
+#else // !NNG_HAVE_SENDMSG
+	uint8_t *buf;
+	size_t   len;
+	if (niov == 1) {
+		buf = aiov[0].iov_buf;
+		len = aiov[0].iov_len;
+	} else {
+		len = copy_to_bounce(aiov, niov);
+		buf = bouncebuf;
+	}
+	cnt = sendto(udp->udp_fd, buf, len, 0, (void *) &ss, salen);
+#endif
+	if (cnt < 0) {
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+			// Cannot send now.
+			return (NNG_EAGAIN);
+		}
+		return (nni_plat_errno(errno));
+	}
+	*cntp = (size_t) cnt;
+	return (0);
+}
+
+// Datagrams handled by a single recvmmsg or sendmmsg call.
+#define NNI_POSIX_UDP_BATCH 32
+
+// nni_posix_udp_recvmany receives as many of the datagrams as are waiting,
+// with a single system call where possible.
+static int
+nni_posix_udp_recvmany(
+    nni_plat_udp *udp, nni_udp_dgram *dg, unsigned n, unsigned *donep)
+{
+#ifdef NNG_HAVE_RECVMMSG
+	struct mmsghdr          hdrs[NNI_POSIX_UDP_BATCH];
+	struct iovec            iov[NNI_POSIX_UDP_BATCH][NNI_UDP_DGRAM_IOV];
+	struct sockaddr_storage ss[NNI_POSIX_UDP_BATCH];
+	int                     cnt;
+
+	if (n > NNI_POSIX_UDP_BATCH) {
+		n = NNI_POSIX_UDP_BATCH;
+	}
+	memset(hdrs, 0, sizeof(hdrs[0]) * n);
+	for (unsigned i = 0; i < n; i++) {
+		for (unsigned j = 0; j < dg[i].ud_niov; j++) {
+			iov[i][j].iov_base = dg[i].ud_iov[j].iov_buf;
+			iov[i][j].iov_len  = dg[i].ud_iov[j].iov_len;
+		}
+		hdrs[i].msg_hdr.msg_iov     = iov[i];
+		hdrs[i].msg_hdr.msg_iovlen  = dg[i].ud_niov;
+		hdrs[i].msg_hdr.msg_name    = &ss[i];
+		hdrs[i].msg_hdr.msg_namelen = sizeof(ss[i]);
+	}
+	if ((cnt = recvmmsg(udp->udp_fd, hdrs, n, 0, NULL)) < 0) {
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+			return (NNG_EAGAIN);
+		}
+		return (nni_plat_errno(errno));
+	}
+	for (int i = 0; i < cnt; i++) {
+		dg[i].ud_len = hdrs[i].msg_len;
+		nni_posix_sockaddr2nn(&dg[i].ud_addr, (void *) &ss[i],
+		    hdrs[i].msg_hdr.msg_namelen);
+	}
+	*donep = (unsigned) cnt;
+	return (0);
+#else
+	unsigned i;
+	int      rv = 0;
+
+	for (i = 0; i < n; i++) {
+		if ((rv = nni_posix_udp_recv1(udp, dg[i].ud_iov, dg[i].ud_niov,
+		         &dg[i].ud_addr, &dg[i].ud_len)) != 0) {
+			break;
+		}
+	}
+	*donep = i;
+	return (i > 0 ? 0 : rv);
+#endif
+}
+
+// nni_posix_udp_sendmany sends as many of the datagrams as it can, with a
+// single system call where possible.  If none can be sent, the error for
+// the first datagram is returned.
+static int
+nni_posix_udp_sendmany(
+    nni_plat_udp *udp, nni_udp_dgram *dg, unsigned n, unsigned *donep)
+{
+#ifdef NNG_HAVE_SENDMMSG
+	struct mmsghdr          hdrs[NNI_POSIX_UDP_BATCH];
+	struct iovec            iov[NNI_POSIX_UDP_BATCH][NNI_UDP_DGRAM_IOV];
+	struct sockaddr_storage ss[NNI_POSIX_UDP_BATCH];
+	int                     salen;
+	int                     cnt;
+
+	if (n > NNI_POSIX_UDP_BATCH) {
+		n = NNI_POSIX_UDP_BATCH;
+	}
+	memset(hdrs, 0, sizeof(hdrs[0]) * n);
+	for (unsigned i = 0; i < n; i++) {
+		if ((salen = nni_posix_nn2sockaddr(&ss[i], &dg[i].ud_addr)) <
+		    1) {
+			if (i == 0) {
+				return (NNG_EADDRINVAL);
 			}
-			rv = nni_plat_errno(errno);
-		} else if ((sa = nni_aio_get_input(aio, 0)) != NULL) {
-			nni_posix_sockaddr2nn(sa, (void *) &ss, salen);
+			// Send the ones before it, and fail it next time.
+			n = i;
+			break;
+		}
+		for (unsigned j = 0; j < dg[i].ud_niov; j++) {
+			iov[i][j].iov_base = dg[i].ud_iov[j].iov_buf;
+			iov[i][j].iov_len  = dg[i].ud_iov[j].iov_len;
 		}
-		if (niov != 1) {
-			copy_from_bounce(aiov, niov, cnt);
+		hdrs[i].msg_hdr.msg_iov     = iov[i];
+		hdrs[i].msg_hdr.msg_iovlen  = dg[i].ud_niov;
+		hdrs[i].msg_hdr.msg_name    = &ss[i];
+		hdrs[i].msg_hdr.msg_namelen = salen;
+	}
+	if ((cnt = sendmmsg(udp->udp_fd, hdrs, n, MSG_NOSIGNAL)) < 0) {
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+			return (NNG_EAGAIN);
+		}
+		return (nni_plat_errno(errno));
+	}
+	for (int i = 0; i < cnt; i++) {
+		dg[i].ud_len = hdrs[i].msg_len;
+	}
+	*donep = (unsigned) cnt;
+	return (0);
+#else
+	unsigned i;
+	int      rv = 0;
+
+	for (i = 0; i < n; i++) {
+		if ((rv = nni_posix_udp_send1(udp, dg[i].ud_iov, dg[i].ud_niov,
+		         &dg[i].ud_addr, &dg[i].ud_len)) != 0) {
+			break;
 		}
+	}
+	*donep = i;
+	return (i > 0 ? 0 : rv);
 #endif
+}
+
+// Batched operations keep their datagrams in the provider data of the
+// aio, and the number of them in the first input.
+static nni_udp_dgram *
+nni_posix_udp_batch(nni_aio *aio, unsigned *np)
+{
+	*np = (unsigned) (uintptr_t) nni_aio_get_input(aio, 0);
+	return (nni_aio_get_prov_data(aio));
+}
+
+static void
+nni_posix_udp_dorecv(nni_plat_udp *udp)
+{
+	nni_aio  *aio;
+	nni_list *q = &udp->udp_recvq;
+	// While we're able to recv, do so.
+	while ((aio = nni_list_first(q)) != NULL) {
+		nni_udp_dgram *dg;
+		unsigned       n;
+		unsigned       done;
+		unsigned       niov;
+		nni_iov       *aiov;
+		size_t         cnt = 0;
+		int            rv;
+
+		if ((dg = nni_posix_udp_batch(aio, &n)) != NULL) {
+			rv  = nni_posix_udp_recvmany(udp, dg, n, &done);
+			cnt = rv == 0 ? done : 0;
+		} else {
+			nni_aio_get_iov(aio, &niov, &aiov);
+			rv = nni_posix_udp_recv1(
+			    udp, aiov, niov, nni_aio_get_input(aio, 0), &cnt);
+		}
+		if (rv == NNG_EAGAIN) {
+			// Leave the AIO at the head of the queue.
+			return;
+		}
 		nni_list_remove(q, aio);
 		nni_aio_finish(aio, rv, cnt);
 	}
@@ -210,63 +413,39 @@ nni_posix_udp_dosend(nni_plat_udp *udp)
 
 	// While we're able to send, do so.
 	while ((aio = nni_list_first(q)) != NULL) {
-		struct sockaddr_storage ss;
-
-		int      salen;
-		int      rv  = 0;
-		int      cnt = 0;
-		unsigned niov;
-		nni_iov *aiov;
-
-		nni_aio_get_iov(aio, &niov, &aiov);
-		NNI_ASSERT(niov <= NNI_AIO_MAX_IOV);
-		if ((salen = nni_posix_nn2sockaddr(
-		         &ss, nni_aio_get_input(aio, 0))) < 1) {
-			rv = NNG_EADDRINVAL;
-		} else {
-#ifdef NNG_HAVE_SENDMSG
-
-			struct iovec  iov[NNI_AIO_MAX_IOV];
-			struct msghdr hdr = { .msg_name = NULL };
-			for (unsigned i = 0; i < niov; i++) {
-				iov[i].iov_base = aiov[i].iov_buf;
-				iov[i].iov_len  = aiov[i].iov_len;
-			}
-			hdr.msg_iov     = iov;
-			hdr.msg_iovlen  = niov;
-			hdr.msg_name    = &ss;
-			hdr.msg_namelen = salen;
-
-			cnt = sendmsg(udp->udp_fd, &hdr, MSG_NOSIGNAL);
-			if (cnt < 0) {
-				if ((errno == EAGAIN) ||
-				    (errno == EWOULDBLOCK)) {
+		nni_udp_dgram *dg;
+		unsigned       n;
+		unsigned       done;
+		unsigned       niov;
+		nni_iov       *aiov;
+		size_t         cnt = 0;
+		int            rv  = 0;
+
+		if ((dg = nni_posix_udp_batch(aio, &n)) != NULL) {
+			// The count is how far we have gotten so far.
+			while ((cnt = nni_aio_count(aio)) < n) {
+				int xrv = nni_posix_udp_sendmany(
+				    udp, dg + cnt, n - (unsigned) cnt, &done);
+				if (xrv == NNG_EAGAIN) {
 					// Cannot send now, leave.
 					return;
 				}
-				rv = nni_plat_errno(errno);
-			}
-#else // !NNG_HAVE_SENDMSG
-			uint8_t *buf;
-			size_t   len;
-			if (niov == 1) {
-				buf = aiov[0].iov_buf;
-				len = aiov[0].iov_len;
-			} else {
-				len = copy_to_bounce(aiov, niov);
-				buf = bouncebuf;
-			}
-			cnt = sendto(
-			    udp->udp_fd, buf, len, 0, (void *) &ss, salen);
-			if (cnt < 0) {
-				if ((errno == EAGAIN) ||
-				    (errno == EWOULDBLOCK)) {
-					// Cannot send now, leave.
-					return;
+				if (xrv != 0) {
+					// Drop the datagram, and carry on.
+					dg[cnt].ud_len = 0;
+					done           = 1;
+					rv             = xrv;
 				}
-				rv = nni_plat_errno(errno);
+				nni_aio_bump_count(aio, done);
+			}
+		} else {
+			nni_aio_get_iov(aio, &niov, &aiov);
+			rv = nni_posix_udp_send1(
+			    udp, aiov, niov, nni_aio_get_input(aio, 0), &cnt);
+			if (rv == NNG_EAGAIN) {
+				// Cannot send now, leave.
+				return;
 			}
-#endif
 		}
 
 		nni_list_remove(q, aio);
@@ -395,11 +574,10 @@ nni_plat_udp_cancel(nni_aio *aio, void *arg, nng_err rv)
 	nni_mtx_unlock(&udp->udp_mtx);
 }
 
-void
-nni_plat_udp_recv(nni_plat_udp *udp, nni_aio *aio)
+static void
+nni_posix_udp_recv(nni_plat_udp *udp, nni_aio *aio)
 {
 	int rv;
-	nni_aio_reset(aio);
 	nni_mtx_lock(&udp->udp_mtx);
 	if (!nni_aio_start(aio, nni_plat_udp_cancel, udp)) {
 		nni_mtx_unlock(&udp->udp_mtx);
@@ -421,11 +599,10 @@ nni_plat_udp_recv(nni_plat_udp *udp, nni_aio *aio)
 	nni_mtx_unlock(&udp->udp_mtx);
 }
 
-void
-nni_plat_udp_send(nni_plat_udp *udp, nni_aio *aio)
+static void
+nni_posix_udp_send(nni_plat_udp *udp, nni_aio *aio)
 {
 	int rv;
-	nni_aio_reset(aio);
 	nni_mtx_lock(&udp->udp_mtx);
 	if (!nni_aio_start(aio, nni_plat_udp_cancel, udp)) {
 		nni_mtx_unlock(&udp->udp_mtx);
@@ -447,6 +624,42 @@ nni_plat_udp_send(nni_plat_udp *udp, nni_aio *aio)
 	nni_mtx_unlock(&udp->udp_mtx);
 }
 
+void
+nni_plat_udp_recv(nni_plat_udp *udp, nni_aio *aio)
+{
+	nni_aio_reset(aio);
+	nni_aio_set_prov_data(aio, NULL);
+	nni_posix_udp_recv(udp, aio);
+}
+
+void
+nni_plat_udp_send(nni_plat_udp *udp, nni_aio *aio)
+{
+	nni_aio_reset(aio);
+	nni_aio_set_prov_data(aio, NULL);
+	nni_posix_udp_send(udp, aio);
+}
+
+void
+nni_plat_udp_recv_batch(
+    nni_plat_udp *udp, nni_udp_dgram *dg, unsigned n, nni_aio *aio)
+{
+	nni_aio_reset(aio);
+	nni_aio_set_input(aio, 0, (void *) (uintptr_t) n);
+	nni_aio_set_prov_data(aio, dg);
+	nni_posix_udp_recv(udp, aio);
+}
+
+void
+nni_plat_udp_send_batch(
+    nni_plat_udp *udp, nni_udp_dgram *dg, unsigned n, nni_aio *aio)
+{
+	nni_aio_reset(aio);
+	nni_aio_set_input(aio, 0, (void *) (uintptr_t) n);
+	nni_aio_set_prov_data(aio, dg);
+	nni_posix_udp_send(udp, aio);
+}
+
 int
 nni_plat_udp_sockname(nni_plat_udp *udp, nni_sockaddr *sa)
 {
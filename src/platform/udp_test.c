@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -478,6 +478,161 @@ test_udp_send_v6_from_v4(void)
 #endif
 }
 
+static void
+udp_loopback_pair(nng_udp **u1, nng_udp **u2, nng_sockaddr *sa2)
+{
+	nng_sockaddr sa;
+
+	sa.s_in.sa_family = NNG_AF_INET;
+	sa.s_in.sa_addr   = htonl(0x7f000001); // 127.0.0.1
+	sa.s_in.sa_port   = 0;
+	NUTS_PASS(nng_udp_open(u1, &sa));
+	NUTS_PASS(nng_udp_open(u2, &sa));
+	NUTS_PASS(nng_udp_sockname(*u2, sa2));
+}
+
+void
+test_udp_batch(void)
+{
+	nng_udp      *u1;
+	nng_udp      *u2;
+	nng_sockaddr  sa1;
+	nng_sockaddr  sa2;
+	nng_aio      *aio1;
+	nng_aio      *aio2;
+	nni_udp_dgram tx[10];
+	nni_udp_dgram rx[4];
+	char          hdr[10][8];
+	char          body[] = "payload";
+	char          rbuf[4][64];
+	int           got = 0;
+
+	udp_loopback_pair(&u1, &u2, &sa2);
+	NUTS_PASS(nng_udp_sockname(u1, &sa1));
+	NUTS_PASS(nng_aio_alloc(&aio1, NULL, NULL));
+	NUTS_PASS(nng_aio_alloc(&aio2, NULL, NULL));
+
+	// Each datagram is gathered from two buffers.
+	for (int i = 0; i < 10; i++) {
+		snprintf(hdr[i], sizeof(hdr[i]), "dg%d:", i);
+		tx[i].ud_iov[0].iov_buf = hdr[i];
+		tx[i].ud_iov[0].iov_len = strlen(hdr[i]);
+		tx[i].ud_iov[1].iov_buf = body;
+		tx[i].ud_iov[1].iov_len = sizeof(body);
+		tx[i].ud_niov           = 2;
+		tx[i].ud_addr           = sa2;
+	}
+	nni_plat_udp_send_batch((nni_plat_udp *) u1, tx, 10, aio1);
+	nng_aio_wait(aio1);
+	NUTS_PASS(nng_aio_result(aio1));
+	NUTS_TRUE(nng_aio_count(aio1) == 10);
+	for (int i = 0; i < 10; i++) {
+		NUTS_TRUE(tx[i].ud_len == strlen(hdr[i]) + sizeof(body));
+	}
+
+	// Receive them, a few at a time.
+	while (got < 10) {
+		for (int i = 0; i < 4; i++) {
+			rx[i].ud_iov[0].iov_buf = rbuf[i];
+			rx[i].ud_iov[0].iov_len = sizeof(rbuf[i]);
+			rx[i].ud_niov           = 1;
+		}
+		nng_aio_set_timeout(aio2, 1000);
+		nni_plat_udp_recv_batch((nni_plat_udp *) u2, rx, 4, aio2);
+		nng_aio_wait(aio2);
+		NUTS_PASS(nng_aio_result(aio2));
+		NUTS_TRUE(nng_aio_count(aio2) > 0);
+		NUTS_TRUE(nng_aio_count(aio2) <= 4);
+		for (size_t i = 0; i < nng_aio_count(aio2); i++) {
+			char expect[64];
+			snprintf(expect, sizeof(expect), "dg%d:%s", got, body);
+			NUTS_TRUE(rx[i].ud_len == strlen(expect) + 1);
+			NUTS_MATCH(rbuf[i], expect);
+			NUTS_TRUE(
+			    rx[i].ud_addr.s_in.sa_port == sa1.s_in.sa_port);
+			got++;
+		}
+	}
+
+	// A datagram with a bad address is dropped, and the others sent.
+	tx[1].ud_addr.s_family = NNG_AF_UNSPEC;
+	nni_plat_udp_send_batch((nni_plat_udp *) u1, tx, 3, aio1);
+	nng_aio_wait(aio1);
+	NUTS_FAIL(nng_aio_result(aio1), NNG_EADDRINVAL);
+	NUTS_TRUE(nng_aio_count(aio1) == 3);
+	NUTS_TRUE(tx[0].ud_len > 0);
+	NUTS_TRUE(tx[1].ud_len == 0);
+	NUTS_TRUE(tx[2].ud_len > 0);
+
+	nng_aio_free(aio1);
+	nng_aio_free(aio2);
+	nng_udp_close(u1);
+	nng_udp_close(u2);
+}
+
+// This sends several full batches, and checks that every datagram comes
+// back in order, however the receives happen to be split up.
+void
+test_udp_batch_full(void)
+{
+	nng_udp      *u1;
+	nng_udp      *u2;
+	nng_sockaddr  sa2;
+	nng_aio      *aio1;
+	nng_aio      *aio2;
+	nni_udp_dgram tx[32];
+	nni_udp_dgram rx[32];
+	char          tbuf[32][16];
+	char          rbuf[32][16];
+
+	udp_loopback_pair(&u1, &u2, &sa2);
+	NUTS_PASS(nng_aio_alloc(&aio1, NULL, NULL));
+	NUTS_PASS(nng_aio_alloc(&aio2, NULL, NULL));
+	nng_aio_set_timeout(aio1, 1000);
+	nng_aio_set_timeout(aio2, 1000);
+
+	for (int round = 0; round < 4; round++) {
+		size_t got = 0;
+
+		for (int i = 0; i < 32; i++) {
+			snprintf(tbuf[i], sizeof(tbuf[i]), "%d:%d", round, i);
+			tx[i].ud_iov[0].iov_buf = tbuf[i];
+			tx[i].ud_iov[0].iov_len = strlen(tbuf[i]) + 1;
+			tx[i].ud_niov           = 1;
+			tx[i].ud_addr           = sa2;
+		}
+		nni_plat_udp_send_batch((nni_plat_udp *) u1, tx, 32, aio1);
+		nng_aio_wait(aio1);
+		NUTS_PASS(nng_aio_result(aio1));
+		NUTS_TRUE(nng_aio_count(aio1) == 32);
+
+		// A lost datagram times out here, rather than hanging.
+		while (got < 32) {
+			for (size_t i = got; i < 32; i++) {
+				rx[i].ud_iov[0].iov_buf = rbuf[i];
+				rx[i].ud_iov[0].iov_len = sizeof(rbuf[i]);
+				rx[i].ud_niov           = 1;
+			}
+			nni_plat_udp_recv_batch(
+			    (nni_plat_udp *) u2, &rx[got], 32 - got, aio2);
+			nng_aio_wait(aio2);
+			NUTS_PASS(nng_aio_result(aio2));
+			NUTS_TRUE(nng_aio_count(aio2) > 0);
+			got += nng_aio_count(aio2);
+		}
+		NUTS_TRUE(got == 32);
+		for (int i = 0; i < 32; i++) {
+			NUTS_TRUE(rx[i].ud_len == strlen(tbuf[i]) + 1);
+			NUTS_MATCH(rbuf[i], tbuf[i]);
+		}
+	}
+
+	nng_aio_free(aio1);
+	nng_aio_free(aio2);
+	nng_udp_close(u1);
+	nng_udp_close(u2);
+}
+
 NUTS_TESTS = {
 	{ "udp pair", test_udp_pair },
 	{ "udp scatter gather", test_udp_scatter_gather },
@@ -489,5 +644,7 @@ NUTS_TESTS = {
 	{ "udp multicast membership", test_udp_multicast_membership },
 	{ "udp multicast send recv", test_udp_multicast_send_recv },
 	{ "udp send v6 from v4", test_udp_send_v6_from_v4 },
+	{ "udp batch", test_udp_batch },
+	{ "udp batch full", test_udp_batch_full },
 	{ NULL, NULL },
 };
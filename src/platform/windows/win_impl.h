@@ -35,6 +35,11 @@ struct nni_plat_thr {
 	DWORD  id;
 };
 
+struct nni_plat_thr_key {
+	DWORD idx;
+	void (*dtor)(void *);
+};
+
 struct nni_plat_mtx {
 	SRWLOCK srl;
 };
@@ -307,6 +307,12 @@ nni_atomic_inc(nni_atomic_int *v)
 	(void) InterlockedIncrementNoFence(&v->v);
 }
 
+int
+nni_atomic_inc_nv(nni_atomic_int *v)
+{
+	return (InterlockedIncrementNoFence(&v->v));
+}
+
 int
 nni_atomic_dec_nv(nni_atomic_int *v)
 {
@@ -394,6 +400,73 @@ nni_plat_thr_set_name(nni_plat_thr *thr, const char *name)
 	}
 }
 
+// Fiber local storage callbacks only get the value, so we store a small
+// wrapper that also carries the destructor.
+typedef struct {
+	void (*dtor)(void *);
+	void *val;
+} win_thr_val;
+
+static void WINAPI
+win_thr_key_cb(void *arg)
+{
+	win_thr_val *v = arg;
+
+	if (v != NULL) {
+		if ((v->val != NULL) && (v->dtor != NULL)) {
+			v->dtor(v->val);
+		}
+		NNI_FREE_STRUCT(v);
+	}
+}
+
+int
+nni_plat_thr_key_init(nni_plat_thr_key *key, void (*dtor)(void *))
+{
+	if ((key->idx = FlsAlloc(win_thr_key_cb)) == FLS_OUT_OF_INDEXES) {
+		return (NNG_ENOMEM);
+	}
+	key->dtor = dtor;
+	return (0);
+}
+
+void
+nni_plat_thr_key_fini(nni_plat_thr_key *key)
+{
+	// This calls the callback for every thread with a value.
+	(void) FlsFree(key->idx);
+}
+
+void *
+nni_plat_thr_key_get(nni_plat_thr_key *key)
+{
+	win_thr_val *v = FlsGetValue(key->idx);
+
+	return (v != NULL ? v->val : NULL);
+}
+
+int
+nni_plat_thr_key_set(nni_plat_thr_key *key, void *val)
+{
+	win_thr_val *v = FlsGetValue(key->idx);
+
+	if (v == NULL) {
+		if (val == NULL) {
+			return (0);
+		}
+		if ((v = NNI_ALLOC_STRUCT(v)) == NULL) {
+			return (NNG_ENOMEM);
+		}
+		v->dtor = key->dtor;
+		if (!FlsSetValue(key->idx, v)) {
+			NNI_FREE_STRUCT(v);
+			return (NNG_ENOMEM);
+		}
+	}
+	v->val = val;
+	return (0);
+}
+
 int
 nni_plat_ncpu(void)
 {
@@ -403,6 +476,12 @@ nni_plat_ncpu(void)
 	return ((int) (info.dwNumberOfProcessors));
 }
 
+int
+nni_plat_cpu(void)
+{
+	return ((int) GetCurrentProcessorNumber());
+}
+
 int
 nni_plat_init(nng_init_params *params)
 {
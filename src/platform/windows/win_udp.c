@@ -174,6 +174,49 @@ nni_plat_udp_send(nni_plat_udp *u, nni_aio *aio)
 	return;
 }
 
+// Windows has no batched send, but sends complete immediately anyway, so
+// we simply send each of the datagrams in turn.
+void
+nni_plat_udp_send_batch(
+    nni_plat_udp *u, nni_udp_dgram *dg, unsigned n, nni_aio *aio)
+{
+	int rv = 0;
+
+	nni_aio_reset(aio);
+	nni_mtx_lock(&u->lk);
+	if ((u->s == INVALID_SOCKET) || u->closed) {
+		nni_mtx_unlock(&u->lk);
+		nni_aio_finish_error(aio, NNG_ECLOSED);
+		return;
+	}
+	for (unsigned i = 0; i < n; i++) {
+		SOCKADDR_STORAGE to;
+		int              tolen;
+		WSABUF           iov[NNI_UDP_DGRAM_IOV];
+		DWORD            nsent;
+
+		dg[i].ud_len = 0;
+		if ((tolen = nni_win_nn2sockaddr(&to, &dg[i].ud_addr)) < 0) {
+			rv = NNG_EADDRINVAL;
+			continue;
+		}
+		for (unsigned j = 0; j < dg[i].ud_niov; j++) {
+			iov[j].buf = dg[i].ud_iov[j].iov_buf;
+			iov[j].len = (ULONG) dg[i].ud_iov[j].iov_len;
+		}
+		if (WSASendTo(u->s, iov, (DWORD) dg[i].ud_niov, &nsent, 0,
+		        (struct sockaddr *) &to, tolen, NULL,
+		        NULL) == SOCKET_ERROR) {
+			rv = nni_win_error(GetLastError());
+			continue;
+		}
+		dg[i].ud_len = nsent;
+	}
+	nni_mtx_unlock(&u->lk);
+
+	nni_aio_finish(aio, rv, n);
+}
+
 static void
 udp_recv_cancel(nni_aio *aio, void *arg, nng_err rv)
 {
@@ -193,9 +236,10 @@ udp_recv_cancel(nni_aio *aio, void *arg, nng_err rv)
 static void
 udp_recv_cb(nni_win_io *io, int rv, size_t num)
 {
-	nni_plat_udp *u = io->ptr;
-	nni_sockaddr *sa;
-	nni_aio      *aio;
+	nni_plat_udp  *u = io->ptr;
+	nni_sockaddr  *sa;
+	nni_aio       *aio;
+	nni_udp_dgram *dg;
 
 	nni_mtx_lock(&u->lk);
 	if ((aio = nni_list_first(&u->rxq)) == NULL) {
@@ -208,13 +252,24 @@ udp_recv_cb(nni_win_io *io, int rv, size_t num)
 		u->cancel_rv = 0;
 	}
 
+	// Batched receives get only a single datagram at a time here.
+	if ((dg = nni_aio_get_prov_data(aio)) != NULL) {
+		sa = &dg->ud_addr;
+	} else {
+		sa = nni_aio_get_input(aio, 0);
+	}
+
 	// convert address from Windows form...
-	if ((sa = nni_aio_get_input(aio, 0)) != NULL) {
+	if (sa != NULL) {
 		if (nni_win_sockaddr2nn(sa, &u->rxsa, sizeof(u->rxsa)) != 0) {
 			rv  = NNG_EADDRINVAL;
 			num = 0;
 		}
 	}
+	if (dg != NULL) {
+		dg->ud_len = num;
+		num        = (rv == 0) ? 1 : 0;
+	}
 
 	nni_aio_list_remove(aio);
 	udp_recv_start(u);
@@ -226,12 +281,13 @@ udp_recv_cb(nni_win_io *io, int rv, size_t num)
 static void
 udp_recv_start(nni_plat_udp *u)
 {
-	int      rv;
-	DWORD    flags;
-	nni_iov *aiov;
-	unsigned naiov;
-	WSABUF  *iov;
-	nni_aio *aio;
+	int            rv;
+	DWORD          flags;
+	nni_iov       *aiov;
+	unsigned       naiov;
+	WSABUF        *iov;
+	nni_aio       *aio;
+	nni_udp_dgram *dg;
 
 	if ((u->s == INVALID_SOCKET) || (u->closed)) {
 		while ((aio = nni_list_first(&u->rxq)) != NULL) {
@@ -248,7 +304,12 @@ again:
 	}
 
 	u->rxsalen = sizeof(SOCKADDR_STORAGE);
-	nni_aio_get_iov(aio, &naiov, &aiov);
+	if ((dg = nni_aio_get_prov_data(aio)) != NULL) {
+		naiov = dg->ud_niov;
+		aiov  = dg->ud_iov;
+	} else {
+		nni_aio_get_iov(aio, &naiov, &aiov);
+	}
 
 	// This is a stack allocation- it should always succeed - or
 	// throw an exception if there is not sufficient stack space.
@@ -281,10 +342,9 @@ again:
 // nni_plat_udp_pipe_recv recvs a message, storing it in the iovs
 // from the UDP payload.  If the UDP payload will not fit, then
 // NNG_EMSGSIZE results.
-void
-nni_plat_udp_recv(nni_plat_udp *u, nni_aio *aio)
+static void
+udp_recv(nni_plat_udp *u, nni_aio *aio)
 {
-	nni_aio_reset(aio);
 	nni_mtx_lock(&u->lk);
 	if (u->closed) {
 		nni_mtx_unlock(&u->lk);
@@ -302,6 +362,24 @@ nni_plat_udp_recv(nni_plat_udp *u, nni_aio *aio)
 	nni_mtx_unlock(&u->lk);
 }
 
+void
+nni_plat_udp_recv(nni_plat_udp *u, nni_aio *aio)
+{
+	nni_aio_reset(aio);
+	nni_aio_set_prov_data(aio, NULL);
+	udp_recv(u, aio);
+}
+
+void
+nni_plat_udp_recv_batch(
+    nni_plat_udp *u, nni_udp_dgram *dg, unsigned n, nni_aio *aio)
+{
+	NNI_ARG_UNUSED(n);
+	nni_aio_reset(aio);
+	nni_aio_set_prov_data(aio, dg);
+	udp_recv(u, aio);
+}
+
 int
 nni_plat_udp_sockname(nni_plat_udp *udp, nni_sockaddr *sa)
 {
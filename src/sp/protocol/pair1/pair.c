@@ -311,10 +311,11 @@ pair1_pipe_recv_cb(void *arg)
 	pair1_pipe *p = arg;
 	pair1_sock *s = p->pair;
 	nni_msg    *msg;
-	uint32_t    hdr;
+	uint32_t    hdr  = 0;
 	nni_pipe   *pipe = p->pipe;
 	size_t      len;
 	nni_aio    *a;
+	bool        split;
 
 	if (nni_aio_result(&p->aio_recv) != 0) {
 		nni_pipe_close(p->pipe);
@@ -325,11 +326,32 @@ pair1_pipe_recv_cb(void *arg)
 
 	// Store the pipe ID.
 	nni_msg_set_pipe(msg, nni_pipe_id(p->pipe));
-	len = nni_msg_len(msg);
+	len = nni_msg_len(msg) + nni_msg_header_len(msg);
+
+	// The hop count normally arrives at the front of the body, but
+	// inproc can leave it in the header, which is where we keep it.
+	split = (nni_msg_header_len(msg) == sizeof(uint32_t));
+	if ((!split) && (nni_msg_header_len(msg) != 0)) {
+		nng_msg *flat;
+
+		nni_aio_set_msg(&p->aio_recv, NULL);
+		if ((flat = nni_msg_pull_up(msg)) == NULL) {
+			// The pull up leaves the original alone on failure.
+			nni_msg_free(msg);
+			nni_pipe_recv(pipe, &p->aio_recv);
+			return;
+		}
+		msg = flat;
+		nni_aio_set_msg(&p->aio_recv, msg);
+	}
 
 	// If the message is missing the hop count header, scrap it.
-	if ((len < sizeof(uint32_t)) ||
-	    ((hdr = nni_msg_trim_u32(msg)) > 0xff)) {
+	if (split) {
+		hdr = nni_msg_header_peek_u32(msg);
+	} else if (len >= sizeof(uint32_t)) {
+		hdr = nni_msg_trim_u32(msg);
+	}
+	if ((len < sizeof(uint32_t)) || (hdr > 0xff)) {
 		BUMP_STAT(&s->stat_rx_malformed);
 		nni_msg_free(msg);
 		nni_pipe_close(pipe);
@@ -349,7 +371,9 @@ pair1_pipe_recv_cb(void *arg)
 	nni_sock_bump_rx(s->sock, len);
 
 	// Store the hop count in the header.
-	nni_msg_header_append_u32(msg, hdr);
+	if (!split) {
+		nni_msg_header_append_u32(msg, hdr);
+	}
 
 	nni_mtx_lock(&s->mtx);
 
@@ -789,7 +813,7 @@ static nni_proto pair1_proto = {
 	.proto_version  = NNI_PROTOCOL_VERSION,
 	.proto_self     = { PAIR1_SELF, PAIR1_SELF_NAME },
 	.proto_peer     = { PAIR1_PEER, PAIR1_PEER_NAME },
-	.proto_flags    = NNI_PROTO_FLAG_SNDRCV,
+	.proto_flags    = NNI_PROTO_FLAG_SNDRCV | NNI_PROTO_FLAG_SPLIT,
 	.proto_sock_ops = &pair1_sock_ops,
 	.proto_pipe_ops = &pair1_pipe_ops,
 };
@@ -817,7 +841,8 @@ static nni_proto pair1_proto_raw = {
 	.proto_version  = NNI_PROTOCOL_VERSION,
 	.proto_self     = { PAIR1_SELF, PAIR1_SELF_NAME },
 	.proto_peer     = { PAIR1_PEER, PAIR1_PEER_NAME },
-	.proto_flags    = NNI_PROTO_FLAG_SNDRCV | NNI_PROTO_FLAG_RAW,
+	.proto_flags =
+	    NNI_PROTO_FLAG_SNDRCV | NNI_PROTO_FLAG_RAW | NNI_PROTO_FLAG_SPLIT,
 	.proto_sock_ops = &pair1_sock_ops_raw,
 	.proto_pipe_ops = &pair1_pipe_ops,
 };
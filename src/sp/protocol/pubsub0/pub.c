@@ -11,11 +11,16 @@
 #include <string.h>
 
 #include "core/nng_impl.h"
+#include "sp/protocol/pubsub0/pubsub0.h"
 
 // Publish protocol.  The PUB protocol simply sends messages out, as
-// a broadcast.  It has nothing more sophisticated because it does not
-// perform sender-side filtering.  Its best effort delivery, so anything
-// that can't receive the message won't get one.
+// a broadcast.  Its best effort delivery, so anything that can't receive
+// the message won't get one.
+//
+// Subscribers that advertise their subscriptions (see pubsub0.h for the
+// format) get sender-side filtering: we only send them messages that
+// match one of their topics.  Until a subscriber advertises, which legacy
+// subscribers never do, it gets everything.
 
 #ifndef NNI_PROTO_SUB_V0
 #define NNI_PROTO_SUB_V0 NNI_PROTO(2, 1)
@@ -25,19 +30,38 @@
 #define NNI_PROTO_PUB_V0 NNI_PROTO(2, 0)
 #endif
 
-typedef struct pub0_pipe pub0_pipe;
-typedef struct pub0_sock pub0_sock;
+typedef struct pub0_pipe  pub0_pipe;
+typedef struct pub0_sock  pub0_sock;
+typedef struct pub0_pipes pub0_pipes;
 
 static void pub0_pipe_recv_cb(void *);
 static void pub0_pipe_send_cb(void *);
 static void pub0_sock_fini(void *);
 static void pub0_pipe_fini(void *);
 
-// pub0_sock is our per-socket protocol private structure.
+// pub0_pipes is an immutable, reference counted snapshot of the pipes
+// on the socket.  It is replaced whenever a pipe is added or removed.
+// Senders take a reference to the current snapshot under the socket lock,
+// and then fan out to the pipes without holding that lock.  The snapshot
+// holds a reference on each pipe, so they cannot be destroyed under us.
+struct pub0_pipes {
+	nni_atomic_int ref;
+	size_t         num;
+	pub0_pipe     *pipes[];
+};
+
+// pub0_sock is our per-socket protocol private structure.  The lock only
+// protects the list of pipes (and the sendbuf value); each pipe has its
+// own lock for its send queue.  With a single CPU though, nothing can
+// run alongside the publisher, so there the pipes just use the socket
+// lock, and we fan out under it, without taking snapshots.
 struct pub0_sock {
 	nni_list     pipes;
+	size_t       num_pipes;
+	pub0_pipes  *snap;
 	nni_mtx      mtx;
 	bool         closed;
+	bool         fine; // per-pipe locks and snapshots
 	size_t       sendbuf;
 	nni_pollable sendable;
 };
@@ -46,7 +70,11 @@ struct pub0_sock {
 struct pub0_pipe {
 	nni_pipe     *pipe;
 	pub0_sock    *pub;
+	nni_mtx      *mtx; // protects sendq, closed, busy, and the filter
+	nni_mtx       lock; // the above, unless it is the socket lock
 	nni_lmq       sendq;
+	nni_trie      subs; // advertised subscriptions, if filtered
+	bool          filtered;
 	bool          closed;
 	bool          busy;
 	nni_aio       aio_send;
@@ -54,11 +82,55 @@ struct pub0_pipe {
 	nni_list_node node;
 };
 
+static size_t
+pub0_pipes_size(size_t num)
+{
+	return (sizeof(pub0_pipes) + num * sizeof(pub0_pipe *));
+}
+
+static void
+pub0_pipes_rele(pub0_pipes *snap)
+{
+	if ((snap != NULL) && (nni_atomic_dec_nv(&snap->ref) == 0)) {
+		for (size_t i = 0; i < snap->num; i++) {
+			nni_pipe_rele(snap->pipes[i]->pipe);
+		}
+		nni_free(snap, pub0_pipes_size(snap->num));
+	}
+}
+
+// pub0_pipes_update rebuilds the snapshot from the list of pipes.
+// It must be called with the socket lock held, and returns the old
+// snapshot, which the caller must release after dropping the lock.
+static nng_err
+pub0_pipes_update(pub0_sock *sock, pub0_pipes **oldp)
+{
+	pub0_pipes *snap;
+	pub0_pipe  *p;
+	size_t      i;
+
+	if ((snap = nni_zalloc(pub0_pipes_size(sock->num_pipes))) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	nni_atomic_init(&snap->ref);
+	nni_atomic_set(&snap->ref, 1);
+	snap->num = sock->num_pipes;
+	i         = 0;
+	NNI_LIST_FOREACH (&sock->pipes, p) {
+		nni_pipe_hold(p->pipe);
+		snap->pipes[i++] = p;
+	}
+	*oldp      = sock->snap;
+	sock->snap = snap;
+	return (NNG_OK);
+}
+
 static void
 pub0_sock_fini(void *arg)
 {
 	pub0_sock *s = arg;
 
+	pub0_pipes_rele(s->snap);
 	nni_pollable_fini(&s->sendable);
 	nni_mtx_fini(&s->mtx);
 }
@@ -73,6 +145,7 @@ pub0_sock_init(void *arg, nni_sock *ns)
 	nni_mtx_init(&sock->mtx);
 	NNI_LIST_INIT(&sock->pipes, pub0_pipe, node);
 	sock->sendbuf = 16; // fairly arbitrary
+	sock->fine    = nni_plat_ncpu() > 1;
 }
 
 static void
@@ -104,6 +177,8 @@ pub0_pipe_fini(void *arg)
 	nni_aio_fini(&p->aio_send);
 	nni_aio_fini(&p->aio_recv);
 	nni_lmq_fini(&p->sendq);
+	nni_trie_fini(&p->subs);
+	nni_mtx_fini(&p->lock);
 }
 
 static int
@@ -117,7 +192,10 @@ pub0_pipe_init(void *arg, nni_pipe *pipe, void *s)
 	len = sock->sendbuf;
 	nni_mtx_unlock(&sock->mtx);
 
+	nni_mtx_init(&p->lock);
+	p->mtx = sock->fine ? &p->lock : &sock->mtx;
 	nni_lmq_init(&p->sendq, len);
+	nni_trie_init(&p->subs);
 	nni_aio_init(&p->aio_send, pub0_pipe_send_cb, p);
 	nni_aio_init(&p->aio_recv, pub0_pipe_recv_cb, p);
 
@@ -130,8 +208,10 @@ pub0_pipe_init(void *arg, nni_pipe *pipe, void *s)
 static int
 pub0_pipe_start(void *arg)
 {
-	pub0_pipe *p    = arg;
-	pub0_sock *sock = p->pub;
+	pub0_pipe  *p    = arg;
+	pub0_sock  *sock = p->pub;
+	pub0_pipes *old  = NULL;
+	nng_err     rv;
 
 	if (nni_pipe_peer(p->pipe) != NNI_PROTO_SUB_V0) {
 		nng_log_warn("NNG-PEER-MISMATCH",
@@ -141,7 +221,15 @@ pub0_pipe_start(void *arg)
 	}
 	nni_mtx_lock(&sock->mtx);
 	nni_list_append(&sock->pipes, p);
+	sock->num_pipes++;
+	if (sock->fine && ((rv = pub0_pipes_update(sock, &old)) != NNG_OK)) {
+		nni_list_remove(&sock->pipes, p);
+		sock->num_pipes--;
+		nni_mtx_unlock(&sock->mtx);
+		return (rv);
+	}
 	nni_mtx_unlock(&sock->mtx);
+	pub0_pipes_rele(old);
 
 	// Start the receiver.
 	nni_pipe_recv(p->pipe, &p->aio_recv);
@@ -152,40 +240,112 @@ pub0_pipe_start(void *arg)
 static void
 pub0_pipe_close(void *arg)
 {
-	pub0_pipe *p    = arg;
-	pub0_sock *sock = p->pub;
+	pub0_pipe  *p    = arg;
+	pub0_sock  *sock = p->pub;
+	pub0_pipes *old  = NULL;
 
 	nni_aio_close(&p->aio_send);
 	nni_aio_close(&p->aio_recv);
 
-	nni_mtx_lock(&sock->mtx);
+	nni_mtx_lock(p->mtx);
 	p->closed = true;
 	nni_lmq_flush(&p->sendq);
+	nni_mtx_unlock(p->mtx);
 
+	nni_mtx_lock(&sock->mtx);
 	if (nni_list_active(&sock->pipes, p)) {
 		nni_list_remove(&sock->pipes, p);
+		sock->num_pipes--;
+		// If we cannot allocate a new snapshot, we must still not
+		// keep the old one, as it holds this pipe.  Drop it, and
+		// the next send rebuilds it; until then we have no pipes,
+		// and messages are discarded, as PUB is free to do.
+		if (sock->fine && (pub0_pipes_update(sock, &old) != NNG_OK)) {
+			old        = sock->snap;
+			sock->snap = NULL;
+		}
 	}
 	nni_mtx_unlock(&sock->mtx);
+	pub0_pipes_rele(old);
+}
+
+// pub0_pipe_filter applies a subscription advertisement to the pipe's
+// filter.  The pipe lock must be held.  The values stored in the trie
+// are unused, but must be non-NULL, so we just use the pipe.
+static nng_err
+pub0_pipe_filter(pub0_pipe *p, nni_msg *msg)
+{
+	uint8_t *body = nni_msg_body(msg);
+	size_t   len  = nni_msg_len(msg);
+
+	p->filtered = true;
+	while (len > 0) {
+		uint8_t  op;
+		uint32_t sz;
+		nng_err  rv;
+
+		if (len < NNI_SUB0_ADV_HDR_SIZE) {
+			return (NNG_EPROTO);
+		}
+		op = body[0];
+		NNI_GET32(&body[1], sz);
+		body += NNI_SUB0_ADV_HDR_SIZE;
+		len -= NNI_SUB0_ADV_HDR_SIZE;
+		if (sz > len) {
+			return (NNG_EPROTO);
+		}
+		switch (op) {
+		case NNI_SUB0_ADV_SUBSCRIBE:
+			rv = nni_trie_insert(&p->subs, body, sz, p);
+			if ((rv != NNG_OK) && (rv != NNG_EEXIST)) {
+				return (rv);
+			}
+			break;
+		case NNI_SUB0_ADV_UNSUBSCRIBE:
+			(void) nni_trie_remove(&p->subs, body, sz);
+			break;
+		default:
+			return (NNG_EPROTO);
+		}
+		body += sz;
+		len -= sz;
+	}
+	return (NNG_OK);
 }
 
 static void
 pub0_pipe_recv_cb(void *arg)
 {
 	pub0_pipe *p = arg;
+	nni_msg   *msg;
+	nng_err    rv;
 
-	// We should never receive a message -- the only valid reason for us to
-	// be here is on pipe close.
-	if (nni_aio_result(&p->aio_recv) == 0) {
-		nni_msg_free(nni_aio_get_msg(&p->aio_recv));
+	// The only thing a subscriber may send us is an advertisement.
+	if (nni_aio_result(&p->aio_recv) != 0) {
+		nni_pipe_close(p->pipe);
+		return;
 	}
-	nni_pipe_close(p->pipe);
+	msg = nni_aio_get_msg(&p->aio_recv);
+	nni_aio_set_msg(&p->aio_recv, NULL);
+
+	nni_mtx_lock(p->mtx);
+	rv = pub0_pipe_filter(p, msg);
+	nni_mtx_unlock(p->mtx);
+	nni_msg_free(msg);
+
+	if (rv != NNG_OK) {
+		// A partially applied update would leave us with the wrong
+		// view of the subscriptions, so give up on the pipe.
+		nni_pipe_close(p->pipe);
+		return;
+	}
+	nni_pipe_recv(p->pipe, &p->aio_recv);
 }
 
 static void
 pub0_pipe_send_cb(void *arg)
 {
-	pub0_pipe *p    = arg;
-	pub0_sock *sock = p->pub;
+	pub0_pipe *p = arg;
 	nni_msg   *msg;
 
 	if (nni_aio_result(&p->aio_send) != 0) {
@@ -195,9 +355,9 @@ pub0_pipe_send_cb(void *arg)
 		return;
 	}
 
-	nni_mtx_lock(&sock->mtx);
+	nni_mtx_lock(p->mtx);
 	if (p->closed) {
-		nni_mtx_unlock(&sock->mtx);
+		nni_mtx_unlock(p->mtx);
 		return;
 	}
 	if (nni_lmq_get(&p->sendq, &msg) == 0) {
@@ -206,7 +366,7 @@ pub0_pipe_send_cb(void *arg)
 	} else {
 		p->busy = false;
 	}
-	nni_mtx_unlock(&sock->mtx);
+	nni_mtx_unlock(p->mtx);
 }
 
 static void
@@ -216,35 +376,74 @@ pub0_sock_recv(void *arg, nni_aio *aio)
 	nni_aio_finish_error(aio, NNG_ENOTSUP);
 }
 
+// pub0_pipe_put queues or sends a copy of the message on the pipe, if it
+// wants it.  The pipe lock must be held.
+static void
+pub0_pipe_put(pub0_pipe *p, nni_msg *msg, const void *body, size_t len)
+{
+	if (p->closed ||
+	    (p->filtered && !nni_trie_match(&p->subs, body, len))) {
+		return;
+	}
+	nni_msg_clone(msg);
+	if (p->busy) {
+		if (nni_lmq_full(&p->sendq)) {
+			// Make space for the new message.
+			nni_msg *old;
+			(void) nni_lmq_get(&p->sendq, &old);
+			nni_msg_free(old);
+		}
+		nni_lmq_put(&p->sendq, msg);
+	} else {
+		p->busy = true;
+		nni_aio_set_msg(&p->aio_send, msg);
+		nni_pipe_send(p->pipe, &p->aio_send);
+	}
+}
+
 static void
 pub0_sock_send(void *arg, nni_aio *aio)
 {
-	pub0_sock *sock = arg;
-	pub0_pipe *p;
-	nng_msg   *msg;
-	size_t     len;
+	pub0_sock  *sock = arg;
+	pub0_pipes *snap;
+	pub0_pipe  *p;
+	nng_msg    *msg;
+	size_t      len;
+	void       *body;
 
-	msg = nni_aio_get_msg(aio);
-	len = nni_msg_len(msg);
-	nni_mtx_lock(&sock->mtx);
-	NNI_LIST_FOREACH (&sock->pipes, p) {
+	msg  = nni_aio_get_msg(aio);
+	len  = nni_msg_len(msg);
+	body = nni_msg_body(msg);
 
-		nni_msg_clone(msg);
-		if (p->busy) {
-			if (nni_lmq_full(&p->sendq)) {
-				// Make space for the new message.
-				nni_msg *old;
-				(void) nni_lmq_get(&p->sendq, &old);
-				nni_msg_free(old);
-			}
-			nni_lmq_put(&p->sendq, msg);
-		} else {
-			p->busy = true;
-			nni_aio_set_msg(&p->aio_send, msg);
-			nni_pipe_send(p->pipe, &p->aio_send);
+	nni_mtx_lock(&sock->mtx);
+	if (!sock->fine) {
+		// The socket lock is the lock of every pipe.
+		NNI_LIST_FOREACH (&sock->pipes, p) {
+			pub0_pipe_put(p, msg, body, len);
 		}
+		nni_mtx_unlock(&sock->mtx);
+		nng_msg_free(msg);
+		nni_aio_finish(aio, 0, len);
+		return;
+	}
+
+	// Only hold the socket lock long enough to grab the pipes.
+	if ((sock->snap == NULL) && (sock->num_pipes > 0)) {
+		// A pipe closed when we could not rebuild the snapshot.
+		(void) pub0_pipes_update(sock, &snap);
+	}
+	if ((snap = sock->snap) != NULL) {
+		nni_atomic_inc(&snap->ref);
 	}
 	nni_mtx_unlock(&sock->mtx);
+
+	for (size_t i = 0; (snap != NULL) && (i < snap->num); i++) {
+		p = snap->pipes[i];
+		nni_mtx_lock(p->mtx);
+		pub0_pipe_put(p, msg, body, len);
+		nni_mtx_unlock(p->mtx);
+	}
+	pub0_pipes_rele(snap);
 	nng_msg_free(msg);
 	nni_aio_finish(aio, 0, len);
 }
@@ -279,7 +478,14 @@ pub0_sock_set_sendbuf(void *arg, const void *buf, size_t sz, nni_type t)
 		// well anyway.  There is a weird effect here where the
 		// buffers may have been set for *some* of the pipes, but
 		// we have no way to correct partial failure.
-		if ((rv = nni_lmq_resize(&p->sendq, (size_t) val)) != 0) {
+		if (sock->fine) {
+			nni_mtx_lock(p->mtx);
+		}
+		rv = nni_lmq_resize(&p->sendq, (size_t) val);
+		if (sock->fine) {
+			nni_mtx_unlock(p->mtx);
+		}
+		if (rv != 0) {
 			break;
 		}
 	}
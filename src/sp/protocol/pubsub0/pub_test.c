@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 //
 // This software is supplied under the terms of the MIT License, a
 // copy of which should be located in the distribution where this
@@ -7,6 +7,8 @@
 // found online at https://opensource.org/licenses/MIT.
 //
 
+#include <string.h>
+
 #include "nng/nng.h"
 #include <nuts.h>
 
@@ -202,6 +204,139 @@ test_pub_cooked(void)
 	NUTS_CLOSE(s);
 }
 
+#ifdef NNG_ENABLE_STATS
+// pipe_rx_msgs returns the number of messages received by the (only)
+// pipe on the given socket.
+static uint64_t
+pipe_rx_msgs(nng_socket s)
+{
+	nng_stat       *stats;
+	const nng_stat *st;
+	uint64_t        val = 0;
+
+	NUTS_PASS(nng_stats_get(&stats));
+	for (st = nng_stat_child(stats); st != NULL; st = nng_stat_next(st)) {
+		const nng_stat *sock;
+		if ((strcmp(nng_stat_name(st), "pipe") != 0) ||
+		    ((sock = nng_stat_find(st, "socket")) == NULL) ||
+		    (nng_stat_value(sock) != (uint64_t) nng_socket_id(s))) {
+			continue;
+		}
+		NUTS_TRUE((st = nng_stat_find(st, "rx_msgs")) != NULL);
+		val = nng_stat_value(st);
+		break;
+	}
+	nng_stats_free(stats);
+	return (val);
+}
+
+static void
+test_pub_filter_advertised(void)
+{
+	nng_socket pub;
+	nng_socket sub;
+	char      *addr;
+
+	NUTS_ADDR(addr, "ipc");
+	NUTS_PASS(nng_pub0_open(&pub));
+	NUTS_PASS(nng_sub0_open(&sub));
+	NUTS_PASS(nng_socket_set_bool(sub, NNG_OPT_SUB_ADVERTISE, true));
+	NUTS_PASS(nng_sub0_socket_subscribe(sub, "a", 1));
+	NUTS_PASS(nng_socket_set_ms(sub, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_listen(pub, addr, NULL, 0));
+	NUTS_PASS(nng_dial(sub, addr, NULL, 0));
+	NUTS_SLEEP(100);
+
+	// Only the matching messages should cross the wire.
+	NUTS_SEND(pub, "a1");
+	NUTS_SEND(pub, "b1");
+	NUTS_SEND(pub, "b2");
+	NUTS_SEND(pub, "a2");
+	NUTS_RECV(sub, "a1");
+	NUTS_RECV(sub, "a2");
+	NUTS_TRUE(pipe_rx_msgs(sub) == 2);
+
+	// Changes to the subscriptions are propagated.
+	NUTS_PASS(nng_sub0_socket_unsubscribe(sub, "a", 1));
+	NUTS_PASS(nng_sub0_socket_subscribe(sub, "c", 1));
+	NUTS_SLEEP(100);
+	NUTS_SEND(pub, "a3");
+	NUTS_SEND(pub, "c1");
+	NUTS_RECV(sub, "c1");
+	NUTS_TRUE(pipe_rx_msgs(sub) == 3);
+
+	NUTS_CLOSE(pub);
+	NUTS_CLOSE(sub);
+}
+
+static void
+test_pub_filter_packed(void)
+{
+	nng_socket  pub;
+	nng_socket  sub;
+	nng_msg    *msg;
+	char       *addr;
+	static char topic[16380];
+
+	// The initial advertisement is split into messages that fit the
+	// size limit with the record headers included, so a publisher that
+	// limits received messages to that size accepts them all.  Four of
+	// these topics would only fit if the headers were not counted.
+	NUTS_ADDR(addr, "ipc");
+	NUTS_PASS(nng_pub0_open(&pub));
+	NUTS_PASS(nng_sub0_open(&sub));
+	NUTS_PASS(nng_socket_set_size(pub, NNG_OPT_RECVMAXSZ, 65536));
+	NUTS_PASS(nng_socket_set_bool(sub, NNG_OPT_SUB_ADVERTISE, true));
+	memset(topic, 'a', sizeof(topic));
+	for (int i = 0; i < 4; i++) {
+		topic[0] = (char) ('A' + i);
+		NUTS_PASS(
+		    nng_sub0_socket_subscribe(sub, topic, sizeof(topic)));
+	}
+	NUTS_PASS(nng_socket_set_ms(sub, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_listen(pub, addr, NULL, 0));
+	NUTS_PASS(nng_dial(sub, addr, NULL, 0));
+	NUTS_SLEEP(100);
+
+	NUTS_SEND(pub, "b1");
+	topic[0] = 'A';
+	NUTS_PASS(nng_send(pub, topic, sizeof(topic), 0));
+	NUTS_PASS(nng_recvmsg(sub, &msg, 0));
+	NUTS_TRUE(nng_msg_len(msg) == sizeof(topic));
+	nng_msg_free(msg);
+	NUTS_TRUE(pipe_rx_msgs(sub) == 1);
+
+	NUTS_CLOSE(pub);
+	NUTS_CLOSE(sub);
+}
+
+static void
+test_pub_filter_legacy(void)
+{
+	nng_socket pub;
+	nng_socket sub;
+	char      *addr;
+
+	// Subscribers that do not advertise get everything.
+	NUTS_ADDR(addr, "ipc");
+	NUTS_PASS(nng_pub0_open(&pub));
+	NUTS_PASS(nng_sub0_open(&sub));
+	NUTS_PASS(nng_sub0_socket_subscribe(sub, "a", 1));
+	NUTS_PASS(nng_socket_set_ms(sub, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_listen(pub, addr, NULL, 0));
+	NUTS_PASS(nng_dial(sub, addr, NULL, 0));
+	NUTS_SLEEP(100);
+
+	NUTS_SEND(pub, "b1");
+	NUTS_SEND(pub, "a1");
+	NUTS_RECV(sub, "a1");
+	NUTS_TRUE(pipe_rx_msgs(sub) == 2);
+
+	NUTS_CLOSE(pub);
+	NUTS_CLOSE(sub);
+}
+#endif
+
 NUTS_TESTS = {
 	{ "pub identity", test_pub_identity },
 	{ "pub cannot recv", test_pub_cannot_recv },
@@ -213,5 +348,10 @@ NUTS_TESTS = {
 	{ "pub send no pipes", test_pub_send_no_pipes },
 	{ "pub send buf option", test_pub_send_buf_option },
 	{ "pub cooked", test_pub_cooked },
+#ifdef NNG_ENABLE_STATS
+	{ "pub filter advertised", test_pub_filter_advertised },
+	{ "pub filter packed", test_pub_filter_packed },
+	{ "pub filter legacy", test_pub_filter_legacy },
+#endif
 	{ NULL, NULL },
 };
@@ -0,0 +1,22 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#ifndef PROTOCOL_PUBSUB0_PUBSUB0_H
+#define PROTOCOL_PUBSUB0_PUBSUB0_H
+
+// Subscription advertisements, sent by subscribers to publishers.  Each
+// advertisement message is a sequence of records, each being an operation
+// byte, a 32-bit topic length (network byte order), and the topic itself.
+#define NNI_SUB0_ADV_SUBSCRIBE 1
+#define NNI_SUB0_ADV_UNSUBSCRIBE 2
+
+// Size of the record header, before the topic.
+#define NNI_SUB0_ADV_HDR_SIZE 5
+
+#endif // PROTOCOL_PUBSUB0_PUBSUB0_H
@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "core/nng_impl.h"
+#include "sp/protocol/pubsub0/pubsub0.h"
 
 // Subscriber protocol.  The SUB protocol receives messages sent to
 // it from publishers, and filters out those it is not interested in,
@@ -32,29 +33,63 @@
 // By default, prefer new messages when the queue is full.
 #define SUB0_DEFAULT_PREFER_NEW true
 
+// Subscription advertisements.  When enabled, the subscriber sends its
+// subscriptions to the publisher, so that the publisher can avoid sending
+// messages that would just be discarded.  (See pubsub0.h for the format.)
+// An empty message is valid, and tells the publisher to start filtering
+// with an empty set.  Legacy publishers close the pipe if they receive
+// anything, so this is off by default.  (Legacy subscribers never
+// advertise, and publishers just send them everything.)
+
+// Initial advertisements are packed into messages of at most this size,
+// unless a single topic is larger.
+#define SUB0_ADV_MSG_SIZE 65536
+
+// Advertisement queue depth per pipe.  This grows as needed, as we
+// must never drop an advertisement.
+#define SUB0_ADV_QUEUE_LEN 16
+
 typedef struct sub0_pipe  sub0_pipe;
 typedef struct sub0_sock  sub0_sock;
 typedef struct sub0_ctx   sub0_ctx;
 typedef struct sub0_topic sub0_topic;
+typedef struct sub0_sub   sub0_sub;
 
 static void sub0_recv_cb(void *);
+static void sub0_send_cb(void *);
 static void sub0_pipe_fini(void *);
+static void sub0_advertise(sub0_sock *, uint8_t, const void *, size_t);
 
+// sub0_topic is a distinct topic subscribed to by one or more contexts
+// on the socket.  It is the value stored in the socket's topic index, so
+// that a single lookup finds every context interested in a message.
 struct sub0_topic {
 	nni_list_node node;
+	nni_list      subs; // sub0_sub, one per subscribing context
 	size_t        len;
 	void         *buf;
 };
 
+// sub0_sub is a single subscription, joining a context to a topic.
+struct sub0_sub {
+	nni_list_node ctx_node;
+	nni_list_node topic_node;
+	sub0_ctx     *ctx;
+	sub0_topic   *topic;
+};
+
 // sub0_ctx is a context for a SUB socket.  The advantage of contexts is
 // that different contexts can maintain different subscriptions.
 struct sub0_ctx {
 	nni_list_node node;
 	sub0_sock    *sock;
-	nni_list      topics;     // TODO: Consider patricia trie
+	nni_trie      topics;     // our subscriptions (sub0_sub), by topic
+	nni_list      subs;       // same subscriptions, for teardown
 	nni_list      recv_queue; // can have multiple pending receives
 	nni_lmq       lmq;
 	bool          prefer_new;
+	uint64_t      match_gen;  // last message matched, see sub0_recv_cb
+	sub0_ctx     *match_next; // chain of contexts matching a message
 };
 
 // sub0_sock is our per-socket protocol private structure.
@@ -62,17 +97,26 @@ struct sub0_sock {
 	nni_pollable readable;
 	sub0_ctx     master;   // default context
 	nni_list     contexts; // all contexts
-	int          num_contexts;
+	nni_trie     topics;   // all subscriptions (sub0_topic), by topic
+	nni_list     topic_list;
+	nni_list     adv_pipes; // pipes we advertise subscriptions on
+	uint64_t     match_gen;
+	sub0_ctx    *matched;
 	size_t       recv_buf_len;
 	bool         prefer_new;
+	bool         advertise;
 	nni_mtx      lk;
 };
 
 // sub0_pipe is our per-pipe protocol private structure.
 struct sub0_pipe {
-	nni_pipe  *pipe;
-	sub0_sock *sub;
-	nni_aio    aio_recv;
+	nni_pipe     *pipe;
+	sub0_sock    *sub;
+	nni_aio       aio_recv;
+	nni_aio       aio_send; // for advertisements
+	nni_lmq       sendq;
+	bool          busy;
+	nni_list_node node;
 };
 
 static void
@@ -143,26 +187,47 @@ sub0_ctx_close(void *arg)
 	nni_mtx_unlock(&sock->lk);
 }
 
+// sub0_sub_free removes a subscription from both the context and the
+// socket.  The topic is discarded when the last context leaves it.
+static void
+sub0_sub_free(sub0_sub *sub)
+{
+	sub0_ctx   *ctx   = sub->ctx;
+	sub0_sock  *sock  = ctx->sock;
+	sub0_topic *topic = sub->topic;
+
+	nni_list_remove(&ctx->subs, sub);
+	nni_list_remove(&topic->subs, sub);
+	(void) nni_trie_remove(&ctx->topics, topic->buf, topic->len);
+	NNI_FREE_STRUCT(sub);
+
+	if (nni_list_empty(&topic->subs)) {
+		(void) nni_trie_remove(&sock->topics, topic->buf, topic->len);
+		nni_list_remove(&sock->topic_list, topic);
+		sub0_advertise(
+		    sock, NNI_SUB0_ADV_UNSUBSCRIBE, topic->buf, topic->len);
+		nni_free(topic->buf, topic->len);
+		NNI_FREE_STRUCT(topic);
+	}
+}
+
 static void
 sub0_ctx_fini(void *arg)
 {
-	sub0_ctx   *ctx  = arg;
-	sub0_sock  *sock = ctx->sock;
-	sub0_topic *topic;
+	sub0_ctx  *ctx  = arg;
+	sub0_sock *sock = ctx->sock;
+	sub0_sub  *sub;
 
 	sub0_ctx_close(ctx);
 
 	nni_mtx_lock(&sock->lk);
 	nni_list_remove(&sock->contexts, ctx);
-	sock->num_contexts--;
-	nni_mtx_unlock(&sock->lk);
-
-	while ((topic = nni_list_first(&ctx->topics)) != 0) {
-		nni_list_remove(&ctx->topics, topic);
-		nni_free(topic->buf, topic->len);
-		NNI_FREE_STRUCT(topic);
+	while ((sub = nni_list_first(&ctx->subs)) != NULL) {
+		sub0_sub_free(sub);
 	}
+	nni_mtx_unlock(&sock->lk);
 
+	nni_trie_fini(&ctx->topics);
 	nni_lmq_fini(&ctx->lmq);
 }
 
@@ -182,12 +247,13 @@ sub0_ctx_init(void *ctx_arg, void *sock_arg)
 	ctx->prefer_new = prefer_new;
 
 	nni_aio_list_init(&ctx->recv_queue);
-	NNI_LIST_INIT(&ctx->topics, sub0_topic, node);
+	nni_trie_init(&ctx->topics);
+	NNI_LIST_INIT(&ctx->subs, sub0_sub, ctx_node);
 
-	ctx->sock = sock;
+	ctx->sock      = sock;
+	ctx->match_gen = sock->match_gen;
 
 	nni_list_append(&sock->contexts, ctx);
-	sock->num_contexts++;
 	nni_mtx_unlock(&sock->lk);
 }
 
@@ -197,6 +263,7 @@ sub0_sock_fini(void *arg)
 	sub0_sock *sock = arg;
 
 	sub0_ctx_fini(&sock->master);
+	nni_trie_fini(&sock->topics);
 	nni_pollable_fini(&sock->readable);
 	nni_mtx_fini(&sock->lk);
 }
@@ -209,6 +276,9 @@ sub0_sock_init(void *arg, nni_sock *unused)
 	NNI_ARG_UNUSED(unused);
 
 	NNI_LIST_INIT(&sock->contexts, sub0_ctx, node);
+	NNI_LIST_INIT(&sock->topic_list, sub0_topic, node);
+	NNI_LIST_INIT(&sock->adv_pipes, sub0_pipe, node);
+	nni_trie_init(&sock->topics);
 	nni_mtx_init(&sock->lk);
 	sock->recv_buf_len = SUB0_DEFAULT_RECV_BUF_LEN;
 	sock->prefer_new   = SUB0_DEFAULT_PREFER_NEW;
@@ -236,6 +306,7 @@ sub0_pipe_stop(void *arg)
 	sub0_pipe *p = arg;
 
 	nni_aio_stop(&p->aio_recv);
+	nni_aio_stop(&p->aio_send);
 }
 
 static void
@@ -244,6 +315,8 @@ sub0_pipe_fini(void *arg)
 	sub0_pipe *p = arg;
 
 	nni_aio_fini(&p->aio_recv);
+	nni_aio_fini(&p->aio_send);
+	nni_lmq_fini(&p->sendq);
 }
 
 static int
@@ -252,16 +325,143 @@ sub0_pipe_init(void *arg, nni_pipe *pipe, void *s)
 	sub0_pipe *p = arg;
 
 	nni_aio_init(&p->aio_recv, sub0_recv_cb, p);
+	nni_aio_init(&p->aio_send, sub0_send_cb, p);
+	nni_lmq_init(&p->sendq, SUB0_ADV_QUEUE_LEN);
+	NNI_LIST_NODE_INIT(&p->node);
 
 	p->pipe = pipe;
 	p->sub  = s;
 	return (0);
 }
 
+// sub0_pipe_send queues an advertisement message for the pipe.
+// The socket lock must be held.
+static void
+sub0_pipe_send(sub0_pipe *p, nni_msg *msg)
+{
+	if (!p->busy) {
+		p->busy = true;
+		nni_aio_set_msg(&p->aio_send, msg);
+		nni_pipe_send(p->pipe, &p->aio_send);
+		return;
+	}
+	if (nni_lmq_full(&p->sendq) &&
+	    (nni_lmq_resize(&p->sendq, nni_lmq_cap(&p->sendq) * 2) != 0)) {
+		// We cannot lose an advertisement, as that would cause the
+		// publisher to filter out messages we want.  Closing the
+		// pipe will cause a reconnect and a full resync.
+		nni_msg_free(msg);
+		nni_pipe_close(p->pipe);
+		return;
+	}
+	(void) nni_lmq_put(&p->sendq, msg);
+}
+
+static void
+sub0_send_cb(void *arg)
+{
+	sub0_pipe *p    = arg;
+	sub0_sock *sock = p->sub;
+	nni_msg   *msg;
+
+	if (nni_aio_result(&p->aio_send) != 0) {
+		nni_msg_free(nni_aio_get_msg(&p->aio_send));
+		nni_aio_set_msg(&p->aio_send, NULL);
+		nni_pipe_close(p->pipe);
+		return;
+	}
+	nni_mtx_lock(&sock->lk);
+	if (nni_lmq_get(&p->sendq, &msg) == 0) {
+		nni_aio_set_msg(&p->aio_send, msg);
+		nni_pipe_send(p->pipe, &p->aio_send);
+	} else {
+		p->busy = false;
+	}
+	nni_mtx_unlock(&sock->lk);
+}
+
+static nng_err
+sub0_adv_append(nni_msg *msg, uint8_t op, const void *buf, size_t sz)
+{
+	uint8_t hdr[NNI_SUB0_ADV_HDR_SIZE];
+	nng_err rv;
+
+	hdr[0] = op;
+	NNI_PUT32(&hdr[1], (uint32_t) sz);
+	if (((rv = nni_msg_append(msg, hdr, sizeof(hdr))) != 0) ||
+	    ((rv = nni_msg_append(msg, buf, sz)) != 0)) {
+		return (rv);
+	}
+	return (NNG_OK);
+}
+
+// sub0_advertise sends a single subscription change to every pipe
+// that we advertise on.  The socket lock must be held.
+static void
+sub0_advertise(sub0_sock *sock, uint8_t op, const void *buf, size_t sz)
+{
+	sub0_pipe *p;
+	nni_msg   *msg;
+
+	if (nni_list_empty(&sock->adv_pipes)) {
+		return;
+	}
+	if ((nni_msg_alloc(&msg, 0) != 0) ||
+	    (sub0_adv_append(msg, op, buf, sz) != NNG_OK)) {
+		// Without the advertisement the publishers would have a
+		// stale view, so make them start over.
+		nni_msg_free(msg);
+		NNI_LIST_FOREACH (&sock->adv_pipes, p) {
+			nni_pipe_close(p->pipe);
+		}
+		return;
+	}
+	NNI_LIST_FOREACH (&sock->adv_pipes, p) {
+		nni_msg_clone(msg);
+		sub0_pipe_send(p, msg);
+	}
+	nni_msg_free(msg);
+}
+
+// sub0_pipe_advertise sends the full set of subscriptions to a newly
+// connected pipe, packing as many topics as fit in each message.  We
+// always send at least one message, even if it is empty.
+static nng_err
+sub0_pipe_advertise(sub0_pipe *p)
+{
+	sub0_sock  *sock = p->sub;
+	sub0_topic *topic;
+	nni_msg    *msg;
+	nng_err     rv;
+
+	if ((rv = nni_msg_alloc(&msg, 0)) != 0) {
+		return (rv);
+	}
+	NNI_LIST_FOREACH (&sock->topic_list, topic) {
+		if ((nni_msg_len(msg) > 0) &&
+		    (nni_msg_len(msg) + NNI_SUB0_ADV_HDR_SIZE + topic->len >
+		        SUB0_ADV_MSG_SIZE)) {
+			sub0_pipe_send(p, msg);
+			if ((rv = nni_msg_alloc(&msg, 0)) != 0) {
+				return (rv);
+			}
+		}
+		if ((rv = sub0_adv_append(msg, NNI_SUB0_ADV_SUBSCRIBE,
+		         topic->buf, topic->len)) != NNG_OK) {
+			nni_msg_free(msg);
+			return (rv);
+		}
+	}
+	sub0_pipe_send(p, msg);
+	return (NNG_OK);
+}
+
 static int
 sub0_pipe_start(void *arg)
 {
-	sub0_pipe *p = arg;
+	sub0_pipe *p    = arg;
+	sub0_sock *sock = p->sub;
+	nng_err    rv;
 
 	if (nni_pipe_peer(p->pipe) != NNI_PROTO_PUB_V0) {
 		// Peer protocol mismatch.
@@ -271,6 +471,16 @@ sub0_pipe_start(void *arg)
 		return (NNG_EPROTO);
 	}
 
+	nni_mtx_lock(&sock->lk);
+	if (sock->advertise) {
+		if ((rv = sub0_pipe_advertise(p)) != NNG_OK) {
+			nni_mtx_unlock(&sock->lk);
+			return (rv);
+		}
+		nni_list_append(&sock->adv_pipes, p);
+	}
+	nni_mtx_unlock(&sock->lk);
+
 	nni_pipe_recv(p->pipe, &p->aio_recv);
 	return (0);
 }
@@ -278,28 +488,46 @@ sub0_pipe_start(void *arg)
 static void
 sub0_pipe_close(void *arg)
 {
-	sub0_pipe *p = arg;
+	sub0_pipe *p    = arg;
+	sub0_sock *sock = p->sub;
 
 	nni_aio_close(&p->aio_recv);
+	nni_aio_close(&p->aio_send);
+
+	nni_mtx_lock(&sock->lk);
+	if (nni_list_node_active(&p->node)) {
+		nni_list_remove(&sock->adv_pipes, p);
+	}
+	nni_lmq_flush(&p->sendq);
+	nni_mtx_unlock(&sock->lk);
 }
 
 static bool
 sub0_matches(sub0_ctx *ctx, uint8_t *body, size_t len)
 {
-	sub0_topic *topic;
+	return (nni_trie_match(&ctx->topics, body, len));
+}
 
-	// This is a naive and trivial matcher.  Replace with a real
-	// patricia trie later.
-	NNI_LIST_FOREACH (&ctx->topics, topic) {
-		if (len < topic->len) {
-			continue;
-		}
-		if ((topic->len == 0) ||
-		    (memcmp(topic->buf, body, topic->len) == 0)) {
-			return (true);
+// sub0_topic_matched is called for every socket level topic that matches
+// the message.  It chains each subscribing context onto the delivery set,
+// using the generation number to visit each context at most once (as a
+// context may hold several matching topics.)  This gives us the effect of
+// a per-message bitmap of contexts, without having to clear one.
+static void
+sub0_topic_matched(void *arg, void *val)
+{
+	sub0_sock  *sock  = arg;
+	sub0_topic *topic = val;
+	sub0_sub   *sub;
+
+	NNI_LIST_FOREACH (&topic->subs, sub) {
+		sub0_ctx *ctx = sub->ctx;
+		if (ctx->match_gen != sock->match_gen) {
+			ctx->match_gen  = sock->match_gen;
+			ctx->match_next = sock->matched;
+			sock->matched   = ctx;
 		}
 	}
-	return (false);
 }
 
 static void
@@ -310,10 +538,12 @@ sub0_recv_cb(void *arg)
 	sub0_ctx           *ctx;
 	nni_msg            *msg;
 	size_t              len;
-	uint8_t            *body;
 	nng_aio            *aio;
 	nni_msg            *dup_msg;
 	nni_aio_completions finish;
+	unsigned            num_queue;
+	unsigned            num_direct;
+	bool                any_queued;
 
 	if (nni_aio_result(&p->aio_recv) != 0) {
 		nni_pipe_close(p->pipe);
@@ -326,72 +556,83 @@ sub0_recv_cb(void *arg)
 	nni_aio_set_msg(&p->aio_recv, NULL);
 	nni_msg_set_pipe(msg, nni_pipe_id(p->pipe));
 
-	body    = nni_msg_body(msg);
-	len     = nni_msg_len(msg);
-	dup_msg = NULL;
+	len = nni_msg_len(msg);
 
 	nni_mtx_lock(&sock->lk);
-	// Go through all contexts.  We will try to send up.
-	NNI_LIST_FOREACH (&sock->contexts, ctx) {
-		bool queued = false;
-
-		if (nni_lmq_full(&ctx->lmq) && !ctx->prefer_new) {
-			// Cannot deliver here, as receive buffer is full.
-			continue;
-		}
 
-		if (!sub0_matches(ctx, body, len)) {
-			continue;
+	// A single lookup in the socket wide index yields every context
+	// that has a matching subscription.
+	sock->match_gen++;
+	sock->matched = NULL;
+	nni_trie_match_all(
+	    &sock->topics, nni_msg_body(msg), len, sub0_topic_matched, sock);
+
+	// Count the receivers first, so that we know which one can just
+	// have our own reference to the message.  Contexts with a waiting
+	// receiver hand the message straight to the user, so it must be
+	// exclusive to them; queued deliveries are just reference counted
+	// clones, and are made unique (copied) only when received, if still
+	// shared at that point.
+	num_queue  = 0;
+	num_direct = 0;
+	for (ctx = sock->matched; ctx != NULL; ctx = ctx->match_next) {
+		if (!nni_list_empty(&ctx->recv_queue)) {
+			num_direct++;
+		} else if (ctx->prefer_new || !nni_lmq_full(&ctx->lmq)) {
+			num_queue++;
 		}
+	}
+	any_queued = num_queue > 0;
 
-		// This is a performance optimization, that ensures we
-		// do not duplicate a message in the common case, where there
-		// is only a single context.
-		if (sock->num_contexts > 1) {
-			if (nni_msg_dup(&dup_msg, msg) != 0) {
+	for (ctx = sock->matched; ctx != NULL; ctx = ctx->match_next) {
+		if (!nni_list_empty(&ctx->recv_queue)) {
+			num_direct--;
+			if ((!any_queued) && (num_direct == 0)) {
+				dup_msg = msg;
+				msg     = NULL;
+			} else if (nni_msg_dup(&dup_msg, msg) != 0) {
 				// if we cannot dup it, continue on
 				continue;
 			}
-		} else {
-			// We only have one context, so it's the only
-			// possible message.
-			dup_msg = msg;
-		}
-
-		if (!nni_list_empty(&ctx->recv_queue)) {
 			aio = nni_list_first(&ctx->recv_queue);
 			nni_list_remove(&ctx->recv_queue, aio);
 			nni_aio_set_msg(aio, dup_msg);
 
 			// Save for synchronous completion
 			nni_aio_completions_add(&finish, aio, 0, len);
-		} else if (nni_lmq_full(&ctx->lmq)) {
-			// Make space for the new message.
+			continue;
+		}
+
+		if (nni_lmq_full(&ctx->lmq)) {
 			nni_msg *old;
+			if (!ctx->prefer_new) {
+				// Cannot deliver here, as receive buffer is
+				// full.
+				continue;
+			}
+			// Make space for the new message.
 			(void) nni_lmq_get(&ctx->lmq, &old);
 			nni_msg_free(old);
+		}
 
-			(void) nni_lmq_put(&ctx->lmq, dup_msg);
-			queued = true;
-
+		num_queue--;
+		if ((num_queue == 0) && (num_direct == 0)) {
+			dup_msg = msg;
+			msg     = NULL;
 		} else {
-			(void) nni_lmq_put(&ctx->lmq, dup_msg);
-			queued = true;
+			nni_msg_clone(msg);
+			dup_msg = msg;
 		}
-		if (queued && ctx == &sock->master) {
+		(void) nni_lmq_put(&ctx->lmq, dup_msg);
+		if (ctx == &sock->master) {
 			nni_pollable_raise(&sock->readable);
 		}
 	}
+	sock->matched = NULL;
 	nni_mtx_unlock(&sock->lk);
 
-	// NB: This is slightly less efficient in that we may have
-	// created an extra copy in the face of e.g. two subscriptions,
-	// but optimizing this further would require checking the subscription
-	// list twice, adding complexity.  If this turns out to be a problem
-	// we could probably add some other sophistication with a counter
-	// and flags on the contexts themselves.
-	if (msg != dup_msg) {
-		// If we didn't just use the message, then free our copy.
+	// If nobody took over our reference, drop it.
+	if (msg != NULL) {
 		nni_msg_free(msg);
 	}
 
@@ -439,69 +680,94 @@ sub0_ctx_set_recv_buf_len(void *arg, const void *buf, size_t sz, nni_type t)
 	return (NNG_OK);
 }
 
-// For now, we maintain subscriptions on a sorted linked list.  As we do not
-// expect to have huge numbers of subscriptions, and as the operation is
-// really O(n), we think this is acceptable.  In the future we might decide
-// to replace this with a patricia trie, like old nanomsg had.
+// Subscriptions are kept in radix tries, so that subscribe, unsubscribe,
+// and matching all cost time proportional to the topic (or message) length,
+// rather than to the number of subscriptions.  Each context has its own
+// trie, which we use for duplicate detection and to filter queued messages
+// on unsubscribe, while the socket keeps a single trie shared by all
+// contexts that is used on the receive path.
 
 static nng_err
 sub0_ctx_subscribe(sub0_ctx *ctx, const void *buf, size_t sz)
 {
 	sub0_sock  *sock = ctx->sock;
 	sub0_topic *topic;
-	sub0_topic *new_topic;
+	sub0_sub   *sub;
+	nng_err     rv;
 
 	nni_mtx_lock(&sock->lk);
-	NNI_LIST_FOREACH (&ctx->topics, topic) {
-		if (topic->len != sz) {
-			continue;
-		}
-		if (memcmp(topic->buf, buf, sz) == 0) {
-			// Already have it.
-			nni_mtx_unlock(&sock->lk);
-			return (NNG_OK);
-		}
-	}
-	if ((new_topic = NNI_ALLOC_STRUCT(new_topic)) == NULL) {
+	if (nni_trie_find(&ctx->topics, buf, sz) != NULL) {
+		// Already have it.
 		nni_mtx_unlock(&sock->lk);
-		return (NNG_ENOMEM);
+		return (NNG_OK);
 	}
-	if ((sz > 0) && ((new_topic->buf = nni_alloc(sz)) == NULL)) {
+	if ((sub = NNI_ALLOC_STRUCT(sub)) == NULL) {
 		nni_mtx_unlock(&sock->lk);
-		NNI_FREE_STRUCT(new_topic);
 		return (NNG_ENOMEM);
 	}
-	if (buf && new_topic->buf) {
-		memcpy(new_topic->buf, buf, sz);
+	if ((topic = nni_trie_find(&sock->topics, buf, sz)) == NULL) {
+		if ((topic = NNI_ALLOC_STRUCT(topic)) == NULL) {
+			nni_mtx_unlock(&sock->lk);
+			NNI_FREE_STRUCT(sub);
+			return (NNG_ENOMEM);
+		}
+		if ((sz > 0) && ((topic->buf = nni_alloc(sz)) == NULL)) {
+			nni_mtx_unlock(&sock->lk);
+			NNI_FREE_STRUCT(topic);
+			NNI_FREE_STRUCT(sub);
+			return (NNG_ENOMEM);
+		}
+		if (sz > 0) {
+			memcpy(topic->buf, buf, sz);
+		}
+		topic->len = sz;
+		NNI_LIST_INIT(&topic->subs, sub0_sub, topic_node);
+		if ((rv = nni_trie_insert(&sock->topics, buf, sz, topic)) !=
+		    NNG_OK) {
+			nni_mtx_unlock(&sock->lk);
+			nni_free(topic->buf, topic->len);
+			NNI_FREE_STRUCT(topic);
+			NNI_FREE_STRUCT(sub);
+			return (rv);
+		}
+		nni_list_append(&sock->topic_list, topic);
+		sub0_advertise(sock, NNI_SUB0_ADV_SUBSCRIBE, buf, sz);
+	}
+	sub->ctx   = ctx;
+	sub->topic = topic;
+	nni_list_append(&topic->subs, sub);
+	nni_list_append(&ctx->subs, sub);
+	if ((rv = nni_trie_insert(&ctx->topics, buf, sz, sub)) != NNG_OK) {
+		// This also releases the topic if we just created it.
+		nni_list_remove(&ctx->subs, sub);
+		nni_list_remove(&topic->subs, sub);
+		NNI_FREE_STRUCT(sub);
+		if (nni_list_empty(&topic->subs)) {
+			(void) nni_trie_remove(&sock->topics, buf, sz);
+			nni_list_remove(&sock->topic_list, topic);
+			sub0_advertise(
+			    sock, NNI_SUB0_ADV_UNSUBSCRIBE, buf, sz);
+			nni_free(topic->buf, topic->len);
+			NNI_FREE_STRUCT(topic);
+		}
 	}
-	new_topic->len = sz;
-	nni_list_append(&ctx->topics, new_topic);
 	nni_mtx_unlock(&sock->lk);
-	return (NNG_OK);
+	return (rv);
 }
 
 static nng_err
 sub0_ctx_unsubscribe(sub0_ctx *ctx, const void *buf, size_t sz)
 {
-	sub0_sock  *sock = ctx->sock;
-	sub0_topic *topic;
-	size_t      len;
+	sub0_sock *sock = ctx->sock;
+	sub0_sub  *sub;
+	size_t     len;
 
 	nni_mtx_lock(&sock->lk);
-	NNI_LIST_FOREACH (&ctx->topics, topic) {
-		if (topic->len != sz) {
-			continue;
-		}
-		if (memcmp(topic->buf, buf, sz) == 0) {
-			// Matched!
-			break;
-		}
-	}
-	if (topic == NULL) {
+	if ((sub = nni_trie_find(&ctx->topics, buf, sz)) == NULL) {
 		nni_mtx_unlock(&sock->lk);
 		return (NNG_ENOENT);
 	}
-	nni_list_remove(&ctx->topics, topic);
+	sub0_sub_free(sub);
 
 	// Now we need to make sure that any messages that are waiting still
 	// match the subscription.  We basically just run through the queue
@@ -518,9 +784,6 @@ sub0_ctx_unsubscribe(sub0_ctx *ctx, const void *buf, size_t sz)
 		}
 	}
 	nni_mtx_unlock(&sock->lk);
-
-	nni_free(topic->buf, topic->len);
-	NNI_FREE_STRUCT(topic);
 	return (NNG_OK);
 }
 
@@ -560,6 +823,38 @@ sub0_ctx_set_prefer_new(void *arg, const void *buf, size_t sz, nni_type t)
 	return (NNG_OK);
 }
 
+static nng_err
+sub0_sock_get_advertise(void *arg, void *buf, size_t *szp, nni_type t)
+{
+	sub0_sock *sock = arg;
+	bool       val;
+
+	nni_mtx_lock(&sock->lk);
+	val = sock->advertise;
+	nni_mtx_unlock(&sock->lk);
+
+	return (nni_copyout_bool(val, buf, szp, t));
+}
+
+// Changing this only affects pipes connected afterwards.
+static nng_err
+sub0_sock_set_advertise(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	sub0_sock *sock = arg;
+	bool       val;
+	nng_err    rv;
+
+	if ((rv = nni_copyin_bool(&val, buf, sz, t)) != NNG_OK) {
+		return (rv);
+	}
+
+	nni_mtx_lock(&sock->lk);
+	sock->advertise = val;
+	nni_mtx_unlock(&sock->lk);
+
+	return (NNG_OK);
+}
+
 static nni_option sub0_ctx_options[] = {
 	{
 	    .o_name = NNG_OPT_RECVBUF,
@@ -658,6 +953,11 @@ static nni_option sub0_sock_options[] = {
 	    .o_get  = sub0_sock_get_prefer_new,
 	    .o_set  = sub0_sock_set_prefer_new,
 	},
+	{
+	    .o_name = NNG_OPT_SUB_ADVERTISE,
+	    .o_get  = sub0_sock_get_advertise,
+	    .o_set  = sub0_sock_set_advertise,
+	},
 	// terminate list
 	{
 	    .o_name = NULL,
@@ -377,6 +377,25 @@ test_sub_prefer_new_option(void)
 	NUTS_CLOSE(sub);
 }
 
+static void
+test_sub_advertise_option(void)
+{
+	nng_socket  sub;
+	bool        b;
+	const char *opt = NNG_OPT_SUB_ADVERTISE;
+
+	NUTS_PASS(nng_sub0_open(&sub));
+
+	NUTS_PASS(nng_socket_get_bool(sub, opt, &b));
+	NUTS_TRUE(b == false);
+	NUTS_PASS(nng_socket_set_bool(sub, opt, true));
+	NUTS_PASS(nng_socket_get_bool(sub, opt, &b));
+	NUTS_TRUE(b == true);
+	NUTS_FAIL(nng_socket_set_int(sub, opt, 1), NNG_EBADTYPE);
+
+	NUTS_CLOSE(sub);
+}
+
 void
 test_sub_drop_new(void)
 {
@@ -558,6 +577,101 @@ test_sub_multi_context(void)
 	nng_aio_free(aio2);
 }
 
+static void
+test_sub_shared_topics(void)
+{
+	nng_socket sub;
+	nng_socket pub;
+	nng_ctx    c1;
+	nng_ctx    c2;
+	nng_aio   *aio1;
+	nng_aio   *aio2;
+	nng_msg   *m1;
+	nng_msg   *m2;
+
+	NUTS_PASS(nng_sub0_open(&sub));
+	NUTS_PASS(nng_pub0_open(&pub));
+	NUTS_PASS(nng_aio_alloc(&aio1, NULL, NULL));
+	NUTS_PASS(nng_aio_alloc(&aio2, NULL, NULL));
+	NUTS_PASS(nng_ctx_open(&c1, sub));
+	NUTS_PASS(nng_ctx_open(&c2, sub));
+
+	// Overlapping subscriptions must still deliver only once.
+	NUTS_PASS(nng_sub0_ctx_subscribe(c1, "a", 1));
+	NUTS_PASS(nng_sub0_ctx_subscribe(c1, "ab", 2));
+	NUTS_PASS(nng_sub0_ctx_subscribe(c2, "ab", 2));
+	NUTS_PASS(nng_sub0_ctx_subscribe(c2, "ab", 2));
+
+	nng_aio_set_timeout(aio1, 1000);
+	nng_aio_set_timeout(aio2, 1000);
+
+	NUTS_MARRY(pub, sub);
+
+	// Both contexts are waiting, so each must get its own message.
+	nng_ctx_recv(c1, aio1);
+	nng_ctx_recv(c2, aio2);
+	NUTS_SEND(pub, "abc");
+	nng_aio_wait(aio1);
+	nng_aio_wait(aio2);
+	NUTS_PASS(nng_aio_result(aio1));
+	NUTS_PASS(nng_aio_result(aio2));
+	m1 = nng_aio_get_msg(aio1);
+	m2 = nng_aio_get_msg(aio2);
+	NUTS_TRUE(m1 != m2);
+	NUTS_MATCH(nng_msg_body(m1), "abc");
+	NUTS_MATCH(nng_msg_body(m2), "abc");
+	nng_msg_free(m1);
+	nng_msg_free(m2);
+
+	// Now queued delivery; the second receive would time out if we
+	// delivered to c1 twice.
+	NUTS_SEND(pub, "abd");
+	NUTS_SLEEP(100);
+	nng_ctx_recv(c1, aio1);
+	nng_aio_wait(aio1);
+	NUTS_PASS(nng_aio_result(aio1));
+	m1 = nng_aio_get_msg(aio1);
+	NUTS_MATCH(nng_msg_body(m1), "abd");
+	// Modifying our copy must not affect the other context.
+	NUTS_PASS(nng_msg_append(m1, "!", 1));
+	nng_msg_free(m1);
+	nng_ctx_recv(c2, aio2);
+	nng_aio_wait(aio2);
+	NUTS_PASS(nng_aio_result(aio2));
+	m2 = nng_aio_get_msg(aio2);
+	NUTS_MATCH(nng_msg_body(m2), "abd");
+	nng_msg_free(m2);
+
+	nng_aio_set_timeout(aio1, 100);
+	nng_ctx_recv(c1, aio1);
+	nng_aio_wait(aio1);
+	NUTS_FAIL(nng_aio_result(aio1), NNG_ETIMEDOUT);
+
+	// Dropping the topic from one context leaves it for the other.
+	NUTS_PASS(nng_sub0_ctx_unsubscribe(c2, "ab", 2));
+	NUTS_FAIL(nng_sub0_ctx_unsubscribe(c2, "ab", 2), NNG_ENOENT);
+	NUTS_SEND(pub, "abe");
+	nng_ctx_recv(c1, aio1);
+	nng_aio_wait(aio1);
+	NUTS_PASS(nng_aio_result(aio1));
+	m1 = nng_aio_get_msg(aio1);
+	NUTS_MATCH(nng_msg_body(m1), "abe");
+	nng_msg_free(m1);
+	nng_aio_set_timeout(aio2, 100);
+	nng_ctx_recv(c2, aio2);
+	nng_aio_wait(aio2);
+	NUTS_FAIL(nng_aio_result(aio2), NNG_ETIMEDOUT);
+
+	// Closing a context releases its subscriptions.
+	NUTS_PASS(nng_ctx_close(c1));
+	NUTS_SEND(pub, "abf");
+
+	NUTS_CLOSE(sub);
+	NUTS_CLOSE(pub);
+	nng_aio_free(aio1);
+	nng_aio_free(aio2);
+}
+
 static void
 test_sub_cooked(void)
 {
@@ -620,10 +734,12 @@ TEST_LIST = {
 	{ "sub subscribe option", test_sub_subscribe_option },
 	{ "sub unsubscribe option", test_sub_unsubscribe_option },
 	{ "sub prefer new option", test_sub_prefer_new_option },
+	{ "sub advertise option", test_sub_advertise_option },
 	{ "sub drop new", test_sub_drop_new },
 	{ "sub drop old", test_sub_drop_old },
 	{ "sub filter", test_sub_filter },
 	{ "sub multi context", test_sub_multi_context },
+	{ "sub shared topics", test_sub_shared_topics },
 	{ "sub cooked", test_sub_cooked },
 	{ "sub wrong protocol", test_sub_wrong_protocol },
 	{ "sub closed socket", test_sub_closed_socket },
@@ -28,7 +28,7 @@ static void req0_ctx_reset(req0_ctx *);
 static void req0_pipe_fini(void *);
 static void req0_ctx_fini(void *);
 static void req0_ctx_init(void *, void *);
-static void req0_retry_cb(void *);
+static void req0_ctx_retry_cb(void *);
 
 // A req0_ctx is a "context" for the request.  It uses most of the
 // socket, but keeps track of its own outstanding replays, the request ID,
@@ -38,7 +38,6 @@ struct req0_ctx {
 	nni_list_node sock_node;  // node on the socket context list
 	nni_list_node send_node;  // node on the send_queue
 	nni_list_node pipe_node;  // node on the pipe list
-	nni_list_node retry_node; // node on the socket retry list
 	uint32_t      request_id; // request ID, without high bit set
 	nni_aio      *recv_aio;   // user aio waiting to recv - only one!
 	nni_aio      *send_aio;   // user aio waiting to send
@@ -46,15 +45,16 @@ struct req0_ctx {
 	size_t        req_len;    // length of request message (for stats)
 	nng_msg      *rep_msg;    // reply message
 	nni_duration  retry;
-	nni_time      retry_time; // retry after this expires
-	bool          conn_reset; // sent message w/o retry, peer disconnect
+	nni_time      retry_time;   // retry after this expires
+	bool          retry_active; // true if retry_aio is running
+	bool          conn_reset;   // sent message w/o retry, peer disconnect
+	nni_aio       retry_aio;    // resend timer for this context
 };
 
 // A req0_sock is our per-socket protocol private structure.
 struct req0_sock {
 	nni_duration   retry;
 	bool           closed;
-	bool           retry_active; // true if retry aio running
 	nni_atomic_int ttl;
 	req0_ctx       master; // base socket master
 	nni_list       ready_pipes;
@@ -62,12 +62,10 @@ struct req0_sock {
 	nni_list       stop_pipes;
 	nni_list       contexts;
 	nni_list       send_queue; // contexts waiting to send.
-	nni_list       retry_queue;
-	nni_aio        retry_aio; // retry timer
-	nni_id_map     requests;  // contexts by request ID
+	nni_id_map     requests;   // contexts by request ID
 	nni_pollable   readable;
 	nni_pollable   writable;
-	nni_duration   retry_tick; // clock interval for retry timer
+	nni_duration   retry_tick; // retained for the option only
 	nni_mtx        mtx;
 };
 
@@ -104,20 +102,17 @@ req0_sock_init(void *arg, nni_sock *sock)
 	NNI_LIST_INIT(&s->busy_pipes, req0_pipe, node);
 	NNI_LIST_INIT(&s->stop_pipes, req0_pipe, node);
 	NNI_LIST_INIT(&s->send_queue, req0_ctx, send_node);
-	NNI_LIST_INIT(&s->retry_queue, req0_ctx, retry_node);
 	NNI_LIST_INIT(&s->contexts, req0_ctx, sock_node);
 
 	// this is "semi random" start for request IDs.
 	s->retry      = NNI_SECOND * 60;
-	s->retry_tick = NNI_SECOND; // how often we check for retries
+	s->retry_tick = NNI_SECOND;
 
 	req0_ctx_init(&s->master, s);
 
 	nni_pollable_init(&s->writable);
 	nni_pollable_init(&s->readable);
 
-	nni_aio_init(&s->retry_aio, req0_retry_cb, s);
-
 	nni_atomic_init(&s->ttl);
 	nni_atomic_set(&s->ttl, 8);
 }
@@ -143,7 +138,6 @@ req0_sock_fini(void *arg)
 {
 	req0_sock *s = arg;
 
-	nni_aio_stop(&s->retry_aio);
 	nni_mtx_lock(&s->mtx);
 	NNI_ASSERT(nni_list_empty(&s->busy_pipes));
 	NNI_ASSERT(nni_list_empty(&s->stop_pipes));
@@ -154,7 +148,6 @@ req0_sock_fini(void *arg)
 	nni_pollable_fini(&s->readable);
 	nni_pollable_fini(&s->writable);
 	nni_id_map_fini(&s->requests);
-	nni_aio_fini(&s->retry_aio);
 	nni_mtx_fini(&s->mtx);
 }
 
@@ -254,12 +247,8 @@ req0_pipe_close(void *arg)
 				ctx->conn_reset = true;
 			}
 		} else if (ctx->req_msg != NULL) {
-			// Reset the retry time to make it expire immediately.
-			// Also move this immediately to the resend queue.
-			// The timer should still be firing, so we don't need
-			// to restart or reschedule that.
-			ctx->retry_time = nni_clock() + ctx->retry;
-
+			// Move this immediately to the send queue.  The
+			// resend timer is restarted when it goes out again.
 			if (!nni_list_node_active(&ctx->send_node)) {
 				nni_list_append(&s->send_queue, ctx);
 				req0_run_send_queue(s, NULL);
@@ -387,42 +376,34 @@ malformed:
 	nni_pipe_close(p->pipe);
 }
 
+// Each context has its own resend timer, so a resend happens at the time
+// it is due, and only the contexts that are due do any work.  The timer is
+// not canceled when a request is sent again; instead it notices that the
+// retry time moved and sleeps for the remainder.
 static void
-req0_retry_cb(void *arg)
+req0_ctx_retry_cb(void *arg)
 {
-	req0_sock *s = arg;
-	req0_ctx  *ctx;
+	req0_ctx  *ctx = arg;
+	req0_sock *s   = ctx->sock;
 	nni_time   now;
-	bool       reschedule = false;
 
-	// The design of this is that retries are infrequent, because
-	// we should normally be succeeding.  We also hope that we are not
-	// executing this linear scan of all requests too often, once
-	// per clock tick is all we want.
-	now = nni_clock();
 	nni_mtx_lock(&s->mtx);
-	if (s->closed || (nni_aio_result(&s->retry_aio) != 0)) {
+	if (s->closed || (nni_aio_result(&ctx->retry_aio) != 0) ||
+	    (ctx->req_msg == NULL) || (ctx->retry <= 0)) {
+		ctx->retry_active = false;
 		nni_mtx_unlock(&s->mtx);
 		return;
 	}
-
-	NNI_LIST_FOREACH (&s->retry_queue, ctx) {
-		if (ctx->retry_time > now || (ctx->req_msg == NULL)) {
-			continue;
-		}
-		if (!nni_list_node_active(&ctx->send_node)) {
-			nni_list_append(&s->send_queue, ctx);
-		}
-		reschedule = true;
-	}
-	if (!nni_list_empty(&s->retry_queue)) {
-		// if there are still jobs in the queue waiting to be
-		// retried, do them.
-		nni_sleep_aio(s->retry_tick, &s->retry_aio);
-	} else {
-		s->retry_active = false;
+	now = nni_clock();
+	if (ctx->retry_time > now) {
+		nni_sleep_aio(
+		    (nni_duration) (ctx->retry_time - now), &ctx->retry_aio);
+		nni_mtx_unlock(&s->mtx);
+		return;
 	}
-	if (reschedule) {
+	ctx->retry_active = false;
+	if (!nni_list_node_active(&ctx->send_node)) {
+		nni_list_append(&s->send_queue, ctx);
 		req0_run_send_queue(s, NULL);
 	}
 	nni_mtx_unlock(&s->mtx);
@@ -434,6 +415,8 @@ req0_ctx_init(void *arg, void *sock)
 	req0_sock *s   = sock;
 	req0_ctx  *ctx = arg;
 
+	nni_aio_init(&ctx->retry_aio, req0_ctx_retry_cb, ctx);
+
 	nni_mtx_lock(&s->mtx);
 	ctx->sock     = s;
 	ctx->recv_aio = NULL;
@@ -449,6 +432,7 @@ req0_ctx_fini(void *arg)
 	req0_sock *s   = ctx->sock;
 	nni_aio   *aio;
 
+	nni_aio_stop(&ctx->retry_aio);
 	nni_mtx_lock(&s->mtx);
 	if ((aio = ctx->recv_aio) != NULL) {
 		ctx->recv_aio = NULL;
@@ -463,6 +447,7 @@ req0_ctx_fini(void *arg)
 	req0_ctx_reset(ctx);
 	nni_list_remove(&s->contexts, ctx);
 	nni_mtx_unlock(&s->mtx);
+	nni_aio_fini(&ctx->retry_aio);
 }
 
 static nng_err
@@ -505,8 +490,11 @@ req0_run_send_queue(req0_sock *s, nni_aio_completions *sent_list)
 		// the next time that the send_queue is run.  We don't do this
 		// if the retry is "disabled" with NNG_DURATION_INFINITE.
 		if (ctx->retry > 0) {
-			nni_list_node_remove(&ctx->retry_node);
-			nni_list_append(&s->retry_queue, ctx);
+			ctx->retry_time = nni_clock() + ctx->retry;
+			if (!ctx->retry_active) {
+				ctx->retry_active = true;
+				nni_sleep_aio(ctx->retry, &ctx->retry_aio);
+			}
 		}
 
 		// Put us on the pipe list of active contexts.
@@ -551,8 +539,8 @@ req0_ctx_reset(req0_ctx *ctx)
 {
 	req0_sock *s = ctx->sock;
 	// Call with sock lock held!
+	// A running resend timer finds no request and stops by itself.
 
-	nni_list_node_remove(&ctx->retry_node);
 	nni_list_node_remove(&ctx->pipe_node);
 	nni_list_node_remove(&ctx->send_node);
 	if (ctx->request_id != 0) {
@@ -747,15 +735,6 @@ req0_ctx_send(void *arg, nni_aio *aio)
 	ctx->send_aio = aio;
 	nni_aio_set_msg(aio, NULL);
 
-	if (ctx->retry > 0) {
-		ctx->retry_time = nni_clock() + ctx->retry;
-		nni_list_append(&s->retry_queue, ctx);
-		if (!s->retry_active) {
-			s->retry_active = true;
-			nni_sleep_aio(s->retry_tick, &s->retry_aio);
-		}
-	}
-
 	// Stick us on the send_queue list.
 	nni_list_append(&s->send_queue, ctx);
 
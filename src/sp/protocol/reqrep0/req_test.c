@@ -200,6 +200,99 @@ test_req_resend(void)
 	NUTS_CLOSE(rep);
 }
 
+void
+test_req_resend_precise(void)
+{
+	nng_socket req;
+	nng_socket rep;
+	nng_time   start;
+
+	NUTS_PASS(nng_req0_open(&req));
+	NUTS_PASS(nng_rep0_open(&rep));
+
+	NUTS_PASS(nng_socket_set_ms(req, NNG_OPT_RECVTIMEO, SECOND));
+	NUTS_PASS(nng_socket_set_ms(rep, NNG_OPT_RECVTIMEO, SECOND));
+	NUTS_PASS(nng_socket_set_ms(req, NNG_OPT_SENDTIMEO, SECOND));
+	NUTS_PASS(nng_socket_set_ms(rep, NNG_OPT_SENDTIMEO, SECOND));
+	// The resend tick is left at its default of a second; resends
+	// must not wait for it.
+	NUTS_PASS(nng_socket_set_ms(req, NNG_OPT_REQ_RESENDTIME, 50));
+
+	NUTS_MARRY(rep, req);
+
+	NUTS_SEND(req, "ping");
+	NUTS_RECV(rep, "ping");
+	start = nng_clock();
+	NUTS_RECV(rep, "ping");
+	NUTS_RECV(rep, "ping");
+	NUTS_TRUE(nng_clock() - start < 500);
+
+	NUTS_CLOSE(req);
+	NUTS_CLOSE(rep);
+}
+
+// This is a benchmark of resending with many contexts outstanding.  The
+// peer never replies, so each context resends on its own timer.
+void
+test_req_ctx_resend_scaling(void)
+{
+	const int    nctx   = 10000;
+	const int    resend = 100;
+	nng_socket   req;
+	nng_socket   rep;
+	nng_ctx     *ctxs;
+	nng_aio    **aios;
+	nng_msg     *msg;
+	nng_time     start;
+	nng_duration delta;
+	int          count = 0;
+
+	nuts_set_logger(NNG_LOG_NOTICE);
+	NUTS_PASS(nng_req0_open(&req));
+	NUTS_PASS(nng_rep0_open(&rep));
+	NUTS_PASS(nng_socket_set_ms(rep, NNG_OPT_RECVTIMEO, 5 * SECOND));
+	NUTS_MARRY(rep, req);
+
+	ctxs = nng_alloc(nctx * sizeof(nng_ctx));
+	aios = nng_alloc(nctx * sizeof(nng_aio *));
+	NUTS_ASSERT(ctxs != NULL && aios != NULL);
+	for (int i = 0; i < nctx; i++) {
+		NUTS_PASS(nng_ctx_open(&ctxs[i], req));
+		NUTS_PASS(
+		    nng_ctx_set_ms(ctxs[i], NNG_OPT_REQ_RESENDTIME, resend));
+		NUTS_PASS(nng_aio_alloc(&aios[i], NULL, NULL));
+	}
+
+	start = nng_clock();
+	for (int i = 0; i < nctx; i++) {
+		NUTS_PASS(nng_msg_alloc(&msg, 0));
+		nng_aio_set_msg(aios[i], msg);
+		nng_ctx_send(ctxs[i], aios[i]);
+	}
+	// Every request is sent once, and then once more when its
+	// timer expires.
+	while (count < 2 * nctx) {
+		NUTS_PASS(nng_recvmsg(rep, &msg, 0));
+		nng_msg_free(msg);
+		count++;
+	}
+	delta = (nng_duration) (nng_clock() - start);
+	nng_log_notice("req",
+	    "%d contexts with %d ms resend: %d requests received in %d ms",
+	    nctx, resend, count, (int) delta);
+
+	for (int i = 0; i < nctx; i++) {
+		nng_aio_wait(aios[i]);
+		NUTS_PASS(nng_aio_result(aios[i]));
+		NUTS_PASS(nng_ctx_close(ctxs[i]));
+		nng_aio_free(aios[i]);
+	}
+	nng_free(ctxs, nctx * sizeof(nng_ctx));
+	nng_free(aios, nctx * sizeof(nng_aio *));
+	NUTS_CLOSE(req);
+	NUTS_CLOSE(rep);
+}
+
 void
 test_req_resend_reconnect(void)
 {
@@ -985,6 +1078,7 @@ NUTS_TESTS = {
 	{ "req recv garbage", test_req_recv_garbage },
 	{ "req rep exchange", test_req_rep_exchange },
 	{ "req resend", test_req_resend },
+	{ "req resend precise", test_req_resend_precise },
 	{ "req resend disconnect", test_req_resend_disconnect },
 	{ "req disconnect no retry", test_req_disconnect_no_retry },
 	{ "req disconnect abort", test_req_disconnect_abort },
@@ -1005,5 +1099,6 @@ NUTS_TESTS = {
 	{ "req context recv nonblock", test_req_ctx_recv_nonblock },
 	{ "req context send nonblock", test_req_ctx_send_nonblock },
 	{ "req validate peer", test_req_validate_peer },
+	{ "req context resend scaling", test_req_ctx_resend_scaling },
 	{ NULL, NULL },
 };
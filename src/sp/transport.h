@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 // Copyright 2018 Devolutions <info@devolutions.net>
 //
@@ -71,6 +71,11 @@ struct nni_sp_dialer_ops {
 	// element must have a NULL name. If this member is NULL, then
 	// no dialer specific options are available.
 	nni_option *d_options;
+
+	// d_multi is true if the dialer can make several connections to the
+	// same address, each its own pipe (see NNG_OPT_DIAL_PIPES).  They are
+	// still dialed one at a time.
+	bool d_multi;
 };
 
 struct nni_sp_listener_ops {
@@ -38,11 +38,16 @@ struct inproc_pipe {
 	nni_pipe     *pipe;
 };
 
+// inproc_queue carries messages in one direction.  With buffering, up to
+// the depth of msgs can be sent without a reader waiting; otherwise each
+// send is a rendezvous with a receive.
 struct inproc_queue {
 	nni_list readers;
 	nni_list writers;
+	nni_lmq  msgs;
 	nni_mtx  lock;
 	bool     closed;
+	bool     split; // receiver accepts the header apart from the body
 };
 
 // inproc_pair represents a pair of pipes.  Because we control both
@@ -62,6 +67,8 @@ struct inproc_ep {
 	nni_list      clients;
 	nni_list      aios;
 	size_t        rcvmax;
+	int           buffer; // messages buffered in each direction
+	bool          split;  // our protocol takes headers apart from body
 	nni_mtx       mtx;
 };
 
@@ -88,8 +95,10 @@ static void
 inproc_pair_destroy(void *arg)
 {
 	inproc_pair *pair = arg;
-	nni_mtx_fini(&pair->queues[0].lock);
-	nni_mtx_fini(&pair->queues[1].lock);
+	for (int i = 0; i < 2; i++) {
+		nni_lmq_fini(&pair->queues[i].msgs);
+		nni_mtx_fini(&pair->queues[i].lock);
+	}
 	NNI_FREE_STRUCT(pair);
 }
 
@@ -123,6 +132,7 @@ static void
 inproc_queue_run_closed(inproc_queue *queue)
 {
 	nni_aio *aio;
+	nni_lmq_flush(&queue->msgs);
 	while (((aio = nni_list_first(&queue->readers)) != NULL) ||
 	    ((aio = nni_list_first(&queue->writers)) != NULL)) {
 		nni_aio_list_remove(aio);
@@ -130,20 +140,48 @@ inproc_queue_run_closed(inproc_queue *queue)
 	}
 }
 
+// inproc_queue_ready prepares a message for the receiver.  We need to
+// ensure that it has an exclusive copy of the message, and unless it can
+// take the header separately, pull the header up into the body to match
+// protocol expectations.  On failure the message is freed, and NULL is
+// returned.
+static nni_msg *
+inproc_queue_ready(inproc_queue *queue, nni_msg *msg)
+{
+	nni_msg *flat;
+
+	if (queue->split) {
+		return (nni_msg_unique(msg));
+	}
+	// Unlike nni_msg_unique, this leaves the original alone on failure.
+	if ((flat = nni_msg_pull_up(msg)) == NULL) {
+		nni_msg_free(msg);
+	}
+	return (flat);
+}
+
 static void
 inproc_queue_run(inproc_queue *queue)
 {
+	nni_aio *rd;
+	nni_aio *wr;
+	nni_msg *msg;
+
 	if (queue->closed) {
 		inproc_queue_run_closed(queue);
 	}
-	for (;;) {
-		nni_aio *rd;
-		nni_aio *wr;
-		nni_msg *msg;
-		nni_msg *pu;
-
-		if (((rd = nni_list_first(&queue->readers)) == NULL) ||
-		    ((wr = nni_list_first(&queue->writers)) == NULL)) {
+
+	// Buffered messages go first, to preserve ordering.
+	while (((rd = nni_list_first(&queue->readers)) != NULL) &&
+	    (nni_lmq_get(&queue->msgs, &msg) == 0)) {
+		nni_aio_list_remove(rd);
+		nni_aio_set_msg(rd, msg);
+		nni_aio_finish(rd, 0, nni_msg_len(msg));
+	}
+
+	while ((wr = nni_list_first(&queue->writers)) != NULL) {
+		rd = nni_list_first(&queue->readers);
+		if ((rd == NULL) && nni_lmq_full(&queue->msgs)) {
 			return;
 		}
 
@@ -160,14 +198,13 @@ inproc_queue_run(inproc_queue *queue)
 
 		// TODO: We could check the max receive size here.
 
-		// Now the receive side.  We need to ensure that we have
-		// an exclusive copy of the message, and pull the header
-		// up into the body to match protocol expectations.
-		if ((pu = nni_msg_pull_up(msg)) == NULL) {
-			nni_msg_free(msg);
+		if ((msg = inproc_queue_ready(queue, msg)) == NULL) {
+			continue;
+		}
+		if (rd == NULL) {
+			(void) nni_lmq_put(&queue->msgs, msg);
 			continue;
 		}
-		msg = pu;
 
 		nni_aio_list_remove(rd);
 		nni_aio_set_msg(rd, msg);
@@ -265,6 +302,8 @@ inproc_ep_init(inproc_ep *ep, nni_sock *sock, const nng_url *url)
 	nni_mtx_init(&ep->mtx);
 	ep->proto  = nni_sock_proto_id(sock);
 	ep->rcvmax = 0;
+	ep->buffer = 0;
+	ep->split  = (nni_sock_flags(sock) & NNI_PROTO_FLAG_SPLIT) != 0;
 	NNI_LIST_INIT(&ep->clients, inproc_ep, node);
 	nni_aio_list_init(&ep->aios);
 	ep->addr = url->u_path; // we match on the URL path.
@@ -360,6 +399,7 @@ inproc_accept_clients(inproc_ep *srv)
 			inproc_pipe *spipe;
 			inproc_pair *pair;
 			nni_aio     *saio;
+			int          depth;
 			int          rv;
 
 			if ((saio = nni_list_first(&srv->aios)) == NULL) {
@@ -374,11 +414,23 @@ inproc_accept_clients(inproc_ep *srv)
 				    saio, NNG_ENOMEM, srv, NULL);
 				continue;
 			}
+			nni_mtx_lock(&cli->mtx);
+			depth = cli->buffer;
+			nni_mtx_unlock(&cli->mtx);
+			nni_mtx_lock(&srv->mtx);
+			if (srv->buffer > depth) {
+				depth = srv->buffer;
+			}
+			nni_mtx_unlock(&srv->mtx);
 			for (int i = 0; i < 2; i++) {
 				nni_aio_list_init(&pair->queues[i].readers);
 				nni_aio_list_init(&pair->queues[i].writers);
+				nni_lmq_init(&pair->queues[i].msgs, depth);
 				nni_mtx_init(&pair->queues[i].lock);
 			}
+			// Queue 0 carries client to server, and 1 the reverse.
+			pair->queues[0].split = srv->split;
+			pair->queues[1].split = cli->split;
 			nni_refcnt_init(
 			    &pair->ref, 2, pair, inproc_pair_destroy);
 
@@ -551,6 +603,31 @@ inproc_ep_set_recvmaxsz(void *arg, const void *v, size_t sz, nni_opt_type t)
 	return (rv);
 }
 
+static nng_err
+inproc_ep_get_buffer(void *arg, void *v, size_t *szp, nni_opt_type t)
+{
+	inproc_ep *ep = arg;
+	nng_err    rv;
+	nni_mtx_lock(&ep->mtx);
+	rv = nni_copyout_int(ep->buffer, v, szp, t);
+	nni_mtx_unlock(&ep->mtx);
+	return (rv);
+}
+
+static nng_err
+inproc_ep_set_buffer(void *arg, const void *v, size_t sz, nni_opt_type t)
+{
+	inproc_ep *ep = arg;
+	int        val;
+	nng_err    rv;
+	if ((rv = nni_copyin_int(&val, v, sz, 0, 8192, t)) == NNG_OK) {
+		nni_mtx_lock(&ep->mtx);
+		ep->buffer = val;
+		nni_mtx_unlock(&ep->mtx);
+	}
+	return (rv);
+}
+
 static nng_err
 inproc_ep_get_addr(void *arg, void *v, size_t *szp, nni_opt_type t)
 {
@@ -608,6 +685,11 @@ static const nni_option inproc_ep_options[] = {
 	    .o_get  = inproc_ep_get_recvmaxsz,
 	    .o_set  = inproc_ep_set_recvmaxsz,
 	},
+	{
+	    .o_name = NNG_OPT_INPROC_BUFFER,
+	    .o_get  = inproc_ep_get_buffer,
+	    .o_set  = inproc_ep_set_buffer,
+	},
 	{
 	    .o_name = NNG_OPT_LOCADDR,
 	    .o_get  = inproc_ep_get_addr,
@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 //
 // This software is supplied under the terms of the MIT License, a
 // copy of which should be located in the distribution where this
@@ -7,11 +7,137 @@
 // found online at https://opensource.org/licenses/MIT.
 //
 
+#include <string.h>
+
 #include <nuts.h>
 
 NUTS_DECLARE_TRAN_TESTS(inproc)
 
+void
+test_inproc_buffer_option(void)
+{
+	nng_socket   s;
+	nng_listener l;
+	int          v;
+	bool         b;
+
+	NUTS_OPEN(s);
+	NUTS_PASS(nng_listener_create(&l, s, "inproc://buffer_option"));
+	NUTS_PASS(nng_listener_get_int(l, NNG_OPT_INPROC_BUFFER, &v));
+	NUTS_TRUE(v == 0);
+	NUTS_PASS(nng_listener_set_int(l, NNG_OPT_INPROC_BUFFER, 16));
+	NUTS_PASS(nng_listener_get_int(l, NNG_OPT_INPROC_BUFFER, &v));
+	NUTS_TRUE(v == 16);
+	NUTS_FAIL(
+	    nng_listener_set_int(l, NNG_OPT_INPROC_BUFFER, -1), NNG_EINVAL);
+	NUTS_FAIL(nng_listener_set_bool(l, NNG_OPT_INPROC_BUFFER, true),
+	    NNG_EBADTYPE);
+	NUTS_FAIL(nng_listener_get_bool(l, NNG_OPT_INPROC_BUFFER, &b),
+	    NNG_EBADTYPE);
+	NUTS_CLOSE(s);
+}
+
+// inproc_fill sends without blocking until the connection will take no
+// more, and returns the number of messages sent.
+static int
+inproc_fill(nng_socket s)
+{
+	int n = 0;
+	for (;;) {
+		int rv = nng_send(s, &n, sizeof(n), NNG_FLAG_NONBLOCK);
+		if (rv == NNG_EAGAIN) {
+			// Let messages in flight settle, then try again.
+			NUTS_SLEEP(50);
+			rv = nng_send(s, &n, sizeof(n), NNG_FLAG_NONBLOCK);
+		}
+		if (rv == NNG_EAGAIN) {
+			return (n);
+		}
+		NUTS_PASS(rv);
+		n++;
+	}
+}
+
+static void
+inproc_drain(nng_socket s, int count)
+{
+	for (int i = 0; i < count; i++) {
+		nng_msg *msg;
+		int      v;
+		NUTS_PASS(nng_recvmsg(s, &msg, 0));
+		NUTS_TRUE(nng_msg_len(msg) == sizeof(v));
+		memcpy(&v, nng_msg_body(msg), sizeof(v));
+		NUTS_TRUE(v == i);
+		nng_msg_free(msg);
+	}
+}
+
+// inproc_capacity returns how many messages can be sent on a connection
+// with the given buffer depth before a receiver takes any, and checks that
+// they all arrive in order.
+static int
+inproc_capacity(const char *addr, int buffer)
+{
+	nng_socket s1;
+	nng_socket s2;
+	nng_dialer d;
+	int        n;
+
+	NUTS_PASS(nng_pair1_open(&s1));
+	NUTS_PASS(nng_pair1_open(&s2));
+	NUTS_PASS(nng_socket_set_int(s1, NNG_OPT_SENDBUF, 1));
+	NUTS_PASS(nng_socket_set_int(s2, NNG_OPT_RECVBUF, 1));
+	NUTS_PASS(nng_socket_set_ms(s2, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_listen(s2, addr, NULL, 0));
+	NUTS_PASS(nng_dialer_create(&d, s1, addr));
+	NUTS_PASS(nng_dialer_set_int(d, NNG_OPT_INPROC_BUFFER, buffer));
+	NUTS_PASS(nng_dialer_start(d, 0));
+	NUTS_SLEEP(50);
+	n = inproc_fill(s1);
+	inproc_drain(s2, n);
+	NUTS_CLOSE(s1);
+	NUTS_CLOSE(s2);
+	return (n);
+}
+
+void
+test_inproc_buffered_send(void)
+{
+	int unbuffered = inproc_capacity("inproc://unbuffered", 0);
+	int buffered   = inproc_capacity("inproc://buffered", 16);
+
+	// With buffering, the same number of sends complete, plus as
+	// many more as the buffer holds.
+	NUTS_TRUE(buffered == unbuffered + 16);
+}
+
+void
+test_inproc_buffered_close(void)
+{
+	nng_socket s1;
+	nng_socket s2;
+	nng_dialer d;
+
+	// Messages still in the buffer are discarded when the
+	// connection closes.
+	NUTS_PASS(nng_pair1_open(&s1));
+	NUTS_PASS(nng_pair1_open(&s2));
+	NUTS_PASS(nng_listen(s2, "inproc://buffered_close", NULL, 0));
+	NUTS_PASS(nng_dialer_create(&d, s1, "inproc://buffered_close"));
+	NUTS_PASS(nng_dialer_set_int(d, NNG_OPT_INPROC_BUFFER, 64));
+	NUTS_PASS(nng_dialer_start(d, 0));
+	NUTS_SLEEP(50);
+	for (int i = 0; i < 32; i++) {
+		NUTS_SEND(s1, "abc");
+	}
+	NUTS_CLOSE(s1);
+	NUTS_CLOSE(s2);
+}
+
 NUTS_TESTS = {
 	NUTS_INSERT_TRAN_TESTS(inproc),
+	{ "inproc buffer option", test_inproc_buffer_option },
+	{ "inproc buffered send", test_inproc_buffered_send },
+	{ "inproc buffered close", test_inproc_buffered_close },
 	{ NULL, NULL },
 };
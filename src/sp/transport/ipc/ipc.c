@@ -10,6 +10,7 @@
 //
 
 #include <stdio.h>
+#include <string.h>
 
 #include "core/defs.h"
 #include "core/nng_impl.h"
@@ -24,6 +25,14 @@
 typedef struct ipc_pipe ipc_pipe;
 typedef struct ipc_ep   ipc_ep;
 
+// Send coalescing.  With a non-zero budget, messages that fit in half of
+// it are copied, with their headers, into a per-pipe buffer and their
+// senders are completed immediately.  The buffer is written in one send
+// when the previous write finishes, when it fills, or when the latency
+// budget expires.  Larger messages are written directly after it, in the
+// same send.  A second buffer is filled while the first is written.
+#define IPC_TX_BUF_MAX (1U << 20)
+
 // ipc_pipe is one end of an IPC connection.
 struct ipc_pipe {
 	nng_stream   *conn;
@@ -46,12 +55,23 @@ struct ipc_pipe {
 	nni_aio       rx_aio;
 	nni_aio       neg_aio;
 	nni_msg      *rx_msg;
+	nni_aio      *tx_user; // user aio being written directly, if any
+	uint8_t      *tx_buf;  // coalescing buffer being filled
+	uint8_t      *tx_out;  // coalescing buffer being written
+	size_t        tx_fill; // bytes of tx_buf used
+	size_t        tx_max;  // coalescing budget, 0 if disabled
+	nng_duration  tx_time; // coalescing latency budget
+	bool          tx_busy; // tx_aio is busy
+	bool          tx_wait; // tx_timer is running
+	nni_aio       tx_timer;
 	nni_mtx       mtx;
 };
 
 struct ipc_ep {
 	nni_mtx              mtx;
 	size_t               rcv_max;
+	size_t               tx_max;
+	nng_duration         tx_time;
 	uint16_t             proto;
 	bool                 started;
 	bool                 closed;
@@ -67,12 +87,15 @@ struct ipc_ep {
 	nni_list             nego_pipes; // pipes busy negotiating
 #ifdef NNG_ENABLE_STATS
 	nni_stat_item st_rcv_max;
+	nni_stat_item st_tx_writes;
 #endif
 };
 
 static void ipc_pipe_send_start(ipc_pipe *p);
 static void ipc_pipe_recv_start(ipc_pipe *p);
+static void ipc_pipe_send_fill(ipc_pipe *p);
 static void ipc_pipe_send_cb(void *);
+static void ipc_pipe_send_timer_cb(void *);
 static void ipc_pipe_recv_cb(void *);
 static void ipc_pipe_nego_cb(void *);
 
@@ -97,6 +120,7 @@ ipc_pipe_close(void *arg)
 
 	nni_aio_close(&p->rx_aio);
 	nni_aio_close(&p->tx_aio);
+	nni_aio_close(&p->tx_timer);
 	nni_aio_close(&p->neg_aio);
 
 	nng_stream_close(p->conn);
@@ -110,6 +134,7 @@ ipc_pipe_stop(void *arg)
 
 	nni_aio_stop(&p->rx_aio);
 	nni_aio_stop(&p->tx_aio);
+	nni_aio_stop(&p->tx_timer);
 	nni_aio_stop(&p->neg_aio);
 	nng_stream_stop(p->conn);
 	nni_mtx_lock(&ep->mtx);
@@ -124,6 +149,7 @@ ipc_pipe_init(void *arg, nni_pipe *pipe)
 	p->pipe     = pipe;
 	nni_mtx_init(&p->mtx);
 	nni_aio_init(&p->tx_aio, ipc_pipe_send_cb, p);
+	nni_aio_init(&p->tx_timer, ipc_pipe_send_timer_cb, p);
 	nni_aio_init(&p->rx_aio, ipc_pipe_recv_cb, p);
 	nni_aio_init(&p->neg_aio, ipc_pipe_nego_cb, p);
 	nni_aio_list_init(&p->send_q);
@@ -140,8 +166,13 @@ ipc_pipe_fini(void *arg)
 	nng_stream_free(p->conn);
 	nni_aio_fini(&p->rx_aio);
 	nni_aio_fini(&p->tx_aio);
+	nni_aio_fini(&p->tx_timer);
 	nni_aio_fini(&p->neg_aio);
 	nni_msg_free(p->rx_msg);
+	if (p->tx_buf != NULL) {
+		nni_free(p->tx_buf, p->tx_max);
+		nni_free(p->tx_out, p->tx_max);
+	}
 	nni_mtx_fini(&p->mtx);
 }
 
@@ -158,6 +189,24 @@ ipc_ep_match(ipc_ep *ep)
 	nni_list_remove(&ep->wait_pipes, p);
 	ep->user_aio = NULL;
 	p->rcv_max   = ep->rcv_max;
+	p->tx_time   = ep->tx_time;
+	if (ep->tx_max > 0) {
+		// If we cannot get the buffers, just send without them.
+		p->tx_buf = nni_alloc(ep->tx_max);
+		p->tx_out = nni_alloc(ep->tx_max);
+		if ((p->tx_buf != NULL) && (p->tx_out != NULL)) {
+			p->tx_max = ep->tx_max;
+		} else {
+			if (p->tx_buf != NULL) {
+				nni_free(p->tx_buf, ep->tx_max);
+			}
+			if (p->tx_out != NULL) {
+				nni_free(p->tx_out, ep->tx_max);
+			}
+			p->tx_buf = NULL;
+			p->tx_out = NULL;
+		}
+	}
 	nni_aio_set_output(aio, 0, p->pipe);
 	nni_aio_finish(aio, 0, 0);
 }
@@ -255,44 +304,77 @@ ipc_pipe_send_cb(void *arg)
 	size_t    n;
 	nni_msg  *msg;
 	nni_aio  *tx_aio = &p->tx_aio;
+	bool      user;
 
 	nni_mtx_lock(&p->mtx);
+	user       = (p->tx_user != NULL);
+	p->tx_user = NULL;
 	if ((rv = nni_aio_result(tx_aio)) != 0) {
 		nni_pipe_bump_error(p->pipe, rv);
 		// Intentionally we do not queue up another transfer.
 		// There's an excellent chance that the pipe is no longer
 		// usable, with a partial transfer.
 		// The protocol should see this error, and close the
-		// pipe itself, we hope.
+		// pipe itself, we hope.  If only coalesced messages were
+		// being written, there is nobody to tell, so we close it.
 
 		while ((aio = nni_list_first(&p->send_q)) != NULL) {
 			nni_aio_list_remove(aio);
 			nni_aio_finish_error(aio, rv);
 		}
 		nni_mtx_unlock(&p->mtx);
+		if (!user) {
+			nni_pipe_close(p->pipe);
+		}
 		return;
 	}
 
 	n = nni_aio_count(tx_aio);
 	nni_aio_iov_advance(tx_aio, n);
 	if (nni_aio_iov_count(tx_aio) != 0) {
+		if (user) {
+			p->tx_user = nni_list_first(&p->send_q);
+		}
+#ifdef NNG_ENABLE_STATS
+		nni_stat_inc(&p->ep->st_tx_writes, 1);
+#endif
 		nng_stream_send(p->conn, tx_aio);
 		nni_mtx_unlock(&p->mtx);
 		return;
 	}
 
-	aio = nni_list_first(&p->send_q);
-	nni_aio_list_remove(aio);
+	p->tx_busy = false;
+	aio        = NULL;
+	if (user) {
+		aio = nni_list_first(&p->send_q);
+		nni_aio_list_remove(aio);
+		msg = nni_aio_get_msg(aio);
+		n   = nni_msg_len(msg);
+		nni_pipe_bump_tx(p->pipe, n);
+	}
+	// Anything that queued up meanwhile has waited long enough.
+	ipc_pipe_send_fill(p);
 	ipc_pipe_send_start(p);
-
-	msg = nni_aio_get_msg(aio);
-	n   = nni_msg_len(msg);
-	nni_pipe_bump_tx(p->pipe, n);
 	nni_mtx_unlock(&p->mtx);
 
-	nni_aio_set_msg(aio, NULL);
-	nni_msg_free(msg);
-	nni_aio_finish_sync(aio, 0, n);
+	if (aio != NULL) {
+		nni_aio_set_msg(aio, NULL);
+		nni_msg_free(msg);
+		nni_aio_finish_sync(aio, 0, n);
+	}
+}
+
+static void
+ipc_pipe_send_timer_cb(void *arg)
+{
+	ipc_pipe *p = arg;
+
+	nni_mtx_lock(&p->mtx);
+	p->tx_wait = false;
+	if (!p->tx_busy) {
+		ipc_pipe_send_start(p);
+	}
+	nni_mtx_unlock(&p->mtx);
 }
 
 static void
@@ -425,7 +507,7 @@ ipc_pipe_send_cancel(nni_aio *aio, void *arg, nng_err rv)
 	// If this is being sent, then cancel the pending transfer.
 	// The callback on the tx_aio will cause the user aio to
 	// be canceled too.
-	if (nni_list_first(&p->send_q) == aio) {
+	if (p->tx_user == aio) {
 		nni_aio_abort(&p->tx_aio, rv);
 		nni_mtx_unlock(&p->mtx);
 		return;
@@ -436,13 +518,50 @@ ipc_pipe_send_cancel(nni_aio *aio, void *arg, nng_err rv)
 	nni_aio_finish_error(aio, rv);
 }
 
+// ipc_pipe_send_fill copies queued messages into the coalescing buffer,
+// completing their senders, until one does not fit.
+static void
+ipc_pipe_send_fill(ipc_pipe *p)
+{
+	nni_aio *aio;
+	nni_msg *msg;
+	size_t   h_len;
+	size_t   b_len;
+	size_t   len;
+
+	while (((aio = nni_list_first(&p->send_q)) != NULL) &&
+	    (aio != p->tx_user)) {
+		msg   = nni_aio_get_msg(aio);
+		h_len = nni_msg_header_len(msg);
+		b_len = nni_msg_len(msg);
+		len   = sizeof(p->tx_head) + h_len + b_len;
+		if ((len > p->tx_max / 2) || (len > p->tx_max - p->tx_fill)) {
+			break;
+		}
+		p->tx_buf[p->tx_fill] = 1; // message type, 1.
+		NNI_PUT64(p->tx_buf + p->tx_fill + 1, h_len + b_len);
+		p->tx_fill += sizeof(p->tx_head);
+		memcpy(p->tx_buf + p->tx_fill, nni_msg_header(msg), h_len);
+		p->tx_fill += h_len;
+		memcpy(p->tx_buf + p->tx_fill, nni_msg_body(msg), b_len);
+		p->tx_fill += b_len;
+
+		nni_aio_list_remove(aio);
+		nni_aio_set_msg(aio, NULL);
+		nni_msg_free(msg);
+		nni_pipe_bump_tx(p->pipe, b_len);
+		nni_aio_finish(aio, 0, b_len);
+	}
+}
+
 static void
 ipc_pipe_send_start(ipc_pipe *p)
 {
 	nni_aio *aio;
 	nni_msg *msg;
+	uint8_t *buf;
 	int      nio;
-	nni_iov  iov[3];
+	nni_iov  iov[4];
 	uint64_t len;
 
 	if (p->closed) {
@@ -452,31 +571,55 @@ ipc_pipe_send_start(ipc_pipe *p)
 		}
 		return;
 	}
-	if ((aio = nni_list_first(&p->send_q)) == NULL) {
-		return;
+
+	nio = 0;
+	if (p->tx_fill > 0) {
+		buf            = p->tx_buf;
+		p->tx_buf      = p->tx_out;
+		p->tx_out      = buf;
+		iov[0].iov_buf = buf;
+		iov[0].iov_len = p->tx_fill;
+		p->tx_fill     = 0;
+		nio++;
+
+		// Start filling the other buffer for the next write.
+		ipc_pipe_send_fill(p);
 	}
 
-	// This runs to send the message.
-	msg = nni_aio_get_msg(aio);
-	len = nni_msg_len(msg) + nni_msg_header_len(msg);
+	// Whatever is left at the head of the queue was too large to
+	// copy, so we send it directly, unless it must follow messages
+	// that were just copied.
+	if ((p->tx_fill == 0) &&
+	    ((aio = nni_list_first(&p->send_q)) != NULL)) {
+		msg = nni_aio_get_msg(aio);
+		len = nni_msg_len(msg) + nni_msg_header_len(msg);
 
-	p->tx_head[0] = 1; // message type, 1.
-	NNI_PUT64(p->tx_head + 1, len);
+		p->tx_head[0] = 1; // message type, 1.
+		NNI_PUT64(p->tx_head + 1, len);
 
-	nio            = 0;
-	iov[0].iov_buf = p->tx_head;
-	iov[0].iov_len = sizeof(p->tx_head);
-	nio++;
-	if (nni_msg_header_len(msg) > 0) {
-		iov[nio].iov_buf = nni_msg_header(msg);
-		iov[nio].iov_len = nni_msg_header_len(msg);
+		iov[nio].iov_buf = p->tx_head;
+		iov[nio].iov_len = sizeof(p->tx_head);
 		nio++;
+		if (nni_msg_header_len(msg) > 0) {
+			iov[nio].iov_buf = nni_msg_header(msg);
+			iov[nio].iov_len = nni_msg_header_len(msg);
+			nio++;
+		}
+		if (nni_msg_len(msg) > 0) {
+			iov[nio].iov_buf = nni_msg_body(msg);
+			iov[nio].iov_len = nni_msg_len(msg);
+			nio++;
+		}
+		p->tx_user = aio;
 	}
-	if (nni_msg_len(msg) > 0) {
-		iov[nio].iov_buf = nni_msg_body(msg);
-		iov[nio].iov_len = nni_msg_len(msg);
-		nio++;
+	if (nio == 0) {
+		return;
 	}
+
+	p->tx_busy = true;
+#ifdef NNG_ENABLE_STATS
+	nni_stat_inc(&p->ep->st_tx_writes, 1);
+#endif
 	nni_aio_set_iov(&p->tx_aio, nio, iov);
 	nng_stream_send(p->conn, &p->tx_aio);
 }
@@ -493,7 +636,17 @@ ipc_pipe_send(void *arg, nni_aio *aio)
 		return;
 	}
 	nni_list_append(&p->send_q, aio);
-	if (nni_list_first(&p->send_q) == aio) {
+	ipc_pipe_send_fill(p);
+	if (p->tx_busy) {
+		// The message goes out when the current write finishes.
+	} else if ((p->tx_time > 0) && (p->tx_fill < p->tx_max) &&
+	    nni_list_empty(&p->send_q)) {
+		// Wait a little for more messages to fill the buffer.
+		if (!p->tx_wait) {
+			p->tx_wait = true;
+			nni_sleep_aio(p->tx_time, &p->tx_timer);
+		}
+	} else {
 		ipc_pipe_send_start(p);
 	}
 	nni_mtx_unlock(&p->mtx);
@@ -791,7 +944,15 @@ ipc_ep_init(ipc_ep *ep, nni_sock *sock, void (*conn_cb)(void *))
 		.si_unit   = NNG_UNIT_BYTES,
 		.si_atomic = true,
 	};
+	static const nni_stat_info tx_writes_info = {
+		.si_name   = "tx_writes",
+		.si_desc   = "number of stream writes",
+		.si_type   = NNG_STAT_COUNTER,
+		.si_unit   = NNG_UNIT_EVENTS,
+		.si_atomic = true,
+	};
 	nni_stat_init(&ep->st_rcv_max, &rcv_max_info);
+	nni_stat_init(&ep->st_tx_writes, &tx_writes_info);
 #endif
 }
 
@@ -810,6 +971,7 @@ ipc_ep_init_dialer(void *arg, nng_url *url, nni_dialer *dialer)
 	}
 #ifdef NNG_ENABLE_STATS
 	nni_dialer_add_stat(dialer, &ep->st_rcv_max);
+	nni_dialer_add_stat(dialer, &ep->st_tx_writes);
 #endif
 	return (NNG_OK);
 }
@@ -831,6 +993,7 @@ ipc_ep_init_listener(void *arg, nng_url *url, nni_listener *listener)
 
 #ifdef NNG_ENABLE_STATS
 	nni_listener_add_stat(listener, &ep->st_rcv_max);
+	nni_listener_add_stat(listener, &ep->st_tx_writes);
 #endif
 	return (NNG_OK);
 }
@@ -903,6 +1066,57 @@ ipc_ep_set_recv_max_sz(void *arg, const void *v, size_t sz, nni_type t)
 	return (rv);
 }
 
+static nng_err
+ipc_ep_get_coalesce(void *arg, void *v, size_t *szp, nni_type t)
+{
+	ipc_ep *ep = arg;
+	nng_err rv;
+	nni_mtx_lock(&ep->mtx);
+	rv = nni_copyout_size(ep->tx_max, v, szp, t);
+	nni_mtx_unlock(&ep->mtx);
+	return (rv);
+}
+
+static nng_err
+ipc_ep_set_coalesce(void *arg, const void *v, size_t sz, nni_type t)
+{
+	ipc_ep *ep = arg;
+	size_t  val;
+	nng_err rv;
+	if ((rv = nni_copyin_size(&val, v, sz, 0, IPC_TX_BUF_MAX, t)) ==
+	    NNG_OK) {
+		nni_mtx_lock(&ep->mtx);
+		ep->tx_max = val;
+		nni_mtx_unlock(&ep->mtx);
+	}
+	return (rv);
+}
+
+static nng_err
+ipc_ep_get_coalesce_time(void *arg, void *v, size_t *szp, nni_type t)
+{
+	ipc_ep *ep = arg;
+	nng_err rv;
+	nni_mtx_lock(&ep->mtx);
+	rv = nni_copyout_ms(ep->tx_time, v, szp, t);
+	nni_mtx_unlock(&ep->mtx);
+	return (rv);
+}
+
+static nng_err
+ipc_ep_set_coalesce_time(void *arg, const void *v, size_t sz, nni_type t)
+{
+	ipc_ep      *ep = arg;
+	nng_duration val;
+	nng_err      rv;
+	if ((rv = nni_copyin_ms(&val, v, sz, t)) == NNG_OK) {
+		nni_mtx_lock(&ep->mtx);
+		ep->tx_time = val;
+		nni_mtx_unlock(&ep->mtx);
+	}
+	return (rv);
+}
+
 static nng_err
 ipc_ep_bind(void *arg, nng_url *url)
 {
@@ -980,6 +1194,16 @@ static const nni_option ipc_ep_options[] = {
 	    .o_get  = ipc_ep_get_recv_max_sz,
 	    .o_set  = ipc_ep_set_recv_max_sz,
 	},
+	{
+	    .o_name = NNG_OPT_SEND_COALESCE,
+	    .o_get  = ipc_ep_get_coalesce,
+	    .o_set  = ipc_ep_set_coalesce,
+	},
+	{
+	    .o_name = NNG_OPT_SEND_COALESCE_TIME,
+	    .o_get  = ipc_ep_get_coalesce_time,
+	    .o_set  = ipc_ep_set_coalesce_time,
+	},
 	// terminate list
 	{
 	    .o_name = NULL,
@@ -1059,6 +1283,7 @@ static nni_sp_dialer_ops ipc_dialer_ops = {
 	.d_stop    = ipc_ep_stop,
 	.d_getopt  = ipc_dialer_get,
 	.d_setopt  = ipc_dialer_set,
+	.d_multi   = true,
 };
 
 static nni_sp_listener_ops ipc_listener_ops = {
@@ -266,6 +266,53 @@ test_ipc_recv_max(void)
 	NUTS_CLOSE(s1);
 }
 
+void
+test_ipc_send_coalesced(void)
+{
+	nng_socket   s0;
+	nng_socket   s1;
+	nng_listener l;
+	nng_msg     *m;
+	size_t       sz;
+	char        *addr;
+
+	NUTS_ADDR(addr, "ipc");
+	NUTS_OPEN(s0);
+	NUTS_OPEN(s1);
+	NUTS_PASS(nng_socket_set_int(s0, NNG_OPT_SENDBUF, 256));
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_SENDTIMEO, 1000));
+	NUTS_PASS(nng_socket_set_ms(s1, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_listener_create(&l, s0, addr));
+	NUTS_PASS(nng_listener_set_size(l, NNG_OPT_SEND_COALESCE, 4096));
+	NUTS_PASS(nng_listener_get_size(l, NNG_OPT_SEND_COALESCE, &sz));
+	NUTS_TRUE(sz == 4096);
+	NUTS_PASS(nng_listener_set_ms(l, NNG_OPT_SEND_COALESCE_TIME, 5));
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_dial(s1, addr, NULL, 0));
+	NUTS_SLEEP(100);
+
+	// Every tenth message is too large to be copied.
+	for (int i = 0; i < 200; i++) {
+		sz = (i % 10 == 9) ? 10000 + i : i;
+		NUTS_PASS(nng_msg_alloc(&m, sz));
+		memset(nng_msg_body(m), i, sz);
+		NUTS_PASS(nng_sendmsg(s0, m, 0));
+	}
+	for (int i = 0; i < 200; i++) {
+		uint8_t *body;
+		NUTS_PASS(nng_recvmsg(s1, &m, 0));
+		sz = (i % 10 == 9) ? 10000 + i : i;
+		NUTS_TRUE(nng_msg_len(m) == sz);
+		body = nng_msg_body(m);
+		for (size_t j = 0; j < sz; j++) {
+			NUTS_ASSERT(body[j] == (uint8_t) i);
+		}
+		nng_msg_free(m);
+	}
+	NUTS_CLOSE(s0);
+	NUTS_CLOSE(s1);
+}
+
 void
 test_ipc_connect_refused(void)
 {
@@ -695,6 +742,7 @@ TEST_LIST = {
 	{ "ipc ping pong many", test_ipc_ping_pong_many },
 	{ "ipc huge msg", test_ipc_huge_msg },
 	{ "ipc recv max", test_ipc_recv_max },
+	{ "ipc send coalesced", test_ipc_send_coalesced },
 	{ "ipc connect refused", test_ipc_connect_refused },
 	{ "ipc connect blocking", test_ipc_connect_blocking },
 	{ "ipc connect blocking accept", test_ipc_connect_blocking_accept },
@@ -21,6 +21,24 @@
 typedef struct tcptran_pipe tcptran_pipe;
 typedef struct tcptran_ep   tcptran_ep;
 
+// Receive buffering.  Rather than reading each message header and body
+// separately, we read as much as will fit into a per-pipe buffer, and
+// split as many messages out of it as we can, copying each into its own
+// (pooled) message.  Bodies whose remainder is larger than half the
+// buffer are read directly into the message instead, as copying them
+// would buy us nothing.
+#define TCPTRAN_RXBUF_SIZE 16384
+#define TCPTRAN_RX_DIRECT (TCPTRAN_RXBUF_SIZE / 2)
+
+// Send coalescing.  With a non-zero budget, messages that fit in half of
+// it are copied into a per-pipe buffer, and their senders are completed
+// immediately.  The buffer is written in one send when the previous write
+// finishes, when it fills, or when the latency budget expires, whichever
+// is first.  Larger messages are written directly after the buffered
+// data, in the same send, and complete when that send does.  A second
+// buffer is filled while the first is being written.
+#define TCPTRAN_TXBUF_MAX (1U << 20)
+
 // tcp_pipe is one end of a TCP connection.
 struct tcptran_pipe {
 	nng_stream   *conn;
@@ -43,6 +61,22 @@ struct tcptran_pipe {
 	nni_aio       rxaio;
 	nni_aio       negoaio;
 	nni_msg      *rxmsg;
+	size_t        rxgot;    // bytes of rxmsg body received so far
+	uint8_t      *rxbuf;    // receive buffer, TCPTRAN_RXBUF_SIZE bytes
+	size_t        rxoff;    // start of unconsumed data in rxbuf
+	size_t        rxend;    // end of valid data in rxbuf
+	bool          rxio;     // rxaio is busy
+	bool          rxdirect; // rxaio is reading directly into rxmsg
+	bool          rxloop;   // recv callback is delivering messages
+	nni_aio      *txuser;   // user aio being written directly, if any
+	uint8_t      *txbuf;    // coalescing buffer being filled
+	uint8_t      *txout;    // coalescing buffer being written
+	size_t        txfill;   // bytes of txbuf used
+	size_t        txmax;    // coalescing budget, 0 if disabled
+	nng_duration  txtime;   // coalescing latency budget
+	bool          txbusy;   // txaio is busy
+	bool          txwait;   // txtimer is running
+	nni_aio       txtimer;
 	nni_mtx       mtx;
 };
 
@@ -50,6 +84,8 @@ struct tcptran_ep {
 	nni_mtx              mtx;
 	uint16_t             proto;
 	size_t               rcvmax;
+	size_t               txmax;
+	nng_duration         txtime;
 	bool                 fini;
 	bool                 started;
 	bool                 closed;
@@ -66,12 +102,15 @@ struct tcptran_ep {
 
 #ifdef NNG_ENABLE_STATS
 	nni_stat_item st_rcv_max;
+	nni_stat_item st_tx_writes;
 #endif
 };
 
 static void tcptran_pipe_send_start(tcptran_pipe *);
+static void tcptran_pipe_send_fill(tcptran_pipe *);
 static void tcptran_pipe_recv_start(tcptran_pipe *);
 static void tcptran_pipe_send_cb(void *);
+static void tcptran_pipe_send_timer_cb(void *);
 static void tcptran_pipe_recv_cb(void *);
 static void tcptran_pipe_nego_cb(void *);
 static void tcptran_ep_fini(void *);
@@ -98,6 +137,7 @@ tcptran_pipe_close(void *arg)
 
 	nni_aio_close(&p->rxaio);
 	nni_aio_close(&p->txaio);
+	nni_aio_close(&p->txtimer);
 	nni_aio_close(&p->negoaio);
 
 	nng_stream_close(p->conn);
@@ -111,6 +151,7 @@ tcptran_pipe_stop(void *arg)
 
 	nni_aio_stop(&p->rxaio);
 	nni_aio_stop(&p->txaio);
+	nni_aio_stop(&p->txtimer);
 	nni_aio_stop(&p->negoaio);
 	nng_stream_stop(p->conn);
 	nni_mtx_lock(&ep->mtx);
@@ -122,9 +163,14 @@ static int
 tcptran_pipe_init(void *arg, nni_pipe *npipe)
 {
 	tcptran_pipe *p = arg;
-	p->npipe        = npipe;
+
+	if ((p->rxbuf = nni_alloc(TCPTRAN_RXBUF_SIZE)) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	p->npipe = npipe;
 	nni_mtx_init(&p->mtx);
 	nni_aio_init(&p->txaio, tcptran_pipe_send_cb, p);
+	nni_aio_init(&p->txtimer, tcptran_pipe_send_timer_cb, p);
 	nni_aio_init(&p->rxaio, tcptran_pipe_recv_cb, p);
 	nni_aio_init(&p->negoaio, tcptran_pipe_nego_cb, p);
 	nni_aio_list_init(&p->recvq);
@@ -142,8 +188,16 @@ tcptran_pipe_fini(void *arg)
 	nng_stream_free(p->conn);
 	nni_aio_fini(&p->rxaio);
 	nni_aio_fini(&p->txaio);
+	nni_aio_fini(&p->txtimer);
 	nni_aio_fini(&p->negoaio);
 	nni_msg_free(p->rxmsg);
+	if (p->rxbuf != NULL) {
+		nni_free(p->rxbuf, TCPTRAN_RXBUF_SIZE);
+	}
+	if (p->txbuf != NULL) {
+		nni_free(p->txbuf, p->txmax);
+		nni_free(p->txout, p->txmax);
+	}
 	nni_mtx_fini(&p->mtx);
 }
 
@@ -160,6 +214,24 @@ tcptran_ep_match(tcptran_ep *ep)
 	nni_list_remove(&ep->waitpipes, p);
 	ep->useraio = NULL;
 	p->rcvmax   = ep->rcvmax;
+	p->txtime   = ep->txtime;
+	if (ep->txmax > 0) {
+		// If we cannot get the buffers, just send without them.
+		p->txbuf = nni_alloc(ep->txmax);
+		p->txout = nni_alloc(ep->txmax);
+		if ((p->txbuf != NULL) && (p->txout != NULL)) {
+			p->txmax = ep->txmax;
+		} else {
+			if (p->txbuf != NULL) {
+				nni_free(p->txbuf, ep->txmax);
+			}
+			if (p->txout != NULL) {
+				nni_free(p->txout, ep->txmax);
+			}
+			p->txbuf = NULL;
+			p->txout = NULL;
+		}
+	}
 	nni_aio_set_output(aio, 0, p->npipe);
 	nni_aio_finish(aio, 0, 0);
 }
@@ -261,7 +333,8 @@ tcptran_pipe_send_cb(void *arg)
 	nni_aio      *txaio = &p->txaio;
 
 	nni_mtx_lock(&p->mtx);
-	aio = nni_list_first(&p->sendq);
+	aio       = p->txuser;
+	p->txuser = NULL;
 
 	if ((rv = nni_aio_result(txaio)) != 0) {
 		nni_pipe_bump_error(p->npipe, rv);
@@ -269,7 +342,13 @@ tcptran_pipe_send_cb(void *arg)
 		// There's an excellent chance that the pipe is no longer
 		// usable, with a partial transfer.
 		// The protocol should see this error, and close the
-		// pipe itself, we hope.
+		// pipe itself, we hope.  If only coalesced messages were
+		// being written, there is nobody to tell, so we close it.
+		if (aio == NULL) {
+			nni_mtx_unlock(&p->mtx);
+			nni_pipe_close(p->npipe);
+			return;
+		}
 		nni_aio_list_remove(aio);
 		nni_mtx_unlock(&p->mtx);
 		nni_aio_finish_error(aio, rv);
@@ -279,22 +358,147 @@ tcptran_pipe_send_cb(void *arg)
 	n = nni_aio_count(txaio);
 	nni_aio_iov_advance(txaio, n);
 	if (nni_aio_iov_count(txaio) > 0) {
+		p->txuser = aio;
+#ifdef NNG_ENABLE_STATS
+		nni_stat_inc(&p->ep->st_tx_writes, 1);
+#endif
 		nng_stream_send(p->conn, txaio);
 		nni_mtx_unlock(&p->mtx);
 		return;
 	}
 
-	nni_aio_list_remove(aio);
+	p->txbusy = false;
+	if (aio != NULL) {
+		nni_aio_list_remove(aio);
+		msg = nni_aio_get_msg(aio);
+		n   = nni_msg_len(msg);
+		nni_pipe_bump_tx(p->npipe, n);
+	}
+	// Anything that queued up meanwhile has waited long enough.
+	tcptran_pipe_send_fill(p);
 	tcptran_pipe_send_start(p);
+	nni_mtx_unlock(&p->mtx);
 
-	msg = nni_aio_get_msg(aio);
-	n   = nni_msg_len(msg);
-	nni_pipe_bump_tx(p->npipe, n);
+	if (aio != NULL) {
+		nni_aio_set_msg(aio, NULL);
+		nni_msg_free(msg);
+		nni_aio_finish_sync(aio, 0, n);
+	}
+}
+
+static void
+tcptran_pipe_send_timer_cb(void *arg)
+{
+	tcptran_pipe *p = arg;
+
+	nni_mtx_lock(&p->mtx);
+	p->txwait = false;
+	if (!p->txbusy) {
+		tcptran_pipe_send_start(p);
+	}
 	nni_mtx_unlock(&p->mtx);
+}
 
-	nni_aio_set_msg(aio, NULL);
-	nni_msg_free(msg);
-	nni_aio_finish_sync(aio, 0, n);
+// tcptran_pipe_recv_parse tries to produce a complete message from the
+// receive buffer.  If it cannot, it starts a read for more data and
+// returns a NULL message.  It must only be called when a receiver is
+// waiting, and the receive aio is idle.
+static nng_err
+tcptran_pipe_recv_parse(tcptran_pipe *p, nni_msg **msgp)
+{
+	nni_iov iov;
+	size_t  avail;
+	nng_err rv;
+
+	*msgp = NULL;
+	for (;;) {
+		avail = p->rxend - p->rxoff;
+		if (p->rxmsg == NULL) {
+			uint64_t len;
+
+			if (avail < sizeof(uint64_t)) {
+				break;
+			}
+			// We have the length header.  This tells us the size
+			// of the message to allocate and how much to expect.
+			NNI_GET64(p->rxbuf + p->rxoff, len);
+			p->rxoff += sizeof(uint64_t);
+
+			// Make sure the message payload is not too big.  If
+			// it is the caller will shut down the pipe.
+			if ((len > p->rcvmax) && (p->rcvmax > 0)) {
+				nng_sockaddr_storage ss;
+				nng_sockaddr        *sa = (nng_sockaddr *) &ss;
+				char peername[64]       = "unknown";
+				if (nng_stream_get_addr(
+				        p->conn, NNG_OPT_REMADDR, sa) == 0) {
+					(void) nng_str_sockaddr(
+					    sa, peername, sizeof(peername));
+				}
+				nng_log_warn("NNG-RCVMAX",
+				    "Oversize message of %lu bytes (> %lu) "
+				    "on socket<%u> pipe<%u> from TCP %s",
+				    (unsigned long) len,
+				    (unsigned long) p->rcvmax,
+				    nni_pipe_sock_id(p->npipe),
+				    nni_pipe_id(p->npipe), peername);
+				return (NNG_EMSGSIZE);
+			}
+			if ((rv = nni_msg_alloc(&p->rxmsg, (size_t) len)) !=
+			    0) {
+				return (rv);
+			}
+			p->rxgot = 0;
+			continue;
+		}
+
+		// Copy out whatever part of the body we have.
+		size_t want = nni_msg_len(p->rxmsg) - p->rxgot;
+		size_t n    = avail < want ? avail : want;
+		if (n > 0) {
+			memcpy((uint8_t *) nni_msg_body(p->rxmsg) + p->rxgot,
+			    p->rxbuf + p->rxoff, n);
+			p->rxoff += n;
+			p->rxgot += n;
+			want -= n;
+		}
+		if (want == 0) {
+			*msgp    = p->rxmsg;
+			p->rxmsg = NULL;
+			if (p->rxoff == p->rxend) {
+				p->rxoff = p->rxend = 0;
+			}
+			return (NNG_OK);
+		}
+
+		// The buffer is empty; if the rest is large, read it
+		// straight into the message.
+		p->rxoff = p->rxend = 0;
+		if (want >= TCPTRAN_RX_DIRECT) {
+			iov.iov_buf =
+			    (uint8_t *) nni_msg_body(p->rxmsg) + p->rxgot;
+			iov.iov_len = want;
+			nni_aio_set_iov(&p->rxaio, 1, &iov);
+			p->rxio     = true;
+			p->rxdirect = true;
+			nng_stream_recv(p->conn, &p->rxaio);
+			return (NNG_OK);
+		}
+		break;
+	}
+
+	// Need more data.  Move any partial data to the front first.
+	if (p->rxoff > 0) {
+		memmove(p->rxbuf, p->rxbuf + p->rxoff, p->rxend - p->rxoff);
+		p->rxend -= p->rxoff;
+		p->rxoff = 0;
+	}
+	iov.iov_buf = p->rxbuf + p->rxend;
+	iov.iov_len = TCPTRAN_RXBUF_SIZE - p->rxend;
+	nni_aio_set_iov(&p->rxaio, 1, &iov);
+	p->rxio = true;
+	nng_stream_recv(p->conn, &p->rxaio);
+	return (NNG_OK);
 }
 
 static void
@@ -308,7 +512,8 @@ tcptran_pipe_recv_cb(void *arg)
 	nni_aio      *rxaio = &p->rxaio;
 
 	nni_mtx_lock(&p->mtx);
-	aio = nni_list_first(&p->recvq);
+	p->rxio = false;
+	aio     = nni_list_first(&p->recvq);
 
 	if ((rv = nni_aio_result(rxaio)) != 0) {
 		goto recv_error;
@@ -320,72 +525,51 @@ tcptran_pipe_recv_cb(void *arg)
 	}
 
 	n = nni_aio_count(rxaio);
-	nni_aio_iov_advance(rxaio, n);
-	if (nni_aio_iov_count(rxaio) > 0) {
-		nng_stream_recv(p->conn, rxaio);
-		nni_mtx_unlock(&p->mtx);
-		return;
+	if (p->rxdirect) {
+		p->rxgot += n;
+		nni_aio_iov_advance(rxaio, n);
+		if (nni_aio_iov_count(rxaio) > 0) {
+			p->rxio = true;
+			nng_stream_recv(p->conn, rxaio);
+			nni_mtx_unlock(&p->mtx);
+			return;
+		}
+		p->rxdirect = false;
+	} else {
+		p->rxend += n;
 	}
 
-	// If we don't have a message yet, we were reading the TCP message
-	// header, which is just the length.  This tells us the size of the
-	// message to allocate and how much more to expect.
-	if (p->rxmsg == NULL) {
-		uint64_t len;
-		// We should have gotten a message header.
-		NNI_GET64(p->rxlen, len);
-
-		// Make sure the message payload is not too big.  If it is
-		// the caller will shut down the pipe.
-		if ((len > p->rcvmax) && (p->rcvmax > 0)) {
-			nng_sockaddr_storage ss;
-			nng_sockaddr        *sa = (nng_sockaddr *) &ss;
-			char                 peername[64] = "unknown";
-			if ((rv = nng_stream_get_addr(
-			         p->conn, NNG_OPT_REMADDR, sa)) == 0) {
-				(void) nng_str_sockaddr(
-				    sa, peername, sizeof(peername));
-			}
-			nng_log_warn("NNG-RCVMAX",
-			    "Oversize message of %lu bytes (> %lu) "
-			    "on socket<%u> pipe<%u> from TCP %s",
-			    (unsigned long) len, (unsigned long) p->rcvmax,
-			    nni_pipe_sock_id(p->npipe), nni_pipe_id(p->npipe),
-			    peername);
-			rv = NNG_EMSGSIZE;
+	// Deliver as many messages as we have receivers for.  Receivers
+	// that show up while we are delivering (typically the protocol
+	// resubmitting from its callback) are handled here too, which
+	// avoids both recursion and extra reads.
+	p->rxloop = true;
+	while ((aio = nni_list_first(&p->recvq)) != NULL) {
+		if ((rv = tcptran_pipe_recv_parse(p, &msg)) != 0) {
+			p->rxloop = false;
 			goto recv_error;
 		}
-
-		if ((rv = nni_msg_alloc(&p->rxmsg, (size_t) len)) != 0) {
-			goto recv_error;
+		if (msg == NULL) {
+			break; // waiting for more data
 		}
+		nni_aio_list_remove(aio);
+		n = nni_msg_len(msg);
+		nni_pipe_bump_rx(p->npipe, n);
+		nni_mtx_unlock(&p->mtx);
 
-		// Submit the rest of the data for a read -- we want to
-		// read the entire message now.
-		if (len != 0) {
-			nni_iov iov;
-			iov.iov_buf = nni_msg_body(p->rxmsg);
-			iov.iov_len = (size_t) len;
+		nni_aio_set_msg(aio, msg);
+		nni_aio_finish_sync(aio, 0, n);
 
-			nni_aio_set_iov(rxaio, 1, &iov);
-			nng_stream_recv(p->conn, rxaio);
-			nni_mtx_unlock(&p->mtx);
-			return;
+		nni_mtx_lock(&p->mtx);
+		if (p->closed) {
+			break;
 		}
 	}
-
-	// We read a message completely.  Let the user know the good news.
-	nni_aio_list_remove(aio);
-	msg      = p->rxmsg;
-	p->rxmsg = NULL;
-	n        = nni_msg_len(msg);
-
-	nni_pipe_bump_rx(p->npipe, n);
-	tcptran_pipe_recv_start(p);
+	p->rxloop = false;
+	if (p->closed) {
+		tcptran_pipe_recv_start(p);
+	}
 	nni_mtx_unlock(&p->mtx);
-
-	nni_aio_set_msg(aio, msg);
-	nni_aio_finish_sync(aio, 0, n);
 	return;
 
 recv_error:
@@ -414,7 +598,7 @@ tcptran_pipe_send_cancel(nni_aio *aio, void *arg, nng_err rv)
 	// If this is being sent, then cancel the pending transfer.
 	// The callback on the txaio will cause the user aio to
 	// be canceled too.
-	if (nni_list_first(&p->sendq) == aio) {
+	if (p->txuser == aio) {
 		nni_aio_abort(&p->txaio, rv);
 		nni_mtx_unlock(&p->mtx);
 		return;
@@ -425,14 +609,50 @@ tcptran_pipe_send_cancel(nni_aio *aio, void *arg, nng_err rv)
 	nni_aio_finish_error(aio, rv);
 }
 
+// tcptran_pipe_send_fill copies queued messages into the coalescing
+// buffer, completing their senders, until one does not fit.
+static void
+tcptran_pipe_send_fill(tcptran_pipe *p)
+{
+	nni_aio *aio;
+	nni_msg *msg;
+	size_t   hlen;
+	size_t   blen;
+	size_t   len;
+
+	while (((aio = nni_list_first(&p->sendq)) != NULL) &&
+	    (aio != p->txuser)) {
+		msg  = nni_aio_get_msg(aio);
+		hlen = nni_msg_header_len(msg);
+		blen = nni_msg_len(msg);
+		len  = sizeof(uint64_t) + hlen + blen;
+		if ((len > p->txmax / 2) || (len > p->txmax - p->txfill)) {
+			break;
+		}
+		NNI_PUT64(p->txbuf + p->txfill, hlen + blen);
+		p->txfill += sizeof(uint64_t);
+		memcpy(p->txbuf + p->txfill, nni_msg_header(msg), hlen);
+		p->txfill += hlen;
+		memcpy(p->txbuf + p->txfill, nni_msg_body(msg), blen);
+		p->txfill += blen;
+
+		nni_aio_list_remove(aio);
+		nni_aio_set_msg(aio, NULL);
+		nni_msg_free(msg);
+		nni_pipe_bump_tx(p->npipe, blen);
+		nni_aio_finish(aio, 0, blen);
+	}
+}
+
 static void
 tcptran_pipe_send_start(tcptran_pipe *p)
 {
 	nni_aio *aio;
 	nni_aio *txaio;
 	nni_msg *msg;
+	uint8_t *buf;
 	int      niov;
-	nni_iov  iov[3];
+	nni_iov  iov[4];
 	uint64_t len;
 
 	if (p->closed) {
@@ -443,31 +663,53 @@ tcptran_pipe_send_start(tcptran_pipe *p)
 		return;
 	}
 
-	if ((aio = nni_list_first(&p->sendq)) == NULL) {
-		return;
+	niov = 0;
+	if (p->txfill > 0) {
+		buf            = p->txbuf;
+		p->txbuf       = p->txout;
+		p->txout       = buf;
+		iov[0].iov_buf = buf;
+		iov[0].iov_len = p->txfill;
+		p->txfill      = 0;
+		niov++;
+
+		// Start filling the other buffer for the next write.
+		tcptran_pipe_send_fill(p);
 	}
 
-	// This runs to send the message.
-	msg = nni_aio_get_msg(aio);
-	len = nni_msg_len(msg) + nni_msg_header_len(msg);
+	// Whatever is left at the head of the queue was too large to
+	// copy, so we send it directly, unless it must follow messages
+	// that were just copied.
+	if ((p->txfill == 0) && ((aio = nni_list_first(&p->sendq)) != NULL)) {
+		msg = nni_aio_get_msg(aio);
+		len = nni_msg_len(msg) + nni_msg_header_len(msg);
 
-	NNI_PUT64(p->txlen, len);
+		NNI_PUT64(p->txlen, len);
 
-	txaio          = &p->txaio;
-	niov           = 0;
-	iov[0].iov_buf = p->txlen;
-	iov[0].iov_len = sizeof(p->txlen);
-	niov++;
-	if (nni_msg_header_len(msg) > 0) {
-		iov[niov].iov_buf = nni_msg_header(msg);
-		iov[niov].iov_len = nni_msg_header_len(msg);
+		iov[niov].iov_buf = p->txlen;
+		iov[niov].iov_len = sizeof(p->txlen);
 		niov++;
+		if (nni_msg_header_len(msg) > 0) {
+			iov[niov].iov_buf = nni_msg_header(msg);
+			iov[niov].iov_len = nni_msg_header_len(msg);
+			niov++;
+		}
+		if (nni_msg_len(msg) > 0) {
+			iov[niov].iov_buf = nni_msg_body(msg);
+			iov[niov].iov_len = nni_msg_len(msg);
+			niov++;
+		}
+		p->txuser = aio;
 	}
-	if (nni_msg_len(msg) > 0) {
-		iov[niov].iov_buf = nni_msg_body(msg);
-		iov[niov].iov_len = nni_msg_len(msg);
-		niov++;
+	if (niov == 0) {
+		return;
 	}
+
+	txaio     = &p->txaio;
+	p->txbusy = true;
+#ifdef NNG_ENABLE_STATS
+	nni_stat_inc(&p->ep->st_tx_writes, 1);
+#endif
 	nni_aio_set_iov(txaio, niov, iov);
 	nng_stream_send(p->conn, txaio);
 }
@@ -484,7 +726,17 @@ tcptran_pipe_send(void *arg, nni_aio *aio)
 		return;
 	}
 	nni_list_append(&p->sendq, aio);
-	if (nni_list_first(&p->sendq) == aio) {
+	tcptran_pipe_send_fill(p);
+	if (p->txbusy) {
+		// The message goes out when the current write finishes.
+	} else if ((p->txtime > 0) && (p->txfill < p->txmax) &&
+	    nni_list_empty(&p->sendq)) {
+		// Wait a little for more messages to fill the buffer.
+		if (!p->txwait) {
+			p->txwait = true;
+			nni_sleep_aio(p->txtime, &p->txtimer);
+		}
+	} else {
 		tcptran_pipe_send_start(p);
 	}
 	nni_mtx_unlock(&p->mtx);
@@ -503,7 +755,7 @@ tcptran_pipe_recv_cancel(nni_aio *aio, void *arg, nng_err rv)
 	// If receive in progress, then cancel the pending transfer.
 	// The callback on the rxaio will cause the user aio to
 	// be canceled too.
-	if (nni_list_first(&p->recvq) == aio) {
+	if ((nni_list_first(&p->recvq) == aio) && p->rxio) {
 		nni_aio_abort(&p->rxaio, rv);
 		nni_mtx_unlock(&p->mtx);
 		return;
@@ -516,28 +768,40 @@ tcptran_pipe_recv_cancel(nni_aio *aio, void *arg, nng_err rv)
 static void
 tcptran_pipe_recv_start(tcptran_pipe *p)
 {
-	nni_aio *rxaio = &p->rxaio;
-	nni_iov  iov;
-	NNI_ASSERT(p->rxmsg == NULL);
+	nni_aio *aio;
+	nni_msg *msg;
+	nng_err  rv;
 
 	if (p->closed) {
-		nni_aio *aio;
 		while ((aio = nni_list_first(&p->recvq)) != NULL) {
 			nni_list_remove(&p->recvq, aio);
 			nni_aio_finish_error(aio, NNG_ECLOSED);
 		}
 		return;
 	}
-	if (nni_list_empty(&p->recvq)) {
+	// If a read is in flight, or the callback is delivering, then
+	// they will take care of any new receivers.
+	if (p->rxio || p->rxloop ||
+	    ((aio = nni_list_first(&p->recvq)) == NULL)) {
 		return;
 	}
 
-	// Schedule a read of the header.
-	iov.iov_buf = p->rxlen;
-	iov.iov_len = sizeof(p->rxlen);
-	nni_aio_set_iov(rxaio, 1, &iov);
-
-	nng_stream_recv(p->conn, rxaio);
+	// We may already have a complete message buffered.  We cannot
+	// complete synchronously here, as we hold the lock.
+	if ((rv = tcptran_pipe_recv_parse(p, &msg)) != 0) {
+		nni_aio_list_remove(aio);
+		nni_msg_free(p->rxmsg);
+		p->rxmsg = NULL;
+		nni_pipe_bump_error(p->npipe, rv);
+		nni_aio_finish_error(aio, rv);
+		return;
+	}
+	if (msg != NULL) {
+		nni_aio_list_remove(aio);
+		nni_pipe_bump_rx(p->npipe, nni_msg_len(msg));
+		nni_aio_set_msg(aio, msg);
+		nni_aio_finish(aio, 0, nni_msg_len(msg));
+	}
 }
 
 static void
@@ -782,7 +1046,15 @@ tcptran_ep_init(tcptran_ep *ep, nni_sock *sock, void (*conn_cb)(void *))
 		.si_unit   = NNG_UNIT_BYTES,
 		.si_atomic = true,
 	};
+	static const nni_stat_info tx_writes_info = {
+		.si_name   = "tx_writes",
+		.si_desc   = "number of stream writes",
+		.si_type   = NNG_STAT_COUNTER,
+		.si_unit   = NNG_UNIT_EVENTS,
+		.si_atomic = true,
+	};
 	nni_stat_init(&ep->st_rcv_max, &rcv_max_info);
+	nni_stat_init(&ep->st_tx_writes, &tx_writes_info);
 #endif
 }
 
@@ -812,6 +1084,7 @@ tcptran_dialer_init(void *arg, nng_url *url, nni_dialer *ndialer)
 
 #ifdef NNG_ENABLE_STATS
 	nni_dialer_add_stat(ndialer, &ep->st_rcv_max);
+	nni_dialer_add_stat(ndialer, &ep->st_tx_writes);
 #endif
 	return (NNG_OK);
 }
@@ -841,6 +1114,7 @@ tcptran_listener_init(void *arg, nng_url *url, nni_listener *nlistener)
 	}
 #ifdef NNG_ENABLE_STATS
 	nni_listener_add_stat(nlistener, &ep->st_rcv_max);
+	nni_listener_add_stat(nlistener, &ep->st_tx_writes);
 #endif
 
 	return (NNG_OK);
@@ -914,6 +1188,60 @@ tcptran_ep_set_recvmaxsz(void *arg, const void *v, size_t sz, nni_opt_type t)
 	return (rv);
 }
 
+static nng_err
+tcptran_ep_get_coalesce(void *arg, void *v, size_t *szp, nni_opt_type t)
+{
+	tcptran_ep *ep = arg;
+	nng_err     rv;
+
+	nni_mtx_lock(&ep->mtx);
+	rv = nni_copyout_size(ep->txmax, v, szp, t);
+	nni_mtx_unlock(&ep->mtx);
+	return (rv);
+}
+
+static nng_err
+tcptran_ep_set_coalesce(void *arg, const void *v, size_t sz, nni_opt_type t)
+{
+	tcptran_ep *ep = arg;
+	size_t      val;
+	nng_err     rv;
+	if ((rv = nni_copyin_size(&val, v, sz, 0, TCPTRAN_TXBUF_MAX, t)) ==
+	    NNG_OK) {
+		nni_mtx_lock(&ep->mtx);
+		ep->txmax = val;
+		nni_mtx_unlock(&ep->mtx);
+	}
+	return (rv);
+}
+
+static nng_err
+tcptran_ep_get_coalesce_time(void *arg, void *v, size_t *szp, nni_opt_type t)
+{
+	tcptran_ep *ep = arg;
+	nng_err     rv;
+
+	nni_mtx_lock(&ep->mtx);
+	rv = nni_copyout_ms(ep->txtime, v, szp, t);
+	nni_mtx_unlock(&ep->mtx);
+	return (rv);
+}
+
+static nng_err
+tcptran_ep_set_coalesce_time(
+    void *arg, const void *v, size_t sz, nni_opt_type t)
+{
+	tcptran_ep  *ep = arg;
+	nng_duration val;
+	nng_err      rv;
+	if ((rv = nni_copyin_ms(&val, v, sz, t)) == NNG_OK) {
+		nni_mtx_lock(&ep->mtx);
+		ep->txtime = val;
+		nni_mtx_unlock(&ep->mtx);
+	}
+	return (rv);
+}
+
 static nng_err
 tcptran_ep_bind(void *arg, nng_url *url)
 {
@@ -988,6 +1316,16 @@ static const nni_option tcptran_ep_opts[] = {
 	    .o_get  = tcptran_ep_get_recvmaxsz,
 	    .o_set  = tcptran_ep_set_recvmaxsz,
 	},
+	{
+	    .o_name = NNG_OPT_SEND_COALESCE,
+	    .o_get  = tcptran_ep_get_coalesce,
+	    .o_set  = tcptran_ep_set_coalesce,
+	},
+	{
+	    .o_name = NNG_OPT_SEND_COALESCE_TIME,
+	    .o_get  = tcptran_ep_get_coalesce_time,
+	    .o_set  = tcptran_ep_set_coalesce_time,
+	},
 	// terminate list
 	{
 	    .o_name = NULL,
@@ -1059,6 +1397,7 @@ static nni_sp_dialer_ops tcptran_dialer_ops = {
 	.d_stop    = tcptran_ep_stop,
 	.d_getopt  = tcptran_dialer_getopt,
 	.d_setopt  = tcptran_dialer_setopt,
+	.d_multi   = true,
 };
 
 static nni_sp_listener_ops tcptran_listener_ops = {
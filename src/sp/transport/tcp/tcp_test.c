@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 // Copyright 2018 Devolutions <info@devolutions.net>
 // Copyright 2018 Cody Piersall <cody.piersall@gmail.com>
@@ -202,6 +202,248 @@ test_tcp_recv_max(void)
 	NUTS_CLOSE(s1);
 }
 
+// Message sizes for the batched receive test.  This mixes small messages,
+// many of which arrive together, with messages large enough to be read
+// directly into the message body.
+static size_t
+batch_size(int i)
+{
+	return ((size_t) (i % 7 == 0 ? (i * 997) % 40000 : (i * 37) % 512));
+}
+
+static void
+batch_sender(void *arg)
+{
+	nng_socket *s = arg;
+	nng_msg    *msg;
+
+	for (int i = 0; i < 1000; i++) {
+		size_t sz = batch_size(i);
+		NUTS_PASS(nng_msg_alloc(&msg, sz));
+		memset(nng_msg_body(msg), i & 0xff, sz);
+		NUTS_PASS(nng_sendmsg(*s, msg, 0));
+	}
+}
+
+static void
+batch_receiver(nng_socket s)
+{
+	for (int i = 0; i < 1000; i++) {
+		nng_msg *msg;
+		uint8_t *body;
+		NUTS_PASS(nng_recvmsg(s, &msg, 0));
+		NUTS_TRUE(nng_msg_len(msg) == batch_size(i));
+		body = nng_msg_body(msg);
+		for (size_t j = 0; j < nng_msg_len(msg); j++) {
+			NUTS_ASSERT(body[j] == (i & 0xff));
+		}
+		nng_msg_free(msg);
+	}
+}
+
+void
+test_tcp_recv_batched(void)
+{
+	nng_socket  s0;
+	nng_socket  s1;
+	nng_thread *thr;
+	char       *addr;
+
+	NUTS_ADDR(addr, "tcp");
+	NUTS_OPEN(s0);
+	NUTS_OPEN(s1);
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_socket_set_ms(s1, NNG_OPT_SENDTIMEO, 5000));
+	NUTS_PASS(nng_listen(s0, addr, NULL, 0));
+	NUTS_PASS(nng_dial(s1, addr, NULL, 0));
+	NUTS_PASS(nng_thread_create(&thr, batch_sender, &s1));
+	batch_receiver(s0);
+	nng_thread_destroy(thr);
+	NUTS_CLOSE(s0);
+	NUTS_CLOSE(s1);
+}
+
+void
+test_tcp_send_coalesced(void)
+{
+	nng_socket   s0;
+	nng_socket   s1;
+	nng_dialer   d;
+	nng_thread  *thr;
+	size_t       sz;
+	nng_duration t;
+	char        *addr;
+
+	NUTS_ADDR(addr, "tcp");
+	NUTS_OPEN(s0);
+	NUTS_OPEN(s1);
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_socket_set_ms(s1, NNG_OPT_SENDTIMEO, 5000));
+	NUTS_PASS(nng_listen(s0, addr, NULL, 0));
+	NUTS_PASS(nng_dialer_create(&d, s1, addr));
+	NUTS_PASS(nng_dialer_get_size(d, NNG_OPT_SEND_COALESCE, &sz));
+	NUTS_TRUE(sz == 0);
+	NUTS_PASS(nng_dialer_set_size(d, NNG_OPT_SEND_COALESCE, 8192));
+	NUTS_PASS(nng_dialer_get_size(d, NNG_OPT_SEND_COALESCE, &sz));
+	NUTS_TRUE(sz == 8192);
+	NUTS_FAIL(nng_dialer_set_size(d, NNG_OPT_SEND_COALESCE, 1U << 30),
+	    NNG_EINVAL);
+	NUTS_FAIL(nng_dialer_set_bool(d, NNG_OPT_SEND_COALESCE, true),
+	    NNG_EBADTYPE);
+	NUTS_PASS(nng_dialer_set_ms(d, NNG_OPT_SEND_COALESCE_TIME, 10));
+	NUTS_PASS(nng_dialer_get_ms(d, NNG_OPT_SEND_COALESCE_TIME, &t));
+	NUTS_TRUE(t == 10);
+	NUTS_PASS(nng_dialer_start(d, 0));
+
+	NUTS_PASS(nng_thread_create(&thr, batch_sender, &s1));
+	batch_receiver(s0);
+	nng_thread_destroy(thr);
+
+#ifdef NNG_ENABLE_STATS
+	// Small messages should have shared writes.
+	nng_stat       *stats;
+	const nng_stat *writes;
+	NUTS_PASS(nng_stats_get(&stats));
+	writes = nng_stat_find(nng_stat_find_dialer(stats, d), "tx_writes");
+	NUTS_TRUE(writes != NULL);
+	NUTS_TRUE(nng_stat_value(writes) < 500);
+	nng_stats_free(stats);
+#endif
+	NUTS_CLOSE(s0);
+	NUTS_CLOSE(s1);
+}
+
+typedef struct {
+	nng_mtx *mtx;
+	nng_cv  *cv;
+	int      adds;
+	int      pipes;
+	nng_pipe last;
+} stripe_state;
+
+static void
+stripe_notify(nng_pipe p, nng_pipe_ev ev, void *arg)
+{
+	stripe_state *st = arg;
+
+	nng_mtx_lock(st->mtx);
+	if (ev == NNG_PIPE_EV_ADD_POST) {
+		st->adds++;
+		st->pipes++;
+		st->last = p;
+	} else {
+		st->pipes--;
+	}
+	nng_cv_wake(st->cv);
+	nng_mtx_unlock(st->mtx);
+}
+
+static bool
+stripe_wait(stripe_state *st, int adds, int pipes)
+{
+	nng_time deadline = nng_clock() + 5000;
+	bool     ok;
+
+	nng_mtx_lock(st->mtx);
+	while ((st->adds < adds) || (st->pipes != pipes)) {
+		if (nng_cv_until(st->cv, deadline) == NNG_ETIMEDOUT) {
+			break;
+		}
+	}
+	ok = (st->adds >= adds) && (st->pipes == pipes);
+	nng_mtx_unlock(st->mtx);
+	return (ok);
+}
+
+void
+test_tcp_dial_pipes(void)
+{
+	nng_socket   s0;
+	nng_socket   s1;
+	nng_dialer   d;
+	nng_dialer   d2;
+	stripe_state st = { 0 };
+	char        *addr;
+	int          n;
+	nng_pipe     p;
+	nng_msg     *m;
+
+	NUTS_PASS(nng_mtx_alloc(&st.mtx));
+	NUTS_PASS(nng_cv_alloc(&st.cv, st.mtx));
+	NUTS_ADDR(addr, "tcp");
+	NUTS_PASS(nng_pull0_open(&s0));
+	NUTS_PASS(nng_push0_open(&s1));
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_socket_set_ms(s1, NNG_OPT_SENDTIMEO, 5000));
+	NUTS_PASS(nng_pipe_notify(
+	    s0, NNG_PIPE_EV_ADD_POST, stripe_notify, &st));
+	NUTS_PASS(nng_pipe_notify(
+	    s0, NNG_PIPE_EV_REM_POST, stripe_notify, &st));
+	NUTS_PASS(nng_listen(s0, addr, NULL, 0));
+	NUTS_PASS(nng_dialer_create(&d, s1, addr));
+	NUTS_PASS(nng_dialer_get_int(d, NNG_OPT_DIAL_PIPES, &n));
+	NUTS_TRUE(n == 1);
+	NUTS_FAIL(nng_dialer_set_int(d, NNG_OPT_DIAL_PIPES, 0), NNG_EINVAL);
+	NUTS_FAIL(nng_dialer_set_bool(d, NNG_OPT_DIAL_PIPES, true),
+	    NNG_EBADTYPE);
+	NUTS_PASS(nng_dialer_set_int(d, NNG_OPT_DIAL_PIPES, 4));
+	NUTS_PASS(nng_dialer_get_int(d, NNG_OPT_DIAL_PIPES, &n));
+	NUTS_TRUE(n == 4);
+	NUTS_PASS(nng_dialer_start(d, 0));
+	NUTS_TRUE(stripe_wait(&st, 4, 4));
+
+	// Messages are spread over the pipes, and all arrive.
+	for (int i = 0; i < 8; i++) {
+		NUTS_SEND(s1, "stripe");
+	}
+	for (int i = 0; i < 8; i++) {
+		NUTS_RECV(s0, "stripe");
+	}
+
+	// A lost pipe is redialed, on its own, as a new pipe.
+	nng_mtx_lock(st.mtx);
+	p = st.last;
+	nng_mtx_unlock(st.mtx);
+	NUTS_PASS(nng_pipe_close(p));
+	NUTS_TRUE(stripe_wait(&st, 5, 4));
+	nng_mtx_lock(st.mtx);
+	NUTS_TRUE(nng_pipe_id(st.last) != nng_pipe_id(p));
+	nng_mtx_unlock(st.mtx);
+
+	// Raising it later dials the extra pipes.
+	NUTS_PASS(nng_dialer_set_int(d, NNG_OPT_DIAL_PIPES, 6));
+	NUTS_TRUE(stripe_wait(&st, 7, 6));
+
+	// Lowering it closes the surplus, without redialing them.
+	NUTS_PASS(nng_dialer_set_int(d, NNG_OPT_DIAL_PIPES, 2));
+	NUTS_TRUE(stripe_wait(&st, 7, 2));
+	NUTS_SLEEP(100);
+	NUTS_TRUE(stripe_wait(&st, 7, 2));
+
+	// And a pipe lost after that is still redialed.  The last pipe
+	// added may have been closed, so use one that carried a message.
+	NUTS_SEND(s1, "stripe");
+	NUTS_PASS(nng_recvmsg(s0, &m, 0));
+	p = nng_msg_get_pipe(m);
+	nng_msg_free(m);
+	NUTS_PASS(nng_pipe_close(p));
+	NUTS_TRUE(stripe_wait(&st, 8, 2));
+	for (int i = 0; i < 4; i++) {
+		NUTS_SEND(s1, "stripe");
+		NUTS_RECV(s0, "stripe");
+	}
+
+	// Transports that cannot stripe refuse more than one.
+	NUTS_PASS(nng_dialer_create(&d2, s1, "inproc://dial-pipes"));
+	NUTS_PASS(nng_dialer_set_int(d2, NNG_OPT_DIAL_PIPES, 1));
+	NUTS_FAIL(nng_dialer_set_int(d2, NNG_OPT_DIAL_PIPES, 2), NNG_ENOTSUP);
+
+	NUTS_CLOSE(s1);
+	NUTS_CLOSE(s0);
+	nng_cv_free(st.cv);
+	nng_mtx_free(st.mtx);
+}
+
 static void
 check_props_v4(nng_msg *msg)
 {
@@ -290,6 +532,9 @@ NUTS_TESTS = {
 	{ "tcp no delay option", test_tcp_no_delay_option },
 	{ "tcp keep alive option", test_tcp_keep_alive_option },
 	{ "tcp recv max", test_tcp_recv_max },
+	{ "tcp recv batched", test_tcp_recv_batched },
+	{ "tcp send coalesced", test_tcp_send_coalesced },
+	{ "tcp dial pipes", test_tcp_dial_pipes },
 	{ "tcp props v4", test_tcp_props_v4 },
 	NUTS_INSERT_TRAN_TESTS(tcp6),
 	{ "tcp props v6", test_tcp_props_v6 },
@@ -1079,6 +1079,7 @@ static nni_sp_dialer_ops tlstran_dialer_ops = {
 	.d_setopt  = tlstran_dialer_setopt,
 	.d_get_tls = tlstran_dialer_get_tls,
 	.d_set_tls = tlstran_dialer_set_tls,
+	.d_multi   = true,
 };
 
 static nni_sp_listener_ops tlstran_listener_ops = {
@@ -9,7 +9,6 @@
 
 #include "core/aio.h"
 #include "core/defs.h"
-#include "core/idhash.h"
 #include "core/message.h"
 #include "core/nng_impl.h"
 #include "core/options.h"
@@ -52,6 +51,17 @@ typedef enum udp_disc_reason {
 #define NNG_UDP_RXQUEUE_LEN 16
 #endif
 
+// Datagrams received or sent at once, where the platform can do so with
+// a single system call.  Each received datagram needs a buffer of the
+// maximum receive size.
+#ifndef NNG_UDP_RXBATCH
+#define NNG_UDP_RXBATCH 8
+#endif
+
+#ifndef NNG_UDP_TXBATCH
+#define NNG_UDP_TXBATCH 16
+#endif
+
 #ifndef NNG_UDP_RECVMAX
 #define NNG_UDP_RECVMAX 65000 // largest permitted by spec
 #endif
@@ -116,13 +126,30 @@ typedef enum {
 // UDP pipe timeout in msec (nng_duration)
 #define UDP_PIPE_TIMEOUT(p) ((p)->refresh * 5)
 
+// Every datagram received is matched to its pipe by the peer address, so
+// pipes are kept in an open addressed hash table with linear probing.
+// The slots hold a compact form of the address, so that a lookup only
+// touches the table itself, and two slots fit in a cache line.
+typedef struct udp_peer_key {
+	uint8_t  addr[16]; // IPv4 uses just the first four bytes
+	uint16_t port;
+	uint16_t family;
+	uint32_t scope;
+} udp_peer_key;
+
+typedef struct udp_peer {
+	udp_peer_key key;
+	udp_pipe    *pipe; // NULL if the slot is empty
+} udp_peer;
+
 struct udp_pipe {
 	udp_ep        *ep;
 	nni_pipe      *npipe;
 	nng_sockaddr   peer_addr;
+	udp_peer_key   peer_key;
 	uint16_t       peer;
 	uint16_t       proto;
-	uint64_t       id;
+	bool           mapped; // started, and not yet removed
 	uint32_t       self_id;
 	uint32_t       peer_id;
 	uint16_t       sndmax; // peer's max recv size
@@ -159,18 +186,21 @@ struct udp_ep {
 	bool          tx_busy; // true if tx pending
 	nni_listener *nlistener;
 	nni_dialer   *ndialer;
-	nni_msg      *rx_payload; // current receive message
-	nng_sockaddr  rx_sa;      // addr for last message
+	nni_msg      *rx_payload[NNG_UDP_RXBATCH]; // receive messages
+	nni_udp_dgram rx_dgram[NNG_UDP_RXBATCH];   // received datagrams
+	nni_udp_dgram tx_dgram[NNG_UDP_TXBATCH];   // datagrams being sent
+	unsigned      tx_count;   // number of datagrams being sent
 	nni_aio       tx_aio;     // aio for TX handling
 	nni_aio       rx_aio;     // aio for RX handling
-	nni_id_map    pipes;      // pipes (indexed by id)
+	udp_peer     *peers;      // pipes, by peer address
+	uint32_t      peer_cap;   // slots in peers (power of two)
+	uint32_t      peer_count; // pipes in peers
 	nni_sockaddr  self_sa;    // our address
 	nni_sockaddr  peer_sa;    // peer address, only for dialer;
 	nni_sockaddr  mesh_sa;    // mesh source address (ours)
 	nni_list      connaios;   // aios from accept waiting for a client peer
 	nni_list      connpipes;  // pipes waiting to be connected
 	nng_duration  refresh; // refresh interval for connections in seconds
-	udp_sp_msg   *rx_msg;  // contains the received message header
 	uint16_t      rcvmax;  // max payload, trimmed to uint16_t
 	uint16_t      copymax;
 	udp_txring    tx_ring;
@@ -194,8 +224,8 @@ static void udp_ep_start(udp_ep *);
 static void udp_resolv_cb(void *);
 static void udp_rx_cb(void *);
 
-static void udp_recv_data(
-    udp_ep *ep, udp_sp_msg *msg, size_t len, const nng_sockaddr *sa);
+static void udp_recv_data(udp_ep *ep, nni_msg **payloadp, udp_sp_msg *msg,
+    size_t len, const nng_sockaddr *sa);
 static void udp_send_disc_full(
     udp_ep *ep, const nng_sockaddr *sa, udp_disc_reason reason);
 static void udp_send_disc(udp_ep *ep, udp_pipe *p, udp_disc_reason reason);
@@ -214,6 +244,39 @@ udp_tran_fini(void)
 {
 }
 
+static void
+udp_peer_key_init(udp_peer_key *key, const nng_sockaddr *sa)
+{
+	memset(key, 0, sizeof(*key));
+	key->family = sa->s_family;
+	switch (sa->s_family) {
+	case NNG_AF_INET:
+		memcpy(key->addr, &sa->s_in.sa_addr, sizeof(sa->s_in.sa_addr));
+		key->port = sa->s_in.sa_port;
+		break;
+	case NNG_AF_INET6:
+		memcpy(key->addr, sa->s_in6.sa_addr, sizeof(key->addr));
+		key->port  = sa->s_in6.sa_port;
+		key->scope = sa->s_in6.sa_scope;
+		break;
+	default:
+		break;
+	}
+}
+
+static uint32_t
+udp_peer_hash(const udp_peer_key *key)
+{
+	uint64_t w[3];
+	uint64_t h;
+
+	memcpy(w, key, sizeof(w));
+	h = w[0] * 0x9e3779b97f4a7c15ull;
+	h = (h ^ w[1]) * 0xc2b2ae3d27d4eb4full;
+	h = (h ^ w[2]) * 0x165667b19e3779f9ull;
+	return ((uint32_t) (h >> 32));
+}
+
 static void
 udp_pipe_close(void *arg)
 {
@@ -265,7 +328,8 @@ udp_pipe_start(udp_pipe *p, udp_ep *ep, const nng_sockaddr *sa)
 	p->dialer    = ep->dialer;
 	p->refresh   = p->dialer ? NNG_UDP_CONNRETRY : ep->refresh;
 	p->rcvmax    = ep->rcvmax;
-	p->id        = nng_sockaddr_hash(sa);
+	p->mapped    = true;
+	udp_peer_key_init(&p->peer_key, sa);
 	p->expire = now + (p->dialer ? (5 * NNI_SECOND) : UDP_PIPE_TIMEOUT(p));
 
 	return (udp_add_pipe(ep, p));
@@ -289,24 +353,22 @@ udp_pipe_fini(void *arg)
 static udp_pipe *
 udp_find_pipe(udp_ep *ep, const nng_sockaddr *peer_addr)
 {
-	uint64_t  id = nng_sockaddr_hash(peer_addr);
-	udp_pipe *p;
-
-	// we'll keep incrementing id until we conclusively match
-	// or we get a NULL.  This is another level of rehashing, but
-	// it keeps us from having to look up.
-	for (;;) {
-		if ((p = nni_id_get(&ep->pipes, id)) == NULL) {
-			return (NULL);
-		}
-		if (nng_sockaddr_equal(&p->peer_addr, peer_addr)) {
-			return (p);
-		}
-		id++;
-		if (id == 0) {
-			id = 1;
+	udp_peer_key key;
+	uint32_t     mask;
+	uint32_t     i;
+
+	if (ep->peer_count == 0) {
+		return (NULL);
+	}
+	udp_peer_key_init(&key, peer_addr);
+	mask = ep->peer_cap - 1;
+	for (i = udp_peer_hash(&key) & mask; ep->peers[i].pipe != NULL;
+	    i = (i + 1) & mask) {
+		if (memcmp(&ep->peers[i].key, &key, sizeof(key)) == 0) {
+			return (ep->peers[i].pipe);
 		}
 	}
+	return (NULL);
 }
 
 static void
@@ -314,24 +376,39 @@ udp_remove_pipe(udp_pipe *p)
 {
 	// ep locked
 	udp_ep  *ep = p->ep;
-	uint64_t id = p->id;
-	if (id == 0) {
+	uint32_t mask;
+	uint32_t i;
+	uint32_t j;
+
+	if (!p->mapped) {
 		return;
 	}
-	p->id = 0;
-	for (;;) {
-		udp_pipe *srch;
-		if ((srch = nni_id_get(&ep->pipes, id)) == NULL) {
-			break;
-		}
-		if (srch == p) {
-			nni_id_remove(&ep->pipes, id);
-			break;
+	p->mapped = false;
+
+	// Find the slot, and then close the gap by shifting back any
+	// later entries in the run that would no longer be found.
+	mask = ep->peer_cap - 1;
+	for (i = udp_peer_hash(&p->peer_key) & mask;
+	    (ep->peers != NULL) && (ep->peers[i].pipe != NULL);
+	    i = (i + 1) & mask) {
+		if (ep->peers[i].pipe != p) {
+			continue;
 		}
-		id++;
-		if (id == 0) {
-			id = 1;
+		for (j = (i + 1) & mask; ep->peers[j].pipe != NULL;
+		    j = (j + 1) & mask) {
+			uint32_t home;
+
+			home = udp_peer_hash(&ep->peers[j].key) & mask;
+			// Leave it if its home is cyclically within (i, j].
+			if (((j - home) & mask) < ((j - i) & mask)) {
+				continue;
+			}
+			ep->peers[i] = ep->peers[j];
+			i            = j;
 		}
+		ep->peers[i].pipe = NULL;
+		ep->peer_count--;
+		break;
 	}
 	if (p->state < PIPE_CONN_DONE) {
 		nni_list_node_remove(&p->node);
@@ -342,15 +419,43 @@ udp_remove_pipe(udp_pipe *p)
 static nng_err
 udp_add_pipe(udp_ep *ep, udp_pipe *p)
 {
-	// Id must be part of the hash
-	uint64_t id = p->id;
-	while (nni_id_get(&ep->pipes, id) != NULL) {
-		id++;
-		if (id == 0) {
-			id = 1;
+	uint32_t mask;
+	uint32_t i;
+
+	// Keep the table at most half full, so that runs stay short.
+	if ((ep->peer_count + 1) * 2 > ep->peer_cap) {
+		uint32_t  cap = ep->peer_cap ? ep->peer_cap * 2 : 16;
+		udp_peer *peers;
+
+		if ((peers = nni_zalloc(cap * sizeof(*peers))) == NULL) {
+			return (NNG_ENOMEM);
+		}
+		for (uint32_t k = 0; k < ep->peer_cap; k++) {
+			if (ep->peers[k].pipe == NULL) {
+				continue;
+			}
+			i = udp_peer_hash(&ep->peers[k].key) & (cap - 1);
+			while (peers[i].pipe != NULL) {
+				i = (i + 1) & (cap - 1);
+			}
+			peers[i] = ep->peers[k];
+		}
+		if (ep->peers != NULL) {
+			nni_free(ep->peers, ep->peer_cap * sizeof(*peers));
 		}
+		ep->peers    = peers;
+		ep->peer_cap = cap;
 	}
-	return (nni_id_set(&ep->pipes, id, p));
+
+	mask = ep->peer_cap - 1;
+	i    = udp_peer_hash(&p->peer_key) & mask;
+	while (ep->peers[i].pipe != NULL) {
+		i = (i + 1) & mask;
+	}
+	ep->peers[i].key  = p->peer_key;
+	ep->peers[i].pipe = p;
+	ep->peer_count++;
+	return (NNG_OK);
 }
 
 static void
@@ -374,25 +479,28 @@ udp_pipe_schedule(udp_pipe *p)
 static void
 udp_start_rx(udp_ep *ep)
 {
-	nni_iov iov;
-
 	if (ep->closed) {
 		return;
 	}
 
-	// We use this trick to collect the message header so that we can
-	// do the entire message in a single iov, which avoids the need to
-	// scatter/gather (which can be problematic for platforms that cannot
-	// do scatter/gather due to missing recvmsg.)
-	(void) nni_msg_insert(ep->rx_payload, NULL, sizeof(udp_sp_msg));
-	iov.iov_buf = nni_msg_body(ep->rx_payload);
-	iov.iov_len = nni_msg_len(ep->rx_payload);
-	ep->rx_msg  = nni_msg_body(ep->rx_payload);
-	nni_msg_trim(ep->rx_payload, sizeof(udp_sp_msg));
+	for (int i = 0; i < NNG_UDP_RXBATCH; i++) {
+		nni_udp_dgram *dg  = &ep->rx_dgram[i];
+		nni_msg       *msg = ep->rx_payload[i];
+
+		// We use this trick to collect the message header so that
+		// we can do the entire message in a single iov, which avoids
+		// the need to scatter/gather (which can be problematic for
+		// platforms that cannot do scatter/gather due to missing
+		// recvmsg.)
+		(void) nni_msg_insert(msg, NULL, sizeof(udp_sp_msg));
+		dg->ud_iov[0].iov_buf = nni_msg_body(msg);
+		dg->ud_iov[0].iov_len = nni_msg_len(msg);
+		dg->ud_niov           = 1;
+		nni_msg_trim(msg, sizeof(udp_sp_msg));
+	}
 
-	nni_aio_set_input(&ep->rx_aio, 0, &ep->rx_sa);
-	nni_aio_set_iov(&ep->rx_aio, 1, &iov);
-	nng_udp_recv(ep->udp, &ep->rx_aio);
+	nni_plat_udp_recv_batch((nni_plat_udp *) ep->udp, ep->rx_dgram,
+	    NNG_UDP_RXBATCH, &ep->rx_aio);
 }
 
 static void
@@ -401,6 +509,7 @@ udp_start_tx(udp_ep *ep)
 	udp_txring *ring = &ep->tx_ring;
 	udp_txdesc *desc;
 	nng_msg    *msg;
+	uint16_t    idx;
 
 	if ((!ring->count) || (!ep->started) || ep->tx_busy || ep->stopped) {
 		return;
@@ -409,32 +518,44 @@ udp_start_tx(udp_ep *ep)
 
 	// NB: This does not advance the tail yet.
 	// The tail will be advanced when the operation is complete.
-	desc = &ring->descs[ring->tail];
-	nni_iov iov[3];
-	int     niov = 0;
-
-	NNI_ASSERT(desc->submitted);
-	iov[0].iov_buf = &desc->header;
-	iov[0].iov_len = sizeof(desc->header);
-	niov++;
-
-	if ((msg = desc->payload) != NULL) {
-		if (nni_msg_header_len(msg) > 0) {
-			iov[niov].iov_buf = nni_msg_header(msg);
-			iov[niov].iov_len = nni_msg_header_len(msg);
-			niov++;
+	// Everything queued (up to the batch size) goes out together.
+	idx          = ring->tail;
+	ep->tx_count = 0;
+	while ((ep->tx_count < ring->count) &&
+	    (ep->tx_count < NNG_UDP_TXBATCH)) {
+		nni_udp_dgram *dg   = &ep->tx_dgram[ep->tx_count];
+		nni_iov       *iov  = dg->ud_iov;
+		unsigned       niov = 0;
+
+		desc = &ring->descs[idx];
+		NNI_ASSERT(desc->submitted);
+		iov[0].iov_buf = &desc->header;
+		iov[0].iov_len = sizeof(desc->header);
+		niov++;
+
+		if ((msg = desc->payload) != NULL) {
+			if (nni_msg_header_len(msg) > 0) {
+				iov[niov].iov_buf = nni_msg_header(msg);
+				iov[niov].iov_len = nni_msg_header_len(msg);
+				niov++;
+			}
+			if (nni_msg_len(msg) > 0) {
+				iov[niov].iov_buf = nni_msg_body(msg);
+				iov[niov].iov_len = nni_msg_len(msg);
+				niov++;
+			}
 		}
-		if (nni_msg_len(msg) > 0) {
-			iov[niov].iov_buf = nni_msg_body(msg);
-			iov[niov].iov_len = nni_msg_len(msg);
-			niov++;
+		dg->ud_niov = niov;
+		dg->ud_addr = desc->sa;
+		ep->tx_count++;
+		if (++idx == ring->size) {
+			idx = 0;
 		}
 	}
-	nni_aio_set_input(&ep->tx_aio, 0, &desc->sa);
-	nni_aio_set_iov(&ep->tx_aio, niov, iov);
 	// it should *never* take this long, but allow for ARP resolution
 	nni_aio_set_timeout(&ep->tx_aio, NNI_SECOND * 10);
-	nng_udp_send(ep->udp, &ep->tx_aio);
+	nni_plat_udp_send_batch(
+	    (nni_plat_udp *) ep->udp, ep->tx_dgram, ep->tx_count, &ep->tx_aio);
 }
 
 static void
@@ -483,20 +604,24 @@ udp_finish_tx(udp_ep *ep)
 	udp_txring *ring = &ep->tx_ring;
 	udp_txdesc *desc;
 
-	NNI_ASSERT(ring->count > 0);
-	desc = &ring->descs[ring->tail];
-	NNI_ASSERT(desc->submitted);
-	if (desc->payload != NULL) {
-		nni_msg_free(desc->payload);
-		desc->payload = NULL;
-	}
-	desc->submitted = false;
-	ring->tail++;
-	ring->count--;
-	if (ring->tail == ring->size) {
-		ring->tail = 0;
+	// Whether sent or not, the whole batch is done.
+	for (unsigned i = 0; i < ep->tx_count; i++) {
+		NNI_ASSERT(ring->count > 0);
+		desc = &ring->descs[ring->tail];
+		NNI_ASSERT(desc->submitted);
+		if (desc->payload != NULL) {
+			nni_msg_free(desc->payload);
+			desc->payload = NULL;
+		}
+		desc->submitted = false;
+		ring->tail++;
+		ring->count--;
+		if (ring->tail == ring->size) {
+			ring->tail = 0;
+		}
 	}
-	ep->tx_busy = false;
+	ep->tx_count = 0;
+	ep->tx_busy  = false;
 
 	// possibly start another tx going
 	udp_start_tx(ep);
@@ -583,7 +708,8 @@ udp_recv_disc(udp_ep *ep, udp_sp_msg *disc, const nng_sockaddr *sa)
 // Receive data for the pipe.  Returns true if we used
 // the message, false otherwise.
 static void
-udp_recv_data(udp_ep *ep, udp_sp_msg *dreq, size_t len, const nng_sockaddr *sa)
+udp_recv_data(udp_ep *ep, nni_msg **payloadp, udp_sp_msg *dreq, size_t len,
+    const nng_sockaddr *sa)
 {
 	// NB: ep mtx is locked
 	udp_pipe *p;
@@ -612,8 +738,7 @@ udp_recv_data(udp_ep *ep, udp_sp_msg *dreq, size_t len, const nng_sockaddr *sa)
 	udp_pipe_schedule(p);
 
 	// trim the message down to its
-	nni_msg_chop(
-	    ep->rx_payload, nni_msg_len(ep->rx_payload) - dreq->us_length);
+	nni_msg_chop(*payloadp, nni_msg_len(*payloadp) - dreq->us_length);
 
 	// We have a choice to make.  Drop this message (easiest), or
 	// drop the oldest.  We drop the oldest because generally we
@@ -636,15 +761,15 @@ udp_recv_data(udp_ep *ep, udp_sp_msg *dreq, size_t len, const nng_sockaddr *sa)
 			return;
 		}
 		nni_msg_set_address(msg, sa);
-		memcpy(nni_msg_body(msg), nni_msg_body(ep->rx_payload), len);
+		memcpy(nni_msg_body(msg), nni_msg_body(*payloadp), len);
 		nni_lmq_put(&p->rx_mq, msg);
-		nni_msg_realloc(ep->rx_payload, ep->rcvmax);
+		nni_msg_realloc(*payloadp, ep->rcvmax);
 	} else {
 		nni_stat_inc(&ep->st_rcv_nocopy, 1);
 		// Message size larger than copy break, do zero copy
-		msg = ep->rx_payload;
-		if (nng_msg_alloc(&ep->rx_payload, ep->rcvmax) != 0) {
-			ep->rx_payload = msg; // make sure we put it back
+		msg = *payloadp;
+		if (nng_msg_alloc(payloadp, ep->rcvmax) != 0) {
+			*payloadp = msg; // make sure we put it back
 			if (p->npipe != NULL) {
 				nni_pipe_bump_error(p->npipe, NNG_ENOMEM);
 			}
@@ -790,6 +915,51 @@ udp_tx_cb(void *arg)
 	nni_mtx_unlock(&ep->mtx);
 }
 
+// udp_rx_dgram handles one datagram of a received batch.
+static void
+udp_rx_dgram(udp_ep *ep, size_t i)
+{
+	nni_udp_dgram *dg  = &ep->rx_dgram[i];
+	udp_sp_msg    *hdr = dg->ud_iov[0].iov_buf;
+	nng_sockaddr  *sa  = &dg->ud_addr;
+	size_t         n   = dg->ud_len;
+
+	if ((n < sizeof(*hdr)) || (hdr->us_ver != 1)) {
+		return;
+	}
+	n -= sizeof(*hdr);
+
+#ifndef NNG_LITTLE_ENDIAN
+	// Fix the endianness, so other routines don't have to.
+	// We only have to do this for systems that are not known
+	// (at compile time) to be little endian.
+	hdr->us_type      = NNI_GET16LE(&hdr->us_type);
+	hdr->us_params[0] = NNI_GET16LE(&hdr->us_params[0]);
+	hdr->us_params[1] = NNI_GET16LE(&hdr->us_params[1]);
+#endif
+
+	switch (hdr->us_op_code) {
+	case OPCODE_DATA:
+		udp_recv_data(ep, &ep->rx_payload[i], hdr, n, sa);
+		break;
+	case OPCODE_CREQ:
+		udp_recv_creq(ep, hdr, sa);
+		break;
+	case OPCODE_CACK:
+		udp_recv_cack(ep, hdr, sa);
+		break;
+	case OPCODE_DISC:
+		udp_recv_disc(ep, hdr, sa);
+		break;
+	case OPCODE_MESH: // TODO:
+	                  // udp_recv_mesh(ep, &hdr->mesh, sa);
+	                  // break;
+	default:
+		udp_send_disc_full(ep, sa, DISC_PROTO);
+		break;
+	}
+}
+
 // In the case of unicast UDP, we don't know
 // whether the message arrived from a connected peer as part of a
 // logical connection, or is a message related to connection management.
@@ -799,9 +969,6 @@ udp_rx_cb(void *arg)
 	udp_ep             *ep  = arg;
 	nni_aio            *aio = &ep->rx_aio;
 	int                 rv;
-	size_t              n;
-	udp_sp_msg         *hdr;
-	nng_sockaddr       *sa;
 	nni_aio_completions complq;
 
 	// for a received packet we are either receiving it for a
@@ -837,43 +1004,10 @@ udp_rx_cb(void *arg)
 		goto finish;
 	}
 
-	// Received message will be in the ep rx header.
-	hdr = ep->rx_msg;
-	sa  = &ep->rx_sa;
-	n   = nng_aio_count(aio);
-
-	if ((n >= sizeof(*hdr)) && (hdr->us_ver == 1)) {
-		n -= sizeof(*hdr);
-
-#ifndef NNG_LITTLE_ENDIAN
-		// Fix the endianness, so other routines don't have to.
-		// We only have to do this for systems that are not known
-		// (at compile time) to be little endian.
-		hdr->us_type      = NNI_GET16LE(&hdr->us_type);
-		hdr->us_params[0] = NNI_GET16LE(&hdr->us_params[0]);
-		hdr->us_params[1] = NNI_GET16LE(&hdr->us_params[1]);
-#endif
-
-		switch (hdr->us_op_code) {
-		case OPCODE_DATA:
-			udp_recv_data(ep, hdr, n, sa);
-			break;
-		case OPCODE_CREQ:
-			udp_recv_creq(ep, hdr, sa);
-			break;
-		case OPCODE_CACK:
-			udp_recv_cack(ep, hdr, sa);
-			break;
-		case OPCODE_DISC:
-			udp_recv_disc(ep, hdr, sa);
-			break;
-		case OPCODE_MESH: // TODO:
-		                  // udp_recv_mesh(ep, &hdr->mesh, sa);
-		                  // break;
-		default:
-			udp_send_disc_full(ep, sa, DISC_PROTO);
-			break;
-		}
+	// Received messages will be in the batch, each starting with
+	// the header.
+	for (size_t i = 0; i < nni_aio_count(aio); i++) {
+		udp_rx_dgram(ep, i);
 	}
 
 finish:
@@ -952,6 +1086,7 @@ udp_pipe_recv(void *arg, nni_aio *aio)
 {
 	udp_pipe *p  = arg;
 	udp_ep   *ep = p->ep;
+	nni_msg  *msg;
 
 	nni_aio_reset(aio);
 	nni_mtx_lock(&ep->mtx);
@@ -960,6 +1095,13 @@ udp_pipe_recv(void *arg, nni_aio *aio)
 		nni_aio_finish_error(aio, NNG_ECLOSED);
 		return;
 	}
+	// A batch can leave messages queued, so take one if we can.
+	if (nni_lmq_get(&p->rx_mq, &msg) == 0) {
+		nni_mtx_unlock(&ep->mtx);
+		nni_aio_set_msg(aio, msg);
+		nni_aio_finish(aio, 0, nni_msg_len(msg));
+		return;
+	}
 	if (!nni_aio_start(aio, udp_pipe_recv_cancel, p)) {
 		nni_mtx_unlock(&ep->mtx);
 		return;
@@ -1044,8 +1186,12 @@ udp_ep_fini(void *arg)
 		nni_msg_free(ep->tx_ring.descs[i].payload);
 		ep->tx_ring.descs[i].payload = NULL;
 	}
-	nni_msg_free(ep->rx_payload); // safe even if msg is null
-	nni_id_map_fini(&ep->pipes);
+	for (int i = 0; i < NNG_UDP_RXBATCH; i++) {
+		nni_msg_free(ep->rx_payload[i]); // safe even if msg is null
+	}
+	if (ep->peers != NULL) {
+		nni_free(ep->peers, ep->peer_cap * sizeof(udp_peer));
+	}
 	NNI_FREE_STRUCTS(ep->tx_ring.descs, ep->tx_ring.size);
 }
 
@@ -1055,8 +1201,6 @@ udp_ep_close(void *arg)
 	udp_ep   *ep = arg;
 	udp_pipe *p;
 	nni_aio  *aio;
-	uint32_t  cursor;
-	uint64_t  key;
 
 	nni_mtx_lock(&ep->mtx);
 	ep->closed = true;
@@ -1067,8 +1211,10 @@ udp_ep_close(void *arg)
 	nni_aio_close(&ep->timeaio);
 
 	// close all the underlying pipes, so the peer can see it.
-	while (nni_id_visit(&ep->pipes, &key, (void **) &p, &cursor)) {
-		nni_pipe_close(p->npipe);
+	for (uint32_t i = 0; i < ep->peer_cap; i++) {
+		if ((p = ep->peers[i].pipe) != NULL) {
+			nni_pipe_close(p->npipe);
+		}
 	}
 	while ((aio = nni_list_first(&ep->connaios)) != NULL) {
 		nni_aio_list_remove(aio);
@@ -1134,12 +1280,16 @@ udp_timer_cb(void *arg)
 		break;
 	}
 
-	uint32_t     cursor  = 0;
 	nni_time     now     = nni_clock();
 	nng_duration refresh = ep->refresh;
 
+	// Pipes are only removed from the table by the reaper, so it is
+	// stable while we walk it.
 	ep->next_wake = NNI_TIME_NEVER;
-	while (nni_id_visit(&ep->pipes, NULL, (void **) &p, &cursor)) {
+	for (uint32_t i = 0; i < ep->peer_cap; i++) {
+		if ((p = ep->peers[i].pipe) == NULL) {
+			continue;
+		}
 
 		if (now > p->expire) {
 			char     buf[128];
@@ -1193,7 +1343,6 @@ udp_ep_init(
 	int rv;
 
 	nni_mtx_init(&ep->mtx);
-	nni_id_map_init(&ep->pipes, 1, 0xFFFFFFFF, true);
 	NNI_LIST_INIT(&ep->connpipes, udp_pipe, node);
 	nni_aio_list_init(&ep->connaios);
 
@@ -1228,9 +1377,16 @@ udp_ep_init(
 	ep->refresh          = NNG_UDP_REFRESH; // one minute by default
 	ep->rcvmax           = NNG_UDP_RECVMAX;
 	ep->copymax          = NNG_UDP_COPYMAX;
-	if ((rv = nni_msg_alloc(&ep->rx_payload, ep->rcvmax) != 0)) {
-		NNI_FREE_STRUCTS(ep->tx_ring.descs, NNG_UDP_TXQUEUE_LEN);
-		return (rv);
+	for (int i = 0; i < NNG_UDP_RXBATCH; i++) {
+		rv = nni_msg_alloc(&ep->rx_payload[i], ep->rcvmax);
+		if (rv != 0) {
+			while (--i >= 0) {
+				nni_msg_free(ep->rx_payload[i]);
+			}
+			NNI_FREE_STRUCTS(
+			    ep->tx_ring.descs, NNG_UDP_TXQUEUE_LEN);
+			return (rv);
+		}
 	}
 
 	NNI_STAT_LOCK(rcv_max_info, "rcv_max", "maximum receive size",
@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 //
 // This software is supplied under the terms of the MIT License, a
 // copy of which should be located in the distribution where this
@@ -8,6 +8,9 @@
 //
 
 #include "nng/nng.h"
+
+#include "core/nng_impl.h"
+
 #include <nuts.h>
 #include <stdlib.h>
 
@@ -605,6 +608,294 @@ test_udp_stats(void)
 	NUTS_CLOSE(s1);
 }
 
+// Each simulated peer is a bare UDP socket, speaking just enough of the
+// wire protocol (an eight byte header) to pass for a REQ dialer.
+static void
+udp_peer_hdr(uint8_t *hdr, uint8_t op, uint16_t p0, uint16_t p1)
+{
+	hdr[0] = 1;    // version
+	hdr[1] = op;   // op code
+	hdr[2] = 0x30; // REQ, little endian
+	hdr[3] = 0;
+	hdr[4] = (uint8_t) p0;
+	hdr[5] = (uint8_t) (p0 >> 8);
+	hdr[6] = (uint8_t) p1;
+	hdr[7] = (uint8_t) (p1 >> 8);
+}
+
+static int
+udp_peer_io(nng_udp *u, nng_aio *aio, nng_sockaddr *sa, void *buf,
+    size_t len, bool send)
+{
+	nng_iov iov;
+
+	iov.iov_buf = buf;
+	iov.iov_len = len;
+	nng_aio_set_iov(aio, 1, &iov);
+	nng_aio_set_input(aio, 0, sa);
+	if (send) {
+		nng_udp_send(u, aio);
+	} else {
+		nng_udp_recv(u, aio);
+	}
+	nng_aio_wait(aio);
+	if (nng_aio_result(aio) != NNG_OK) {
+		return (-1);
+	}
+	return ((int) nng_aio_count(aio));
+}
+
+// udp_peer_req has peer i send a request over u, which the REP socket
+// answers, and checks that the reply comes back to the same peer.
+static void
+udp_peer_req(
+    nng_socket s0, nng_udp *u, nng_aio *aio, nng_sockaddr *sa, int i)
+{
+	nng_sockaddr from;
+	nng_msg     *m;
+	uint8_t      buf[64];
+	uint32_t     v;
+
+	udp_peer_hdr(buf, 0, 8, 0); // DATA
+	NNI_PUT32(buf + 8, 0x80000000u | (uint32_t) i);
+	NNI_PUT32(buf + 12, (uint32_t) i);
+	NUTS_ASSERT(udp_peer_io(u, aio, sa, buf, 16, true) == 16);
+
+	NUTS_PASS(nng_recvmsg(s0, &m, 0));
+	NUTS_ASSERT(nng_msg_len(m) == 4);
+	NNI_GET32((uint8_t *) nng_msg_body(m), v);
+	NUTS_ASSERT(v == (uint32_t) i);
+	NUTS_PASS(nng_sendmsg(s0, m, 0));
+
+	memset(buf, 0, sizeof(buf));
+	NUTS_ASSERT(udp_peer_io(u, aio, &from, buf, 64, false) == 16);
+	NUTS_ASSERT(buf[1] == 0); // DATA
+	NNI_GET32(buf + 8, v);
+	NUTS_ASSERT(v == (0x80000000u | (uint32_t) i));
+	NNI_GET32(buf + 12, v);
+	NUTS_ASSERT(v == (uint32_t) i);
+}
+
+static void
+udp_count_pipe(nng_pipe p, nng_pipe_ev ev, void *arg)
+{
+	NNI_ARG_UNUSED(p);
+	NNI_ARG_UNUSED(ev);
+	nni_atomic_inc(arg);
+}
+
+// This is a benchmark of a listener with a great many peers, each with
+// its own source address.  Every peer connects, and then a sample of them
+// send a request, and the reply must come back to the same peer.  Only
+// Linux answers on every address in 127.0.0.0/8, so it runs only there.
+#ifdef NNG_PLATFORM_LINUX
+static void
+udp_peer_addr(nng_sockaddr *sa, int i, uint16_t port)
+{
+	uint8_t a[4] = { 127, 1, (uint8_t) (i >> 8), (uint8_t) i };
+
+	sa->s_in.sa_family = NNG_AF_INET;
+	sa->s_in.sa_port   = port;
+	memcpy(&sa->s_in.sa_addr, a, sizeof(a));
+}
+
+void
+test_udp_many_peers(void)
+{
+#if defined(NNG_SANITIZER) || defined(NNG_COVERAGE)
+	const int npeers = 5000;
+#else
+	const int npeers = 50000;
+#endif
+	nng_socket     s0;
+	nng_listener   l;
+	nng_sockaddr   sa;
+	nng_sockaddr   from;
+	nng_aio       *aio;
+	nni_atomic_int count;
+	uint16_t      *ports;
+	uint8_t        buf[64];
+	nng_time       start;
+	nng_duration   connect;
+	nng_duration   xfer;
+	int            sample = 0;
+
+	NUTS_ENABLE_LOG(NNG_LOG_NOTICE);
+	nni_atomic_init(&count);
+	NUTS_ASSERT((ports = nng_alloc(npeers * sizeof(uint16_t))) != NULL);
+	NUTS_PASS(nng_aio_alloc(&aio, NULL, NULL));
+	nng_aio_set_timeout(aio, 1000);
+	NUTS_PASS(nng_rep0_open(&s0));
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_SENDTIMEO, 1000));
+	NUTS_PASS(nng_pipe_notify(
+	    s0, NNG_PIPE_EV_ADD_POST, udp_count_pipe, &count));
+	NUTS_PASS(nng_listener_create(&l, s0, "udp://127.0.0.1:0"));
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_listener_get_addr(l, NNG_OPT_LOCADDR, &sa));
+
+	// Waiting for each acknowledgement keeps the listener from
+	// dropping requests, and the peer sockets from piling up.
+	start = nng_clock();
+	for (int i = 0; i < npeers; i++) {
+		nng_udp     *u;
+		nng_sockaddr self;
+
+		udp_peer_addr(&self, i, 0);
+		NUTS_PASS(nng_udp_open(&u, &self));
+		NUTS_PASS(nng_udp_sockname(u, &self));
+		ports[i] = self.s_in.sa_port;
+		udp_peer_hdr(buf, 1, 1500, 60); // CREQ
+		NUTS_ASSERT(udp_peer_io(u, aio, &sa, buf, 8, true) == 8);
+		NUTS_ASSERT(udp_peer_io(u, aio, &from, buf, 64, false) == 8);
+		NUTS_ASSERT(buf[1] == 2); // CACK
+		nng_udp_close(u);
+	}
+	while (nni_atomic_get(&count) < npeers) {
+		NUTS_ASSERT(nng_clock() - start < 30000);
+		nng_msleep(10);
+	}
+	connect = nng_clock() - start;
+
+	start = nng_clock();
+	for (int i = 0; i < npeers; i += 97) {
+		nng_udp     *u;
+		nng_sockaddr self;
+
+		udp_peer_addr(&self, i, ports[i]);
+		NUTS_PASS(nng_udp_open(&u, &self));
+		udp_peer_req(s0, u, aio, &sa, i);
+		nng_udp_close(u);
+		sample++;
+	}
+	xfer = nng_clock() - start;
+
+	nng_log_notice("udp", "%d peers connected in %d ms (%d per second)",
+	    npeers, (int) connect,
+	    connect > 0 ? (int) ((int64_t) npeers * 1000 / connect) : 0);
+	nng_log_notice("udp", "%d sampled peers answered in %d ms", sample,
+	    (int) xfer);
+
+	NUTS_CLOSE(s0);
+	nng_aio_free(aio);
+	nng_free(ports, npeers * sizeof(uint16_t));
+}
+#endif // NNG_PLATFORM_LINUX
+
+struct udp_peer_pipes {
+	nni_atomic_int added;
+	nni_atomic_int removed;
+	nng_pipe       pipes[256];
+};
+
+static void
+udp_note_pipe(nng_pipe p, nng_pipe_ev ev, void *arg)
+{
+	struct udp_peer_pipes *pp = arg;
+
+	if (ev == NNG_PIPE_EV_ADD_POST) {
+		pp->pipes[nni_atomic_inc_nv(&pp->added) - 1] = p;
+	} else {
+		nni_atomic_inc(&pp->removed);
+	}
+}
+
+// This closes every third of many peers, which with a table at most half
+// full takes entries out of the middle of probe runs, and then checks
+// that every remaining peer can still be found.  The peers all use
+// 127.0.0.1, and keep their sockets open so that each port is distinct.
+void
+test_udp_remove_peers(void)
+{
+	const int              npeers = 256;
+	nng_socket             s0;
+	nng_listener           l;
+	nng_sockaddr           sa;
+	nng_sockaddr           from;
+	nng_aio               *aio;
+	nng_udp               *peers[256];
+	uint16_t               ports[256];
+	uint8_t                buf[64];
+	int                    closed = 0;
+	nng_time               start;
+	struct udp_peer_pipes *pp;
+
+	NUTS_ASSERT((pp = nng_alloc(sizeof(*pp))) != NULL);
+	nni_atomic_init(&pp->added);
+	nni_atomic_init(&pp->removed);
+	NUTS_PASS(nng_aio_alloc(&aio, NULL, NULL));
+	nng_aio_set_timeout(aio, 1000);
+	NUTS_PASS(nng_rep0_open(&s0));
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_SENDTIMEO, 1000));
+	NUTS_PASS(
+	    nng_pipe_notify(s0, NNG_PIPE_EV_ADD_POST, udp_note_pipe, pp));
+	NUTS_PASS(
+	    nng_pipe_notify(s0, NNG_PIPE_EV_REM_POST, udp_note_pipe, pp));
+	NUTS_PASS(nng_listener_create(&l, s0, "udp://127.0.0.1:0"));
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_listener_get_addr(l, NNG_OPT_LOCADDR, &sa));
+
+	for (int i = 0; i < npeers; i++) {
+		nng_sockaddr self;
+
+		self.s_in.sa_family = NNG_AF_INET;
+		self.s_in.sa_port   = 0;
+		NNI_PUT32((uint8_t *) &self.s_in.sa_addr, 0x7f000001);
+		NUTS_PASS(nng_udp_open(&peers[i], &self));
+		NUTS_PASS(nng_udp_sockname(peers[i], &self));
+		ports[i] = self.s_in.sa_port;
+		udp_peer_hdr(buf, 1, 1500, 60); // CREQ
+		NUTS_ASSERT(
+		    udp_peer_io(peers[i], aio, &sa, buf, 8, true) == 8);
+		NUTS_ASSERT(
+		    udp_peer_io(peers[i], aio, &from, buf, 64, false) == 8);
+		NUTS_ASSERT(buf[1] == 2); // CACK
+	}
+	start = nng_clock();
+	while (nni_atomic_get(&pp->added) < npeers) {
+		NUTS_ASSERT(nng_clock() - start < 5000);
+		nng_msleep(10);
+	}
+
+	// Close the pipes of every third peer, found by its port.
+	for (int k = 0; k < npeers; k++) {
+		nng_sockaddr ra;
+		int          i;
+
+		NUTS_PASS(
+		    nng_pipe_get_addr(pp->pipes[k], NNG_OPT_REMADDR, &ra));
+		for (i = 0; i < npeers; i++) {
+			if (ports[i] == ra.s_in.sa_port) {
+				break;
+			}
+		}
+		NUTS_ASSERT(i < npeers);
+		if ((i % 3) == 1) {
+			NUTS_PASS(nng_pipe_close(pp->pipes[k]));
+			closed++;
+		}
+	}
+	start = nng_clock();
+	while (nni_atomic_get(&pp->removed) < closed) {
+		NUTS_ASSERT(nng_clock() - start < 5000);
+		nng_msleep(10);
+	}
+
+	for (int i = 0; i < npeers; i++) {
+		if ((i % 3) != 1) {
+			udp_peer_req(s0, peers[i], aio, &sa, i);
+		}
+	}
+
+	NUTS_CLOSE(s0);
+	for (int i = 0; i < npeers; i++) {
+		nng_udp_close(peers[i]);
+	}
+	nng_aio_free(aio);
+	nng_free(pp, sizeof(*pp));
+}
+
 NUTS_TESTS = {
 
 	{ "udp wild card connect fail", test_udp_wild_card_connect_fail },
@@ -621,5 +912,9 @@ NUTS_TESTS = {
 	{ "udp pipe", test_udp_pipe },
 	{ "udp reconnect dialer", test_udp_reconnect_dialer },
 	{ "udp stats", test_udp_stats },
+#ifdef NNG_PLATFORM_LINUX
+	{ "udp many peers", test_udp_many_peers },
+#endif
+	{ "udp remove peers", test_udp_remove_peers },
 	{ NULL, NULL },
 };
@@ -1,5 +1,5 @@
 //
-// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Cody Piersall <cody.piersall@gmail.com>
 //
 // This software is supplied under the terms of the MIT License, a
@@ -183,6 +183,60 @@ test_ws_recv_max(void)
 	NUTS_CLOSE(s1);
 }
 
+// Large messages sent in many small frames are reassembled intact, and the
+// receive limit applies to the message as a whole.
+void
+test_ws_fragmented_msg(void)
+{
+	nng_socket   s0;
+	nng_socket   s1;
+	nng_listener l;
+	nng_dialer   d;
+	nng_msg     *msg;
+	char        *addr;
+	size_t       sz = 1000000;
+
+	NUTS_ADDR(addr, "ws");
+	NUTS_OPEN(s0);
+	NUTS_OPEN(s1);
+	NUTS_PASS(nng_socket_set_ms(s0, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_socket_set_ms(s1, NNG_OPT_SENDTIMEO, 1000));
+	NUTS_PASS(nng_listener_create(&l, s0, addr));
+	// Leave room for the protocol header.
+	NUTS_PASS(nng_listener_set_size(l, NNG_OPT_RECVMAXSZ, sz + 64));
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_dialer_create(&d, s1, addr));
+	NUTS_PASS(nng_dialer_set_size(d, NNG_OPT_WS_SENDMAXFRAME, 1000));
+	NUTS_PASS(nng_dialer_start(d, 0));
+
+	for (size_t len = 1; len <= sz; len *= 10) {
+		uint8_t *body;
+		NUTS_PASS(nng_msg_alloc(&msg, len));
+		body = nng_msg_body(msg);
+		for (size_t i = 0; i < len; i++) {
+			body[i] = (uint8_t) (i % 251);
+		}
+		NUTS_PASS(nng_sendmsg(s1, msg, 0));
+		NUTS_PASS(nng_recvmsg(s0, &msg, 0));
+		NUTS_TRUE(nng_msg_len(msg) == len);
+		body = nng_msg_body(msg);
+		for (size_t i = 0; i < len; i++) {
+			if (body[i] != (uint8_t) (i % 251)) {
+				NUTS_TRUE(body[i] == (uint8_t) (i % 251));
+				break;
+			}
+		}
+		nng_msg_free(msg);
+	}
+
+	// One frame over the limit fails the whole message.
+	NUTS_PASS(nng_msg_alloc(&msg, sz + 65));
+	NUTS_PASS(nng_sendmsg(s1, msg, 0));
+	NUTS_FAIL(nng_recvmsg(s0, &msg, 0), NNG_ETIMEDOUT);
+	NUTS_CLOSE(s0);
+	NUTS_CLOSE(s1);
+}
+
 void
 test_ws_no_tls(void)
 {
@@ -248,6 +302,7 @@ TEST_LIST = {
 	{ "ws wild card host", test_wild_card_host },
 	{ "ws empty host", test_empty_host },
 	{ "ws recv max", test_ws_recv_max },
+	{ "ws fragmented msg", test_ws_fragmented_msg },
 	{ "ws no tls", test_ws_no_tls },
 	NUTS_INSERT_TRAN_TESTS(ws),
 	{ "ws msg props", test_ws_props_v4 },
@@ -20,6 +20,7 @@
 #include "base64.h"
 #include "sha1.h"
 #include "websocket.h"
+#include "wsmask.h"
 
 // This should be removed or handled differently in the future.
 typedef int (*nni_ws_listen_hook)(void *, nng_http *);
@@ -64,6 +65,8 @@ struct nni_ws {
 	nni_list         rxq;
 	ws_frame        *txframe;
 	ws_frame        *rxframe;
+	nni_msg         *rxmsg;   // message being received (message mode)
+	nni_msg         *rxready; // complete message, waiting for recv
 	nni_aio          txaio; // physical aios
 	nni_aio          rxaio;
 	nni_aio          closeaio; // used for lingering/draining close
@@ -311,9 +314,7 @@ ws_mask_frame(ws_frame *frame)
 	}
 	r = nni_random();
 	NNI_PUT32(frame->mask, r);
-	for (size_t i = 0; i < frame->len; i++) {
-		frame->buf[i] ^= frame->mask[i % 4];
-	}
+	nni_ws_mask(frame->buf, frame->len, frame->mask, 0);
 	memcpy(frame->head + frame->hlen, frame->mask, 4);
 	frame->hlen += 4;
 	frame->head[1] |= 0x80; // set masked bit
@@ -327,9 +328,7 @@ ws_unmask_frame(ws_frame *frame)
 	if (!frame->masked) {
 		return;
 	}
-	for (size_t i = 0; i < frame->len; i++) {
-		frame->buf[i] ^= frame->mask[i % 4];
-	}
+	nni_ws_mask(frame->buf, frame->len, frame->mask, 0);
 	frame->hlen -= 4;
 	frame->head[1] &= 0x7f; // clear masked bit
 	frame->masked = false;
@@ -744,7 +743,9 @@ ws_start_read(nni_ws *ws)
 
 	// If nobody is waiting for recv, and we already have a data
 	// frame, stop reading.  This keeps us from buffering infinitely.
-	if (nni_list_empty(&ws->recvq) && !nni_list_empty(&ws->rxq)) {
+	if (nni_list_empty(&ws->recvq) &&
+	    ((!nni_list_empty(&ws->rxq)) || (ws->rxmsg != NULL) ||
+	        (ws->rxready != NULL))) {
 		return;
 	}
 
@@ -834,43 +835,20 @@ ws_read_finish_str(nni_ws *ws)
 static void
 ws_read_finish_msg(nni_ws *ws)
 {
-	nni_aio  *aio;
-	size_t    len;
-	ws_frame *frame;
-	nni_msg  *msg;
-	int       rv;
-	uint8_t  *body;
+	nni_aio *aio;
+	nni_msg *msg;
 
-	// If we have no data, no waiter, or have not received the complete
-	// message yet, then there is nothing to do.
-	if (ws->inmsg || nni_list_empty(&ws->rxq) ||
+	// If we have not received the complete message yet, or have no
+	// waiter, then there is nothing to do.  The frames were read
+	// directly into the message, so there is nothing to assemble.
+	if ((ws->rxready == NULL) ||
 	    ((aio = nni_list_first(&ws->recvq)) == NULL)) {
 		return;
 	}
 
-	// At this point, we have both a complete message in the queue (and
-	// there should not be any frames other than the for the message),
-	// and a waiting reader.
-	len = 0;
-	NNI_LIST_FOREACH (&ws->rxq, frame) {
-		len += frame->len;
-	}
-
+	msg         = ws->rxready;
+	ws->rxready = NULL;
 	nni_aio_list_remove(aio);
-
-	if ((rv = nni_msg_alloc(&msg, len)) != 0) {
-		nni_aio_finish_error(aio, rv);
-		ws_close_error(ws, WS_CLOSE_INTERNAL);
-		return;
-	}
-	body = nni_msg_body(msg);
-	while ((frame = nni_list_first(&ws->rxq)) != NULL) {
-		nni_list_remove(&ws->rxq, frame);
-		memcpy(body, frame->buf, frame->len);
-		body += frame->len;
-		ws_frame_fini(frame);
-	}
-
 	nni_aio_set_msg(aio, msg);
 	nni_aio_bump_count(aio, nni_msg_len(msg));
 	nni_aio_finish(aio, 0, nni_msg_len(msg));
@@ -886,6 +864,65 @@ ws_read_finish(nni_ws *ws)
 	}
 }
 
+// ws_read_msg_space extends the message being received to hold the payload
+// of a data frame, and returns where the payload should be read.  When a
+// message is fragmented, its capacity grows geometrically so that the
+// occasional reallocation copies less than the message as a whole.
+static uint8_t *
+ws_read_msg_space(nni_ws *ws, ws_frame *frame)
+{
+	size_t len;
+	size_t cap;
+
+	if ((ws->rxmsg == NULL) && (nni_msg_alloc(&ws->rxmsg, 0) != 0)) {
+		return (NULL);
+	}
+	len = nni_msg_len(ws->rxmsg);
+	cap = len + frame->len;
+	if (cap > nni_msg_capacity(ws->rxmsg)) {
+		if ((len > 0) || (!frame->final)) {
+			if (cap < 2 * nni_msg_capacity(ws->rxmsg)) {
+				cap = 2 * nni_msg_capacity(ws->rxmsg);
+			}
+			if ((ws->recvmax > 0) && (cap > ws->recvmax)) {
+				cap = len + frame->len;
+				if (cap < ws->recvmax) {
+					cap = ws->recvmax;
+				}
+			}
+		}
+		if (nni_msg_reserve(ws->rxmsg, cap) != 0) {
+			return (NULL);
+		}
+	}
+	if (nni_msg_realloc(ws->rxmsg, len + frame->len) != 0) {
+		return (NULL);
+	}
+	return (((uint8_t *) nni_msg_body(ws->rxmsg)) + len);
+}
+
+// ws_read_data_frame takes a data frame that has been read.  In stream mode
+// the frame is queued.  In message mode, the payload is already in place
+// in the message, and the message is ready once the final frame arrives.
+static void
+ws_read_data_frame(nni_ws *ws, ws_frame *frame)
+{
+	ws->rxframe = NULL;
+	if (ws->isstream) {
+		nni_list_append(&ws->rxq, frame);
+		return;
+	}
+	ws_frame_fini(frame);
+	if ((ws->rxmsg == NULL) && (nni_msg_alloc(&ws->rxmsg, 0) != 0)) {
+		ws_close(ws, WS_CLOSE_INTERNAL);
+		return;
+	}
+	if (!ws->inmsg) {
+		ws->rxready = ws->rxmsg;
+		ws->rxmsg   = NULL;
+	}
+}
+
 static void
 ws_read_frame_cb(nni_ws *ws, ws_frame *frame)
 {
@@ -898,8 +935,7 @@ ws_read_frame_cb(nni_ws *ws, ws_frame *frame)
 		if (frame->final) {
 			ws->inmsg = false;
 		}
-		ws->rxframe = NULL;
-		nni_list_append(&ws->rxq, frame);
+		ws_read_data_frame(ws, frame);
 		break;
 	case WS_TEXT:
 		if (!ws->recv_text) {
@@ -915,8 +951,7 @@ ws_read_frame_cb(nni_ws *ws, ws_frame *frame)
 		if (!frame->final) {
 			ws->inmsg = true;
 		}
-		ws->rxframe = NULL;
-		nni_list_append(&ws->rxq, frame);
+		ws_read_data_frame(ws, frame);
 		break;
 
 	case WS_PING:
@@ -1043,10 +1078,9 @@ ws_read_cb(void *arg)
 		// length of the message has not exceeded our recvmax.
 		// (Protect against an infinite stream of small messages!)
 		if ((!ws->isstream) && (ws->recvmax > 0)) {
-			size_t    totlen = frame->len;
-			ws_frame *fr2;
-			NNI_LIST_FOREACH (&ws->rxq, fr2) {
-				totlen += fr2->len;
+			size_t totlen = frame->len;
+			if (ws->rxmsg != NULL) {
+				totlen += nni_msg_len(ws->rxmsg);
 			}
 			if (totlen > ws->recvmax) {
 				ws_close(ws, WS_CLOSE_TOO_BIG);
@@ -1075,8 +1109,21 @@ ws_read_cb(void *arg)
 
 			nni_iov iov;
 
-			// Short frames can avoid an alloc
-			if (frame->len < 126) {
+			// In message mode, data frames are read directly into
+			// the message, and unmasked in place.
+			if ((!ws->isstream) &&
+			    ((frame->op == WS_CONT) ||
+			        (frame->op == WS_TEXT) ||
+			        (frame->op == WS_BINARY))) {
+				frame->asize = 0;
+				frame->buf   = ws_read_msg_space(ws, frame);
+				if (frame->buf == NULL) {
+					ws_close(ws, WS_CLOSE_INTERNAL);
+					nni_mtx_unlock(&ws->mtx);
+					return;
+				}
+			} else if (frame->len < 126) {
+				// Short frames can avoid an alloc
 				frame->buf   = frame->sdata;
 				frame->asize = 0;
 			} else {
@@ -1177,6 +1224,12 @@ ws_fini(void *arg)
 	if (ws->rxframe != NULL) {
 		ws_frame_fini(ws->rxframe);
 	}
+	if (ws->rxmsg != NULL) {
+		nni_msg_free(ws->rxmsg);
+	}
+	if (ws->rxready != NULL) {
+		nni_msg_free(ws->rxready);
+	}
 	if (ws->txframe != NULL) {
 		ws_frame_fini(ws->txframe);
 	}
@@ -0,0 +1,226 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include <string.h>
+
+#include "core/nng_impl.h"
+
+#include "wsmask.h"
+
+// WebSocket masking XORs the payload with a repeating four byte key.
+// Byte at a time this is slow for large frames, so we mask a byte at a
+// time only until the buffer is aligned, then as many wide vectors as the
+// processor supports, and then finish the tail.  Because the vector
+// widths are all multiples of four, the key only needs to be rotated
+// once, for the unaligned head.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WS_MASK_SSE2
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define WS_MASK_AVX2
+#endif
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WS_MASK_NEON
+#endif
+
+// Each of these masks as much of an eight byte aligned buffer as it can
+// in wide operations, and returns the number of bytes it has done.
+typedef size_t (*ws_mask_fn)(uint8_t *, size_t, const uint8_t *);
+
+static size_t
+ws_mask_words(uint8_t *buf, size_t len, const uint8_t *key)
+{
+	uint64_t k;
+	uint64_t w;
+	size_t   n;
+
+	memcpy(&k, key, sizeof(k));
+	for (n = 0; n + sizeof(w) <= len; n += sizeof(w)) {
+		memcpy(&w, buf + n, sizeof(w));
+		w ^= k;
+		memcpy(buf + n, &w, sizeof(w));
+	}
+	return (n);
+}
+
+#ifdef WS_MASK_SSE2
+static size_t
+ws_mask_sse2(uint8_t *buf, size_t len, const uint8_t *key)
+{
+	__m128i k = _mm_loadu_si128((const __m128i *) (const void *) key);
+	size_t  n;
+
+	for (n = 0; n + 64 <= len; n += 64) {
+		__m128i *p = (__m128i *) (void *) (buf + n);
+		__m128i  a = _mm_loadu_si128(p);
+		__m128i  b = _mm_loadu_si128(p + 1);
+		__m128i  c = _mm_loadu_si128(p + 2);
+		__m128i  d = _mm_loadu_si128(p + 3);
+		_mm_storeu_si128(p, _mm_xor_si128(a, k));
+		_mm_storeu_si128(p + 1, _mm_xor_si128(b, k));
+		_mm_storeu_si128(p + 2, _mm_xor_si128(c, k));
+		_mm_storeu_si128(p + 3, _mm_xor_si128(d, k));
+	}
+	for (; n + 16 <= len; n += 16) {
+		__m128i *p = (__m128i *) (void *) (buf + n);
+		_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k));
+	}
+	return (n);
+}
+#endif
+
+#ifdef WS_MASK_AVX2
+__attribute__((target("avx2"))) static size_t
+ws_mask_avx2(uint8_t *buf, size_t len, const uint8_t *key)
+{
+	__m256i k = _mm256_loadu_si256((const __m256i *) (const void *) key);
+	size_t  n;
+
+	for (n = 0; n + 128 <= len; n += 128) {
+		__m256i *p = (__m256i *) (void *) (buf + n);
+		__m256i  a = _mm256_loadu_si256(p);
+		__m256i  b = _mm256_loadu_si256(p + 1);
+		__m256i  c = _mm256_loadu_si256(p + 2);
+		__m256i  d = _mm256_loadu_si256(p + 3);
+		_mm256_storeu_si256(p, _mm256_xor_si256(a, k));
+		_mm256_storeu_si256(p + 1, _mm256_xor_si256(b, k));
+		_mm256_storeu_si256(p + 2, _mm256_xor_si256(c, k));
+		_mm256_storeu_si256(p + 3, _mm256_xor_si256(d, k));
+	}
+	for (; n + 32 <= len; n += 32) {
+		__m256i *p = (__m256i *) (void *) (buf + n);
+		_mm256_storeu_si256(
+		    p, _mm256_xor_si256(_mm256_loadu_si256(p), k));
+	}
+	return (n);
+}
+#endif
+
+#ifdef WS_MASK_NEON
+static size_t
+ws_mask_neon(uint8_t *buf, size_t len, const uint8_t *key)
+{
+	uint8x16_t k = vld1q_u8(key);
+	size_t     n;
+
+	for (n = 0; n + 64 <= len; n += 64) {
+		uint8x16_t a = vld1q_u8(buf + n);
+		uint8x16_t b = vld1q_u8(buf + n + 16);
+		uint8x16_t c = vld1q_u8(buf + n + 32);
+		uint8x16_t d = vld1q_u8(buf + n + 48);
+		vst1q_u8(buf + n, veorq_u8(a, k));
+		vst1q_u8(buf + n + 16, veorq_u8(b, k));
+		vst1q_u8(buf + n + 32, veorq_u8(c, k));
+		vst1q_u8(buf + n + 48, veorq_u8(d, k));
+	}
+	for (; n + 16 <= len; n += 16) {
+		vst1q_u8(buf + n, veorq_u8(vld1q_u8(buf + n), k));
+	}
+	return (n);
+}
+#endif
+
+typedef struct {
+	const char *name;
+	ws_mask_fn  fn;
+} ws_mask_impl;
+
+// These are in order of preference, with the best last.  AVX2 is the
+// only one that needs to be checked for at run time.
+static const ws_mask_impl ws_mask_impls[] = {
+	{ "portable", ws_mask_words },
+#ifdef WS_MASK_SSE2
+	{ "sse2", ws_mask_sse2 },
+#endif
+#ifdef WS_MASK_NEON
+	{ "neon", ws_mask_neon },
+#endif
+#ifdef WS_MASK_AVX2
+	{ "avx2", ws_mask_avx2 },
+#endif
+};
+
+// This holds the index of the chosen implementation plus one, so that
+// zero means that we have not looked yet.  Callers that race to look
+// first all store the same answer.
+static nni_atomic_int ws_mask_chosen;
+
+// ws_mask_select picks the widest implementation the processor supports,
+// checking only the first time.
+static const ws_mask_impl *
+ws_mask_select(void)
+{
+	int idx;
+
+	if ((idx = nni_atomic_get(&ws_mask_chosen)) == 0) {
+		idx = (int) NNI_NUM_ELEMENTS(ws_mask_impls);
+#ifdef WS_MASK_AVX2
+		if (!__builtin_cpu_supports("avx2")) {
+			idx--;
+		}
+#endif
+		nni_atomic_set(&ws_mask_chosen, idx);
+	}
+	return (&ws_mask_impls[idx - 1]);
+}
+
+const char *
+nni_ws_mask_impl(void)
+{
+	return (ws_mask_select()->name);
+}
+
+// ws_mask_key fills the key with the mask rotated to start at the given
+// payload offset, repeated to the widest vector width.
+static void
+ws_mask_key(uint8_t key[32], const uint8_t mask[4], size_t offset)
+{
+	for (size_t n = 0; n < 4; n++) {
+		key[n] = mask[(offset + n) % 4];
+	}
+	memcpy(key + 4, key, 4);
+	memcpy(key + 8, key, 8);
+	memcpy(key + 16, key, 16);
+}
+
+void
+nni_ws_mask(uint8_t *buf, size_t len, const uint8_t mask[4], size_t offset)
+{
+	uint8_t key[32];
+	size_t  head;
+	size_t  n;
+
+	// Short buffers are not worth aligning or vectorizing.
+	if (len < 64) {
+		ws_mask_key(key, mask, offset);
+		n = ws_mask_words(buf, len, key);
+		for (; n < len; n++) {
+			buf[n] ^= key[n % 4];
+		}
+		return;
+	}
+
+	// Mask the head a byte at a time, until the buffer is aligned.
+	head = (size_t) (-(uintptr_t) buf) & (sizeof(uint64_t) - 1);
+	for (n = 0; n < head; n++) {
+		buf[n] ^= mask[(offset + n) % 4];
+	}
+	buf += head;
+	len -= head;
+	ws_mask_key(key, mask, offset + head);
+
+	n = ws_mask_select()->fn(buf, len, key);
+	n += ws_mask_words(buf + n, len - n, key);
+	for (; n < len; n++) {
+		buf[n] ^= key[n % 4];
+	}
+}
@@ -0,0 +1,25 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#ifndef NNG_SUPPLEMENTAL_WEBSOCKET_WSMASK_H
+#define NNG_SUPPLEMENTAL_WEBSOCKET_WSMASK_H
+
+#include "core/defs.h"
+
+// nni_ws_mask applies (or removes, as the operation is its own inverse)
+// the WebSocket masking key to a buffer in place.  The offset is the
+// position of the first byte of the buffer within the frame payload, so
+// that a payload may be masked in pieces.
+extern void nni_ws_mask(uint8_t *, size_t, const uint8_t[4], size_t);
+
+// nni_ws_mask_impl returns the name of the implementation that
+// nni_ws_mask uses on this machine, for diagnostics.
+extern const char *nni_ws_mask_impl(void);
+
+#endif // NNG_SUPPLEMENTAL_WEBSOCKET_WSMASK_H
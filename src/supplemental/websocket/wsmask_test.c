@@ -0,0 +1,95 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include <string.h>
+
+#include <nng/nng.h>
+
+#include "wsmask.h"
+
+#include <nuts.h>
+
+static const uint8_t test_key[4] = { 0x12, 0x9a, 0xc3, 0x7e };
+
+static void
+mask_bytes(uint8_t *buf, size_t len, const uint8_t *key, size_t offset)
+{
+	for (size_t i = 0; i < len; i++) {
+		buf[i] ^= key[(offset + i) % 4];
+	}
+}
+
+static void
+fill(uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = (uint8_t) (i * 7 + 3);
+	}
+}
+
+void
+test_ws_mask_sizes(void)
+{
+	uint8_t buf[600];
+	uint8_t ref[600];
+
+	// Every length up to a few vectors, at every alignment, so that
+	// the head, vector, word, and tail paths all get exercised.
+	for (size_t align = 0; align < 8; align++) {
+		for (size_t len = 0; len + align <= 520; len++) {
+			fill(buf, sizeof(buf));
+			fill(ref, sizeof(ref));
+			nni_ws_mask(buf + align, len, test_key, 0);
+			mask_bytes(ref + align, len, test_key, 0);
+			NUTS_ASSERT(memcmp(buf, ref, sizeof(buf)) == 0);
+		}
+	}
+}
+
+void
+test_ws_mask_offset(void)
+{
+	uint8_t buf[300];
+	uint8_t ref[300];
+
+	// Masking in pieces gives the same result as all at once.
+	for (size_t split = 0; split < 64; split++) {
+		fill(buf, sizeof(buf));
+		fill(ref, sizeof(ref));
+		nni_ws_mask(buf, split, test_key, 0);
+		nni_ws_mask(buf + split, sizeof(buf) - split, test_key, split);
+		mask_bytes(ref, sizeof(ref), test_key, 0);
+		NUTS_ASSERT(memcmp(buf, ref, sizeof(buf)) == 0);
+	}
+}
+
+void
+test_ws_mask_inverse(void)
+{
+	size_t   len = 65536 + 13;
+	uint8_t *buf = nng_alloc(len);
+	uint8_t *ref = nng_alloc(len);
+
+	NUTS_ASSERT(buf != NULL && ref != NULL);
+	fill(buf, len);
+	fill(ref, len);
+	nni_ws_mask(buf + 1, len - 1, test_key, 0);
+	NUTS_ASSERT(memcmp(buf, ref, len) != 0);
+	nni_ws_mask(buf + 1, len - 1, test_key, 0);
+	NUTS_ASSERT(memcmp(buf, ref, len) == 0);
+	nng_free(buf, len);
+	nng_free(ref, len);
+}
+
+NUTS_TESTS = {
+	{ "ws mask sizes", test_ws_mask_sizes },
+	{ "ws mask offset", test_ws_mask_offset },
+	{ "ws mask inverse", test_ws_mask_inverse },
+	{ NULL, NULL },
+};
@@ -0,0 +1,636 @@
+//
+// Copyright 2025 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+// core_perf measures internal facilities of the library directly, rather
+// than through sockets.  It is built against the test library, as that
+// is the only one that exposes the internals.  As with perf, the test to
+// run is chosen by the program name, or by -m <mode>.
+//
+// Modes are:
+//
+// - udp_batch_thr - small datagrams over loopback, singly and in batches
+// - stats_perf    - counter contention, atomic versus sharded by CPU
+// - trie_perf     - subscription trie match cost by number of keys
+// - taskq_perf    - task dispatch rate by number of worker threads
+// - aio_perf      - timer add and cancel cost with many aios outstanding
+// - wsmask_perf   - WebSocket masking throughput by frame size
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/nng_impl.h"
+
+#ifdef NNG_SUPP_WEBSOCKET
+#include "supplemental/websocket/wsmask.h"
+#endif
+
+static void
+die(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fprintf(stderr, "\n");
+	exit(2);
+}
+
+static int
+parse_int(const char *arg, const char *what)
+{
+	long  val;
+	char *eptr;
+
+	val = strtol(arg, &eptr, 10);
+	// Must be a positive number less than around a billion.
+	if ((val < 0) || (val > 1000000000) || (*eptr != 0) || (eptr == arg)) {
+		die("Invalid %s", what);
+	}
+	return ((int) val);
+}
+
+static bool
+matches(const char *arg, const char *name)
+{
+	const char *ptr = arg;
+	const char *x;
+
+	while (((x = strchr(ptr, '/')) != NULL) ||
+	    ((x = strchr(ptr, '\\')) != NULL) ||
+	    ((x = strchr(ptr, ':')) != NULL)) {
+		ptr = x + 1;
+	}
+	while (*name != '\0') {
+		if (tolower(*ptr) != *name) {
+			return (false);
+		}
+		ptr++;
+		name++;
+	}
+	return ((*ptr == '\0') || (*ptr == '.'));
+}
+
+static void
+udp_wait(nng_aio *aio, const char *what)
+{
+	int rv;
+
+	nng_aio_wait(aio);
+	if ((rv = nng_aio_result(aio)) != 0) {
+		die("%s: %s", what, nng_strerror(rv));
+	}
+}
+
+static void
+do_udp_batch_thr(int argc, char **argv)
+{
+	nng_udp      *u1;
+	nng_udp      *u2;
+	nng_sockaddr  sa;
+	nng_sockaddr  sa2;
+	nng_aio      *aio1;
+	nng_aio      *aio2;
+	nni_udp_dgram tx[32];
+	nni_udp_dgram rx[32];
+	char          buf[32][64];
+	int           count;
+	int           rv;
+	nng_time      start;
+	nng_duration  single;
+	nng_duration  batch;
+
+	if (argc != 1) {
+		die("Usage: udp_batch_thr <count>");
+	}
+	count = parse_int(argv[0], "count");
+
+	sa.s_in.sa_family = NNG_AF_INET;
+	sa.s_in.sa_port   = 0;
+	NNI_PUT32((uint8_t *) &sa.s_in.sa_addr, 0x7f000001); // 127.0.0.1
+	if (((rv = nng_udp_open(&u1, &sa)) != 0) ||
+	    ((rv = nng_udp_open(&u2, &sa)) != 0) ||
+	    ((rv = nng_udp_sockname(u2, &sa2)) != 0)) {
+		die("nng_udp_open: %s", nng_strerror(rv));
+	}
+	if (((rv = nng_aio_alloc(&aio1, NULL, NULL)) != 0) ||
+	    ((rv = nng_aio_alloc(&aio2, NULL, NULL)) != 0)) {
+		die("nng_aio_alloc: %s", nng_strerror(rv));
+	}
+	// Loopback should not lose anything, but if it does, give up
+	// rather than waiting forever.
+	nng_aio_set_timeout(aio1, 1000);
+	nng_aio_set_timeout(aio2, 1000);
+	memset(buf, 0, sizeof(buf));
+	for (int i = 0; i < 32; i++) {
+		tx[i].ud_iov[0].iov_buf = buf[i];
+		tx[i].ud_iov[0].iov_len = sizeof(buf[i]);
+		tx[i].ud_niov           = 1;
+		tx[i].ud_addr           = sa2;
+		rx[i]                   = tx[i];
+	}
+
+	// Loopback delivers during the send, so each trip through the
+	// loop sends and then receives the same datagrams.
+	start = nng_clock();
+	for (int n = 0; n < count; n++) {
+		nng_aio_set_iov(aio1, 1, &tx[0].ud_iov[0]);
+		nng_aio_set_input(aio1, 0, &sa2);
+		nng_udp_send(u1, aio1);
+		udp_wait(aio1, "nng_udp_send");
+		nng_aio_set_iov(aio2, 1, &rx[0].ud_iov[0]);
+		nng_aio_set_input(aio2, 0, &rx[0].ud_addr);
+		nng_udp_recv(u2, aio2);
+		udp_wait(aio2, "nng_udp_recv");
+	}
+	single = nng_clock() - start;
+
+	start = nng_clock();
+	for (int n = 0; n < count; n += 32) {
+		size_t got = 0;
+		nni_plat_udp_send_batch((nni_plat_udp *) u1, tx, 32, aio1);
+		udp_wait(aio1, "send batch");
+		while (got < 32) {
+			nni_plat_udp_recv_batch(
+			    (nni_plat_udp *) u2, rx, 32 - got, aio2);
+			udp_wait(aio2, "receive batch");
+			got += nng_aio_count(aio2);
+		}
+	}
+	batch = nng_clock() - start;
+
+	printf("datagram size: %d [B]\n", (int) sizeof(buf[0]));
+	printf("datagram count: %d\n", count);
+	printf("single: %.f [dgram/s]\n",
+	    single > 0 ? (double) count * 1000 / single : 0.0);
+	printf("batched: %.f [dgram/s]\n",
+	    batch > 0 ? (double) count * 1000 / batch : 0.0);
+
+	nng_aio_free(aio1);
+	nng_aio_free(aio2);
+	nng_udp_close(u1);
+	nng_udp_close(u2);
+}
+
+#define STATS_THREADS 4
+#define STATS_BUMPS 2000000
+#define STATS_MSGS 50000
+
+static void
+stats_bump(void *arg)
+{
+	nni_stat_item *item = arg;
+	for (int i = 0; i < STATS_BUMPS; i++) {
+		nni_stat_inc(item, 1);
+	}
+}
+
+static double
+stats_bump_threads(nni_stat_item *item)
+{
+	nng_thread *thrs[STATS_THREADS];
+	nng_time    start = nng_clock();
+	int         rv;
+
+	for (int i = 0; i < STATS_THREADS; i++) {
+		rv = nng_thread_create(&thrs[i], stats_bump, item);
+		if (rv != 0) {
+			die("Cannot create thread: %s", nng_strerror(rv));
+		}
+	}
+	for (int i = 0; i < STATS_THREADS; i++) {
+		nng_thread_destroy(thrs[i]);
+	}
+	return ((double) (nng_clock() - start) * 1e6 / STATS_BUMPS);
+}
+
+typedef struct {
+	nng_socket s;
+	int        rv;
+} stats_sender;
+
+static void
+stats_send(void *arg)
+{
+	stats_sender *ss = arg;
+	for (int i = 0; (i < STATS_MSGS) && (ss->rv == 0); i++) {
+		ss->rv = nng_send(ss->s, "ping", 5, 0);
+	}
+}
+
+// This measures several threads bumping the same counter, first as a
+// single atomic and then sharded by CPU, and then several threads
+// sending on one socket, which all bump the same socket counters.
+// Sharding is only used with more than one CPU, unless a shard count
+// is given.
+static void
+do_stats_perf(int argc, char **argv)
+{
+	static const nni_stat_info atomic_info = {
+		.si_name   = "perf_atomic",
+		.si_type   = NNG_STAT_COUNTER,
+		.si_atomic = true,
+	};
+	static const nni_stat_info shard_info = {
+		.si_name   = "perf_sharded",
+		.si_type   = NNG_STAT_COUNTER,
+		.si_atomic = true,
+		.si_shard  = true,
+	};
+	nni_stat_item atomic;
+	nni_stat_item shard;
+	nng_socket    s1;
+	nng_socket    s2;
+	nng_thread   *thrs[STATS_THREADS];
+	stats_sender  senders[STATS_THREADS];
+	nng_time      start;
+	nng_duration  elapsed;
+	char          buf[8];
+	size_t        sz;
+	int           total = STATS_THREADS * STATS_MSGS;
+	int           rv;
+
+	if (argc > 1) {
+		die("Usage: stats_perf [<shards>]");
+	}
+	if ((argc == 1) &&
+	    ((rv = nni_stat_set_shards(parse_int(argv[0], "shards"))) != 0)) {
+		die("nni_stat_set_shards: %s", nng_strerror(rv));
+	}
+
+	nni_stat_init(&atomic, &atomic_info);
+	nni_stat_init(&shard, &shard_info);
+	printf("threads: %d, cpus: %d, sharded: %s\n", STATS_THREADS,
+	    nni_plat_ncpu(), shard.si_slot != 0 ? "yes" : "no");
+	printf("atomic: %.1f [ns/inc]\n", stats_bump_threads(&atomic));
+	printf("sharded: %.1f [ns/inc]\n", stats_bump_threads(&shard));
+	nni_stat_fini(&atomic);
+	nni_stat_fini(&shard);
+
+	if (((rv = nng_pair1_open(&s1)) != 0) ||
+	    ((rv = nng_pair1_open(&s2)) != 0) ||
+	    ((rv = nng_socket_set_ms(s1, NNG_OPT_SENDTIMEO, 10000)) != 0) ||
+	    ((rv = nng_socket_set_ms(s2, NNG_OPT_RECVTIMEO, 10000)) != 0) ||
+	    ((rv = nng_listen(s2, "inproc://stats_perf", NULL, 0)) != 0) ||
+	    ((rv = nng_dial(s1, "inproc://stats_perf", NULL, 0)) != 0)) {
+		die("socket setup: %s", nng_strerror(rv));
+	}
+	start = nng_clock();
+	for (int i = 0; i < STATS_THREADS; i++) {
+		senders[i].s  = s1;
+		senders[i].rv = 0;
+		if ((rv = nng_thread_create(
+		         &thrs[i], stats_send, &senders[i])) != 0) {
+			die("Cannot create thread: %s", nng_strerror(rv));
+		}
+	}
+	for (int i = 0; i < total; i++) {
+		sz = sizeof(buf);
+		if ((rv = nng_recv(s2, buf, &sz, 0)) != 0) {
+			die("nng_recv: %s", nng_strerror(rv));
+		}
+	}
+	elapsed = (nng_duration) (nng_clock() - start);
+	for (int i = 0; i < STATS_THREADS; i++) {
+		nng_thread_destroy(thrs[i]);
+		if (senders[i].rv != 0) {
+			die("nng_send: %s", nng_strerror(senders[i].rv));
+		}
+	}
+	printf("send: %.f [msg/s]\n",
+	    total * 1000.0 / (elapsed ? elapsed : 1));
+	nng_socket_close(s1);
+	nng_socket_close(s2);
+}
+
+// This measures the cost of a trie match as the number of subscriptions
+// grows.  It should be roughly flat, as it depends on the length of the
+// message, and not on the number of keys.  Half of the probes match.
+static void
+do_trie_perf(int argc, char **argv)
+{
+	static const int sizes[] = { 10, 100, 1000, 10000, 100000 };
+	static char      val[]   = "val";
+	char             key[32];
+	const int        loops = 1000000;
+
+	NNI_ARG_UNUSED(argv);
+	if (argc != 0) {
+		die("Usage: trie_perf");
+	}
+	for (size_t s = 0; s < NNI_NUM_ELEMENTS(sizes); s++) {
+		nni_trie     t;
+		int          n = sizes[s];
+		int          hits;
+		int          rv;
+		nng_time     start;
+		nng_duration elapsed;
+		char(*probes)[24];
+
+		nni_trie_init(&t);
+		for (int i = 0; i < n; i++) {
+			(void) snprintf(
+			    key, sizeof(key), "md.%08x.", i * 7919);
+			if ((rv = nni_trie_insert(
+			         &t, key, strlen(key), val)) != 0) {
+				die("nni_trie_insert: %s", nng_strerror(rv));
+			}
+		}
+		if ((probes = nni_alloc(2 * n * sizeof(*probes))) == NULL) {
+			die("Out of memory");
+		}
+		for (int i = 0; i < 2 * n; i++) {
+			(void) snprintf(probes[i], sizeof(probes[i]),
+			    "md.%08x.quote", i * 7919);
+		}
+		hits  = 0;
+		start = nng_clock();
+		for (int i = 0; i < loops; i++) {
+			if (nni_trie_match(&t, probes[i % (2 * n)], 17)) {
+				hits++;
+			}
+		}
+		elapsed = (nng_duration) (nng_clock() - start);
+		if (hits != loops / 2) {
+			die("Expected %d matches, got %d", loops / 2, hits);
+		}
+		printf("%d keys: %.1f [ns/match]\n", n,
+		    elapsed * 1e6 / loops);
+		nni_free(probes, 2 * n * sizeof(*probes));
+		nni_trie_fini(&t);
+	}
+}
+
+typedef struct {
+	nni_task *tasks;
+	int       ntasks;
+	int       loops;
+	nni_thr   thr;
+} taskq_disp;
+
+static void
+taskq_dispatcher(void *arg)
+{
+	taskq_disp *td = arg;
+
+	for (int i = 0; i < td->loops; i++) {
+		for (int j = 0; j < td->ntasks; j++) {
+			nni_task_wait(&td->tasks[j]);
+			nni_task_dispatch(&td->tasks[j]);
+		}
+	}
+	for (int j = 0; j < td->ntasks; j++) {
+		nni_task_wait(&td->tasks[j]);
+	}
+}
+
+static void
+taskq_count(void *arg)
+{
+	nni_atomic_inc(arg);
+}
+
+// This measures dispatches per second as the number of worker threads
+// grows.  Four outside threads dispatch, each to its own tasks.
+static void
+do_taskq_perf(int argc, char **argv)
+{
+	static const int threads[] = { 1, 2, 4, 8 };
+	const int        ndisp     = 4;
+	const int        ntasks    = 64;
+	const int        loops     = 2000;
+
+	NNI_ARG_UNUSED(argv);
+	if (argc != 0) {
+		die("Usage: taskq_perf");
+	}
+	for (size_t t = 0; t < NNI_NUM_ELEMENTS(threads); t++) {
+		nni_taskq     *tq;
+		taskq_disp     td[4];
+		nni_atomic_int count;
+		nng_time       start;
+		nng_duration   elapsed;
+		int            total = ndisp * ntasks * loops;
+		int            rv;
+
+		if ((rv = nni_taskq_init(&tq, threads[t])) != 0) {
+			die("nni_taskq_init: %s", nng_strerror(rv));
+		}
+		nni_atomic_init(&count);
+		for (int d = 0; d < ndisp; d++) {
+			td[d].ntasks = ntasks;
+			td[d].loops  = loops;
+			td[d].tasks  = nni_alloc(ntasks * sizeof(nni_task));
+			if (td[d].tasks == NULL) {
+				die("Out of memory");
+			}
+			for (int j = 0; j < ntasks; j++) {
+				nni_task_init(
+				    &td[d].tasks[j], tq, taskq_count, &count);
+			}
+			if ((rv = nni_thr_init(&td[d].thr, taskq_dispatcher,
+			         &td[d])) != 0) {
+				die("nni_thr_init: %s", nng_strerror(rv));
+			}
+		}
+		start = nng_clock();
+		for (int d = 0; d < ndisp; d++) {
+			nni_thr_run(&td[d].thr);
+		}
+		for (int d = 0; d < ndisp; d++) {
+			nni_thr_fini(&td[d].thr);
+		}
+		elapsed = (nng_duration) (nng_clock() - start);
+		if (nni_atomic_get(&count) != total) {
+			die("Expected %d callbacks, got %d", total,
+			    nni_atomic_get(&count));
+		}
+		printf("%d threads: %.f [dispatch/s]\n", threads[t],
+		    total * 1000.0 / (elapsed ? elapsed : 1));
+		for (int d = 0; d < ndisp; d++) {
+			for (int j = 0; j < ntasks; j++) {
+				nni_task_fini(&td[d].tasks[j]);
+			}
+			nni_free(td[d].tasks, ntasks * sizeof(nni_task));
+		}
+		nni_taskq_fini(tq);
+	}
+}
+
+static void
+aio_perf_done(void *arg)
+{
+	NNI_ARG_UNUSED(arg);
+}
+
+// This measures expiration with a large number of timed aios outstanding.
+// Adding and canceling should cost the same per aio no matter how many
+// there are, and short sleeps should still finish on time while the long
+// ones wait.
+static void
+do_aio_perf(int argc, char **argv)
+{
+	int          naio   = 1000000;
+	const int    nshort = 50;
+	nng_aio    **aios;
+	nng_aio     *aio;
+	nng_time     start;
+	nng_duration add, wake, cancel;
+	int          rv;
+
+	if (argc > 1) {
+		die("Usage: aio_perf [<count>]");
+	}
+	if (argc == 1) {
+		naio = parse_int(argv[0], "count");
+	}
+	if ((aios = nng_alloc(naio * sizeof(nng_aio *))) == NULL) {
+		die("Out of memory");
+	}
+	for (int i = 0; i < naio; i++) {
+		if ((rv = nng_aio_alloc(&aios[i], NULL, NULL)) != 0) {
+			die("nng_aio_alloc: %s", nng_strerror(rv));
+		}
+	}
+	if ((rv = nng_aio_alloc(&aio, aio_perf_done, NULL)) != 0) {
+		die("nng_aio_alloc: %s", nng_strerror(rv));
+	}
+
+	start = nng_clock();
+	for (int i = 0; i < naio; i++) {
+		nng_sleep_aio(3600000 + (i % 100000), aios[i]);
+	}
+	add = (nng_duration) (nng_clock() - start);
+
+	start = nng_clock();
+	for (int i = 0; i < nshort; i++) {
+		nng_sleep_aio(5, aio);
+		nng_aio_wait(aio);
+		if ((rv = nng_aio_result(aio)) != 0) {
+			die("nng_sleep_aio: %s", nng_strerror(rv));
+		}
+	}
+	wake = (nng_duration) (nng_clock() - start);
+
+	start = nng_clock();
+	for (int i = 0; i < naio; i++) {
+		nng_aio_cancel(aios[i]);
+	}
+	for (int i = 0; i < naio; i++) {
+		nng_aio_wait(aios[i]);
+		if (nng_aio_result(aios[i]) != NNG_ECANCELED) {
+			die("Timed aio was not canceled");
+		}
+	}
+	cancel = (nng_duration) (nng_clock() - start);
+
+	printf("%d timed aios: add %.1f [ns/aio], cancel %.1f [ns/aio]\n",
+	    naio, add * 1e6 / naio, cancel * 1e6 / naio);
+	printf("%d sleeps of 5 ms: %.1f [ms/sleep]\n", nshort,
+	    (double) wake / nshort);
+
+	for (int i = 0; i < naio; i++) {
+		nng_aio_free(aios[i]);
+	}
+	nng_aio_free(aio);
+	nng_free(aios, naio * sizeof(nng_aio *));
+}
+
+#ifdef NNG_SUPP_WEBSOCKET
+// This measures WebSocket masking throughput across frame sizes,
+// compared with masking a byte at a time.
+static void
+do_wsmask_perf(int argc, char **argv)
+{
+	static const size_t  sizes[] = { 16, 256, 4096, 65536, 1 << 20,
+		 16 << 20 };
+	static const uint8_t key[4]  = { 0x12, 0x9a, 0xc3, 0x7e };
+	const size_t         total   = 256 << 20; // bytes per size
+	size_t               max     = sizes[NNI_NUM_ELEMENTS(sizes) - 1];
+	uint8_t             *buf;
+
+	NNI_ARG_UNUSED(argv);
+	if (argc != 0) {
+		die("Usage: wsmask_perf");
+	}
+	if ((buf = nni_alloc(max)) == NULL) {
+		die("Out of memory");
+	}
+	for (size_t i = 0; i < max; i++) {
+		buf[i] = (uint8_t) (i * 7 + 3);
+	}
+	printf("using %s\n", nni_ws_mask_impl());
+	for (size_t i = 0; i < NNI_NUM_ELEMENTS(sizes); i++) {
+		size_t       loops = total / sizes[i];
+		nng_time     start;
+		nng_duration fast;
+		nng_duration slow;
+
+		start = nng_clock();
+		for (size_t j = 0; j < loops; j++) {
+			nni_ws_mask(buf, sizes[i], key, 0);
+		}
+		fast  = (nng_duration) (nng_clock() - start);
+		start = nng_clock();
+		for (size_t j = 0; j < loops; j++) {
+			for (size_t k = 0; k < sizes[i]; k++) {
+				buf[k] ^= key[k % 4];
+			}
+		}
+		slow = (nng_duration) (nng_clock() - start);
+		printf("%8zu byte frames: %.f [MB/s] (byte at a time %.f "
+		       "[MB/s])\n",
+		    sizes[i], total / 1000.0 / (fast ? fast : 1),
+		    total / 1000.0 / (slow ? slow : 1));
+	}
+	nni_free(buf, max);
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+	char *prog;
+
+	nng_init(NULL);
+	atexit(nng_fini);
+
+	// Allow -m <mode> to override argv[0].
+	if ((argc >= 3) && (strcmp(argv[1], "-m") == 0)) {
+		prog = argv[2];
+		argv += 3;
+		argc -= 3;
+	} else {
+		prog = argv[0];
+		argc--;
+		argv++;
+	}
+	if (matches(prog, "udp_batch_thr")) {
+		do_udp_batch_thr(argc, argv);
+	} else if (matches(prog, "stats_perf")) {
+		do_stats_perf(argc, argv);
+	} else if (matches(prog, "trie_perf")) {
+		do_trie_perf(argc, argv);
+	} else if (matches(prog, "taskq_perf")) {
+		do_taskq_perf(argc, argv);
+	} else if (matches(prog, "aio_perf")) {
+		do_aio_perf(argc, argv);
+#ifdef NNG_SUPP_WEBSOCKET
+	} else if (matches(prog, "wsmask_perf")) {
+		do_wsmask_perf(argc, argv);
+#endif
+	} else {
+		die("Unknown program mode? Use -m <mode>.");
+	}
+	return (0);
+}
@@ -77,6 +77,12 @@ enum options {
 	OPT_SURVEY0,
 	OPT_BUS0,
 	OPT_URL,
+	OPT_COALESCE,
+	OPT_COALESCE_TIME,
+	OPT_POLLERS,
+	OPT_CONNS,
+	OPT_BUFFER,
+	OPT_STRIPES,
 };
 
 // These are not universally supported by the variants yet.
@@ -88,6 +94,14 @@ static nng_arg_spec opts[] = {
 	{ .a_name = "pubsub0", .a_val = OPT_PUBSUB0 },
 	{ .a_name = "pipeline0", .a_val = OPT_PIPELINE0 },
 	{ .a_name = "url", .a_val = OPT_URL, .a_arg = true },
+	{ .a_name = "coalesce", .a_val = OPT_COALESCE, .a_arg = true },
+	{ .a_name = "coalesce-time",
+	    .a_val  = OPT_COALESCE_TIME,
+	    .a_arg  = true },
+	{ .a_name = "pollers", .a_val = OPT_POLLERS, .a_arg = true },
+	{ .a_name = "conns", .a_val = OPT_CONNS, .a_arg = true },
+	{ .a_name = "buffer", .a_val = OPT_BUFFER, .a_arg = true },
+	{ .a_name = "stripes", .a_val = OPT_STRIPES, .a_arg = true },
 	{ .a_name = NULL, .a_val = 0 },
 };
 
@@ -101,6 +115,9 @@ static void do_remote_thr(int argc, char **argv);
 static void do_local_thr(int argc, char **argv);
 static void do_inproc_thr(int argc, char **argv);
 static void do_inproc_lat(int argc, char **argv);
+static void do_stream_thr(int argc, char **argv);
+static void do_poll_thr(int argc, char **argv);
+static void do_stripe_thr(int argc, char **argv);
 static void die(const char *, ...);
 
 // perf implements the same performance tests found in the standard
@@ -116,6 +133,12 @@ static void die(const char *, ...);
 // - remote_thr - remote throughput side
 // - inproc_lat - inproc latency
 // - inproc_thr - inproc throughput
+// - stream_thr - throughput over a stream transport in one process,
+//                reporting the number of writes (system calls) per message
+// - poll_thr   - aggregate throughput over many connections in one
+//                process, for comparing numbers of poller threads
+// - stripe_thr - throughput of one push/pull dialer, for each number of
+//                pipes it keeps (NNG_OPT_DIAL_PIPES) up to --stripes
 //
 
 bool
@@ -195,6 +218,12 @@ main(int argc, char **argv)
 		do_inproc_thr(argc, argv);
 	} else if (matches(prog, "inproc_lat")) {
 		do_inproc_lat(argc, argv);
+	} else if (matches(prog, "stream_thr")) {
+		do_stream_thr(argc, argv);
+	} else if (matches(prog, "poll_thr")) {
+		do_poll_thr(argc, argv);
+	} else if (matches(prog, "stripe_thr")) {
+		do_stripe_thr(argc, argv);
 	} else {
 		die("Unknown program mode? Use -m <mode>.");
 	}
@@ -290,6 +319,9 @@ do_remote_thr(int argc, char **argv)
 	throughput_client(argv[0], msgsize, trips);
 }
 
+// Inproc buffering for the throughput client (zero for none).
+static int inproc_buffer;
+
 struct inproc_args {
 	int         count;
 	int         msgsize;
@@ -410,6 +442,9 @@ do_inproc_thr(int argc, char **argv)
 		case OPT_URL:
 			addr = arg;
 			break;
+		case OPT_BUFFER:
+			inproc_buffer = parse_int(arg, "buffer depth");
+			break;
 		default:
 			die("bad option");
 		}
@@ -418,7 +453,7 @@ do_inproc_thr(int argc, char **argv)
 	argv += optidx;
 
 	if (argc != 2) {
-		die("Usage: inproc_thr <msg-size> <count>");
+		die("Usage: inproc_thr [--buffer <n>] <msg-size> <count>");
 	}
 
 	ia.addr    = addr;
@@ -437,6 +472,345 @@ do_inproc_thr(int argc, char **argv)
 	nng_thread_destroy(thr);
 }
 
+// Send coalescing settings for the throughput client, and whether it
+// should report how many writes it took.
+static size_t       coalesce_size;
+static nng_duration coalesce_time;
+static bool         report_writes;
+
+void
+do_stream_thr(int argc, char **argv)
+{
+	nng_thread        *thr;
+	struct inproc_args ia;
+	int                rv;
+	int                optidx;
+	int                val;
+	char              *arg  = NULL;
+	char              *addr = "tcp://127.0.0.1:5598";
+
+	optidx = 0;
+	while ((rv = nng_args_parse(argc, argv, opts, &val, &arg, &optidx)) ==
+	    0) {
+		switch (val) {
+		case OPT_URL:
+			addr = arg;
+			break;
+		case OPT_COALESCE:
+			coalesce_size = parse_int(arg, "coalesce size");
+			break;
+		case OPT_COALESCE_TIME:
+			coalesce_time = parse_int(arg, "coalesce time");
+			break;
+		default:
+			die("bad option");
+		}
+	}
+	argc -= optidx;
+	argv += optidx;
+
+	if (argc != 2) {
+		die("Usage: stream_thr [--url <url>] [--coalesce <bytes>] "
+		    "[--coalesce-time <ms>] <msg-size> <count>");
+	}
+
+	ia.addr       = addr;
+	ia.msgsize    = parse_int(argv[0], "message size");
+	ia.count      = parse_int(argv[1], "count");
+	ia.func       = throughput_server;
+	report_writes = true;
+
+	if ((rv = nng_thread_create(&thr, do_inproc, &ia)) != 0) {
+		die("Cannot create thread: %s", nng_strerror(rv));
+	}
+
+	// Sleep a bit.
+	nng_msleep(100);
+
+	throughput_client(addr, ia.msgsize, ia.count);
+	nng_thread_destroy(thr);
+}
+
+// A connection used by poll_thr, with a thread on each end.
+struct poll_conn {
+	nng_socket  rx;
+	nng_socket  tx;
+	nng_thread *rthr;
+	nng_thread *sthr;
+	size_t      msgsize;
+	int         count;
+};
+
+static void
+poll_thr_send(void *arg)
+{
+	struct poll_conn *pc = arg;
+	nng_msg          *msg;
+	int               rv;
+
+	for (int i = 0; i < pc->count; i++) {
+		if ((rv = nng_msg_alloc(&msg, pc->msgsize)) != 0) {
+			die("nng_msg_alloc: %s", nng_strerror(rv));
+		}
+		if ((rv = nng_sendmsg(pc->tx, msg, 0)) != 0) {
+			die("nng_sendmsg: %s", nng_strerror(rv));
+		}
+	}
+}
+
+static void
+poll_thr_recv(void *arg)
+{
+	struct poll_conn *pc = arg;
+	nng_msg          *msg;
+	int               rv;
+
+	for (int i = 0; i < pc->count; i++) {
+		if ((rv = nng_recvmsg(pc->rx, &msg, 0)) != 0) {
+			die("nng_recvmsg: %s", nng_strerror(rv));
+		}
+		nng_msg_free(msg);
+	}
+}
+
+static void
+poll_conn_open(struct poll_conn *pc, const char *addr)
+{
+	nng_listener   l;
+	const nng_url *u;
+	char           url[256];
+	int            rv;
+
+	if (((rv = nng_pair1_open(&pc->rx)) != 0) ||
+	    ((rv = nng_pair1_open(&pc->tx)) != 0)) {
+		die("nng_socket: %s", nng_strerror(rv));
+	}
+	if (((rv = nng_socket_set_int(pc->rx, NNG_OPT_RECVBUF, 128)) != 0) ||
+	    ((rv = nng_socket_set_int(pc->tx, NNG_OPT_SENDBUF, 128)) != 0)) {
+		die("nng_socket_set: %s", nng_strerror(rv));
+	}
+	if ((rv = nng_listen(pc->rx, addr, &l, 0)) != 0) {
+		die("nng_listen: %s", nng_strerror(rv));
+	}
+	if (((rv = nng_listener_get_url(l, &u)) != 0) ||
+	    ((rv = nng_url_sprintf(url, sizeof(url), u)) < 0)) {
+		die("nng_listener_get_url: %s", nng_strerror(rv));
+	}
+	if ((rv = nng_dial(pc->tx, url, NULL, 0)) != 0) {
+		die("nng_dial: %s", nng_strerror(rv));
+	}
+}
+
+void
+do_poll_thr(int argc, char **argv)
+{
+	struct poll_conn *pcs;
+	nng_init_params   params = { 0 };
+	int               rv;
+	int               optidx;
+	int               val;
+	int               conns   = 16;
+	int               pollers = 0;
+	int               msgsize;
+	int               count;
+	char             *arg  = NULL;
+	char             *addr = "tcp://127.0.0.1:0";
+	nng_time          start, end;
+	float             total, msgpersec, mbps;
+
+	optidx = 0;
+	while ((rv = nng_args_parse(argc, argv, opts, &val, &arg, &optidx)) ==
+	    0) {
+		switch (val) {
+		case OPT_URL:
+			addr = arg;
+			break;
+		case OPT_POLLERS:
+			pollers = parse_int(arg, "poller count");
+			break;
+		case OPT_CONNS:
+			conns = parse_int(arg, "connection count");
+			break;
+		default:
+			die("bad option");
+		}
+	}
+	argc -= optidx;
+	argv += optidx;
+
+	if ((argc != 2) || (conns < 1)) {
+		die("Usage: poll_thr [--url <url>] [--pollers <n>] "
+		    "[--conns <n>] <msg-size> <count>");
+	}
+	msgsize = parse_int(argv[0], "message size");
+	count   = parse_int(argv[1], "count");
+
+	// The poller count can only be set when initializing the library.
+	if (pollers > 0) {
+		nng_fini();
+		params.num_poller_threads = (int16_t) pollers;
+		params.max_poller_threads = (int16_t) pollers;
+		if ((rv = nng_init(&params)) != 0) {
+			die("nng_init: %s", nng_strerror(rv));
+		}
+	}
+
+	if ((pcs = calloc(conns, sizeof(*pcs))) == NULL) {
+		die("calloc: out of memory");
+	}
+	for (int i = 0; i < conns; i++) {
+		pcs[i].msgsize = msgsize;
+		pcs[i].count   = count;
+		poll_conn_open(&pcs[i], addr);
+	}
+
+	// Let the connections settle.
+	nng_msleep(100);
+
+	start = nng_clock();
+	for (int i = 0; i < conns; i++) {
+		if (((rv = nng_thread_create(
+		          &pcs[i].rthr, poll_thr_recv, &pcs[i])) != 0) ||
+		    ((rv = nng_thread_create(
+		          &pcs[i].sthr, poll_thr_send, &pcs[i])) != 0)) {
+			die("Cannot create thread: %s", nng_strerror(rv));
+		}
+	}
+	for (int i = 0; i < conns; i++) {
+		nng_thread_destroy(pcs[i].sthr);
+		nng_thread_destroy(pcs[i].rthr);
+	}
+	end = nng_clock();
+
+	for (int i = 0; i < conns; i++) {
+		nng_socket_close(pcs[i].tx);
+		nng_socket_close(pcs[i].rx);
+	}
+	free(pcs);
+
+	total     = (float) ((end - start)) / 1000;
+	msgpersec = (float) (count) * (float) conns / total;
+	mbps      = (float) (msgpersec * 8 * msgsize) / (1024 * 1024);
+	printf("total time: %.3f [s]\n", total);
+	if (pollers > 0) {
+		printf("poller threads: %d\n", pollers);
+	}
+	printf("connections: %d\n", conns);
+	printf("message size: %d [B]\n", msgsize);
+	printf("message count: %d\n", count * conns);
+	printf("throughput: %.f [msg/s]\n", msgpersec);
+	printf("throughput: %.3f [Mb/s]\n", mbps);
+}
+
+// stripe_conn_open is like poll_conn_open, but the one dialer keeps
+// several pipes, over which push spreads the messages.
+static void
+stripe_conn_open(struct poll_conn *pc, const char *addr, int stripes)
+{
+	nng_listener   l;
+	nng_dialer     d;
+	const nng_url *u;
+	char           url[256];
+	int            rv;
+
+	if (((rv = nng_pull0_open(&pc->rx)) != 0) ||
+	    ((rv = nng_push0_open(&pc->tx)) != 0)) {
+		die("nng_socket: %s", nng_strerror(rv));
+	}
+	if (((rv = nng_socket_set_int(pc->rx, NNG_OPT_RECVBUF, 128)) != 0) ||
+	    ((rv = nng_socket_set_int(pc->tx, NNG_OPT_SENDBUF, 128)) != 0)) {
+		die("nng_socket_set: %s", nng_strerror(rv));
+	}
+	if ((rv = nng_listen(pc->rx, addr, &l, 0)) != 0) {
+		die("nng_listen: %s", nng_strerror(rv));
+	}
+	if (((rv = nng_listener_get_url(l, &u)) != 0) ||
+	    ((rv = nng_url_sprintf(url, sizeof(url), u)) < 0)) {
+		die("nng_listener_get_url: %s", nng_strerror(rv));
+	}
+	if (((rv = nng_dialer_create(&d, pc->tx, url)) != 0) ||
+	    ((rv = nng_dialer_set_int(d, NNG_OPT_DIAL_PIPES, stripes)) != 0) ||
+	    ((rv = nng_dialer_start(d, 0)) != 0)) {
+		die("nng_dial: %s", nng_strerror(rv));
+	}
+}
+
+void
+do_stripe_thr(int argc, char **argv)
+{
+	struct poll_conn pc;
+	int              rv;
+	int              optidx;
+	int              val;
+	int              stripes = 8;
+	int              msgsize;
+	int              count;
+	char            *arg  = NULL;
+	char            *addr = "tcp://127.0.0.1:0";
+	nng_time         start, end;
+	float            total, msgpersec, mbps;
+
+	optidx = 0;
+	while ((rv = nng_args_parse(argc, argv, opts, &val, &arg, &optidx)) ==
+	    0) {
+		switch (val) {
+		case OPT_URL:
+			addr = arg;
+			break;
+		case OPT_STRIPES:
+			stripes = parse_int(arg, "stripe count");
+			break;
+		default:
+			die("bad option");
+		}
+	}
+	argc -= optidx;
+	argv += optidx;
+
+	if ((argc != 2) || (stripes < 1)) {
+		die("Usage: stripe_thr [--url <url>] [--stripes <n>] "
+		    "<msg-size> <count>");
+	}
+	msgsize = parse_int(argv[0], "message size");
+	count   = parse_int(argv[1], "count");
+
+	printf("message size: %d [B]\n", msgsize);
+	printf("message count: %d\n", count);
+	// Double the pipes each round, ending with exactly the stripe count.
+	for (int n = 1;; n = (n * 2 < stripes) ? n * 2 : stripes) {
+		memset(&pc, 0, sizeof(pc));
+		pc.msgsize = msgsize;
+		pc.count   = count;
+		stripe_conn_open(&pc, addr, n);
+
+		// Let the pipes connect; they are dialed one at a time.
+		nng_msleep(100);
+
+		start = nng_clock();
+		if (((rv = nng_thread_create(&pc.rthr, poll_thr_recv, &pc)) !=
+		        0) ||
+		    ((rv = nng_thread_create(&pc.sthr, poll_thr_send, &pc)) !=
+		        0)) {
+			die("Cannot create thread: %s", nng_strerror(rv));
+		}
+		nng_thread_destroy(pc.sthr);
+		nng_thread_destroy(pc.rthr);
+		end = nng_clock();
+
+		nng_socket_close(pc.tx);
+		nng_socket_close(pc.rx);
+
+		total     = (float) ((end - start)) / 1000;
+		msgpersec = (float) (count) / total;
+		mbps      = (float) (msgpersec * 8 * msgsize) / (1024 * 1024);
+		printf("pipes: %3d  throughput: %.f [msg/s] %.3f [Mb/s]\n",
+		    n, msgpersec, mbps);
+		if (n == stripes) {
+			break;
+		}
+	}
+}
+
 void
 latency_client(const char *addr, size_t msgsize, int trips)
 {
@@ -587,10 +961,34 @@ throughput_server(const char *addr, size_t msgsize, int count)
 	printf("throughput: %.3f [Mb/s]\n", mbps);
 }
 
+static void
+report_stream_writes(nng_dialer d, int count)
+{
+	nng_stat       *stats;
+	const nng_stat *writes;
+
+	if (nng_stats_get(&stats) != 0) {
+		printf("stream writes: unavailable\n");
+		return;
+	}
+	writes = nng_stat_find(nng_stat_find_dialer(stats, d), "tx_writes");
+	if (writes == NULL) {
+		printf("stream writes: unavailable\n");
+		nng_stats_free(stats);
+		return;
+	}
+	printf("stream writes: %llu\n",
+	    (unsigned long long) nng_stat_value(writes));
+	printf("writes per message: %.3f\n",
+	    (double) nng_stat_value(writes) / (double) count);
+	nng_stats_free(stats);
+}
+
 void
 throughput_client(const char *addr, size_t msgsize, int count)
 {
 	nng_socket s;
+	nng_dialer d;
 	nng_msg   *msg;
 	int        rv;
 	int        i;
@@ -615,7 +1013,31 @@ throughput_client(const char *addr, size_t msgsize, int count)
 		die("nng_socket_set(nng_opt_recvtimeo): %s", nng_strerror(rv));
 	}
 
-	if ((rv = nng_dial(s, addr, NULL, 0)) != 0) {
+	if ((rv = nng_dialer_create(&d, s, addr)) != 0) {
+		die("nng_dialer_create: %s", nng_strerror(rv));
+	}
+	if (coalesce_size > 0) {
+		rv = nng_dialer_set_size(
+		    d, NNG_OPT_SEND_COALESCE, coalesce_size);
+		if (rv != 0) {
+			die("nng_dialer_set(coalesce): %s", nng_strerror(rv));
+		}
+		rv = nng_dialer_set_ms(
+		    d, NNG_OPT_SEND_COALESCE_TIME, coalesce_time);
+		if (rv != 0) {
+			die("nng_dialer_set(coalesce-time): %s",
+			    nng_strerror(rv));
+		}
+	}
+	if (inproc_buffer > 0) {
+		rv = nng_dialer_set_int(
+		    d, NNG_OPT_INPROC_BUFFER, inproc_buffer);
+		if (rv != 0) {
+			die("nng_dialer_set(inproc-buffer): %s",
+			    nng_strerror(rv));
+		}
+	}
+	if ((rv = nng_dialer_start(d, 0)) != 0) {
 		die("nng_dial: %s", nng_strerror(rv));
 	}
 
@@ -642,5 +1064,8 @@ throughput_client(const char *addr, size_t msgsize, int count)
 		nng_msg_free(msg);
 	}
 
+	if (report_writes) {
+		report_stream_writes(d, count);
+	}
 	nng_socket_close(s);
 }